@@ -0,0 +1,139 @@
+//===============================================================================
+// C++ driver running the sharded nested Kriging of distributed.h as MPI processes, outside R (see README.md):
+// mpirun -np P ./shardedDriver design.csv points.csv covType sd2 param_1,...,param_d [simple|ordinary] [nugget]
+// design.csv: a header line, then rows x_1,...,x_d,y,cluster; points.csv: a header line, then rows x_1,...,x_d.
+// Each process reads design.csv twice, the clusters only, then the rows of its own clusters, so that no process
+// holds the whole dataset. Rank 0 writes the predictions mean,sd2 on stdout, one line by prediction point.
+//===============================================================================
+
+#if !defined(NESTEDKRIGING_MPI)
+#error "compile with -DNESTEDKRIGING_MPI, see README.md"
+#endif
+
+#include "distributed.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace {
+
+using nestedKrig::Long;
+
+std::vector<double> valuesOfLine(const std::string& line) {
+  std::vector<double> values{};
+  std::istringstream stream(line);
+  for(std::string field; std::getline(stream, field, ','); ) values.push_back(std::strtod(field.c_str(), nullptr));
+  return values;
+}
+
+template <typename RowFunction>
+void forEachRow(const std::string& fileName, RowFunction row) {
+  // rows of a csv file after its header line
+  std::ifstream file(fileName);
+  if (!file) throw std::runtime_error("cannot read " + fileName);
+  std::string line;
+  std::getline(file, line);
+  while (std::getline(file, line)) if (!line.empty()) row(valuesOfLine(line));
+}
+
+std::map<long, Long> groupOfCluster(const std::string& designFile) {
+  // clusters ranked in increasing order, as the clusters of nested_kriging
+  std::set<long> clusters{};
+  forEachRow(designFile, [&](const std::vector<double>& values) { clusters.insert(static_cast<long>(values.back())); });
+  std::map<long, Long> groups{};
+  for(const long cluster: clusters) groups.emplace(cluster, groups.size());
+  return groups;
+}
+
+nestedKrig::LocalShard shardOfRank(const std::string& designFile, const std::map<long, Long>& groups,
+                                   const nestedKrig::PairDistribution& distribution, const int rank, const Long d) {
+  std::vector<double> rowValues{}, responses{};
+  std::vector<Long> groupOfRow{};
+  forEachRow(designFile, [&](const std::vector<double>& values) {
+    if (values.size()!=d+2) throw std::runtime_error("design rows must have d+2 values");
+    const Long group = groups.at(static_cast<long>(values.back()));
+    if (distribution.ownerOfGroup(group)!=rank) return;
+    rowValues.insert(rowValues.end(), values.begin(), values.begin() + d);
+    responses.push_back(values[d]);
+    groupOfRow.push_back(group);
+  });
+  nestedKrig::LocalShard shard;
+  shard.X = arma::mat(rowValues.data(), d, groupOfRow.size()).t();
+  shard.Y = arma::vec(responses);
+  shard.groupOfRow = groupOfRow;
+  return shard;
+}
+
+arma::mat predictionPoints(const std::string& pointsFile) {
+  std::vector<std::vector<double> > rows{};
+  forEachRow(pointsFile, [&](const std::vector<double>& values) { rows.push_back(values); });
+  if (rows.empty()) throw std::runtime_error("no prediction point in " + pointsFile);
+  arma::mat x(rows.size(), rows[0].size());
+  for(Long m=0; m<rows.size(); ++m) {
+    if (rows[m].size()!=x.n_cols) throw std::runtime_error("prediction points must have d values");
+    for(Long k=0; k<x.n_cols; ++k) x(m,k) = rows[m][k];
+  }
+  return x;
+}
+
+int run(int argc, char* argv[]) {
+  if ((argc<6) || (argc>8)) {
+    std::cerr << "usage: mpirun -np P " << argv[0]
+              << " design.csv points.csv covType sd2 param_1,...,param_d [simple|ordinary] [nugget]" << std::endl;
+    return 2;
+  }
+  nestedKrig::MpiCommunicator communicator(MPI_COMM_WORLD);
+  const int rank = communicator.rank(), P = communicator.size();
+  const arma::mat x = predictionPoints(argv[2]);
+  const std::string covType = argv[3];
+  const double sd2 = std::strtod(argv[4], nullptr);
+  const arma::vec param(valuesOfLine(argv[5]));
+  const bool ordinaryKriging = (argc>6) && (std::string(argv[6])=="ordinary");
+  const arma::vec nugget {(argc>7) ? std::strtod(argv[7], nullptr) : 0.0};
+  #if defined(_OPENMP)
+    const int numThreads = omp_get_max_threads();
+  #else
+    const int numThreads = 1;
+  #endif
+
+  const std::map<long, Long> groups = groupOfCluster(argv[1]);
+  nestedKrig::ShardedNestedKriging sharded(x, covType, param, sd2, ordinaryKriging, groups.size(), P, numThreads);
+  nestedKrig::LocalShard shard = shardOfRank(argv[1], groups, sharded.distribution, rank, x.n_cols);
+  shard.nugget = nugget;
+  sharded.runRank(communicator, shard);
+
+  const nestedKrig::RankStatistics& stats = sharded.statistics[rank];
+  std::cerr << "rank " << rank << ": rows=" << shard.X.n_rows << " groups=" << stats.groups
+            << " groupsReceived=" << stats.groupsReceived << " pairs=" << stats.pairs
+            << " bytesSent=" << stats.bytesSent << std::endl;
+  if (rank==0) {
+    std::cout << "mean,sd2" << std::endl;
+    std::cout.precision(17);
+    for(Long m=0; m<sharded.predmean.n_elem; ++m) std::cout << sharded.predmean[m] << "," << sharded.predsd2[m] << std::endl;
+  }
+  return 0;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  int status = 0;
+  try {
+    status = run(argc, argv);
+  }
+  catch(const std::exception& e) {
+    std::cerr << "shardedDriver: " << e.what() << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  MPI_Finalize();
+  return status;
+}
@@ -42,6 +42,84 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// vecchiaKrigingDirect
+Rcpp::List vecchiaKrigingDirect(const arma::mat& X, const arma::vec& Y, const std::vector<signed long>& clusters, const arma::mat& x, const std::string covType, const arma::vec& param, const double sd2, const std::string krigingType, const std::string tagAlgo, const long numThreadsZones, const long numThreads, const int verboseLevel, const int outputLevel, const Rcpp::IntegerVector globalOptions, const arma::vec nugget, const long numNeighbours);
+RcppExport SEXP _nestedKriging_vecchiaKrigingDirect(SEXP XSEXP, SEXP YSEXP, SEXP clustersSEXP, SEXP xSEXP, SEXP covTypeSEXP, SEXP paramSEXP, SEXP sd2SEXP, SEXP krigingTypeSEXP, SEXP tagAlgoSEXP, SEXP numThreadsZonesSEXP, SEXP numThreadsSEXP, SEXP verboseLevelSEXP, SEXP outputLevelSEXP, SEXP globalOptionsSEXP, SEXP nuggetSEXP, SEXP numNeighboursSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< const std::vector<signed long>& >::type clusters(clustersSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type covType(covTypeSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< const double >::type sd2(sd2SEXP);
+    Rcpp::traits::input_parameter< const std::string >::type krigingType(krigingTypeSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type tagAlgo(tagAlgoSEXP);
+    Rcpp::traits::input_parameter< const long >::type numThreadsZones(numThreadsZonesSEXP);
+    Rcpp::traits::input_parameter< const long >::type numThreads(numThreadsSEXP);
+    Rcpp::traits::input_parameter< const int >::type verboseLevel(verboseLevelSEXP);
+    Rcpp::traits::input_parameter< const int >::type outputLevel(outputLevelSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector >::type globalOptions(globalOptionsSEXP);
+    Rcpp::traits::input_parameter< const arma::vec >::type nugget(nuggetSEXP);
+    Rcpp::traits::input_parameter< const long >::type numNeighbours(numNeighboursSEXP);
+    rcpp_result_gen = Rcpp::wrap(vecchiaKrigingDirect(X, Y, clusters, x, covType, param, sd2, krigingType, tagAlgo, numThreadsZones, numThreads, verboseLevel, outputLevel, globalOptions, nugget, numNeighbours));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nestedKrigingPlanner
+Rcpp::List nestedKrigingPlanner(const long n, const long d, const long q, const std::string covType, const long numThreads, const double memoryBudget, const std::string krigingType, const int outputLevel);
+RcppExport SEXP _nestedKriging_nestedKrigingPlanner(SEXP nSEXP, SEXP dSEXP, SEXP qSEXP, SEXP covTypeSEXP, SEXP numThreadsSEXP, SEXP memoryBudgetSEXP, SEXP krigingTypeSEXP, SEXP outputLevelSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const long >::type n(nSEXP);
+    Rcpp::traits::input_parameter< const long >::type d(dSEXP);
+    Rcpp::traits::input_parameter< const long >::type q(qSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type covType(covTypeSEXP);
+    Rcpp::traits::input_parameter< const long >::type numThreads(numThreadsSEXP);
+    Rcpp::traits::input_parameter< const double >::type memoryBudget(memoryBudgetSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type krigingType(krigingTypeSEXP);
+    Rcpp::traits::input_parameter< const int >::type outputLevel(outputLevelSEXP);
+    rcpp_result_gen = Rcpp::wrap(nestedKrigingPlanner(n, d, q, covType, numThreads, memoryBudget, krigingType, outputLevel));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nestedKrigingSharded
+Rcpp::List nestedKrigingSharded(const arma::mat& X, const arma::vec& Y, const std::vector<signed long>& clusters, const arma::mat& x, const std::string covType, const arma::vec& param, const double sd2, const std::string krigingType, const std::string tagAlgo, const long numRanks, const long numThreads, const int verboseLevel, const arma::vec nugget);
+RcppExport SEXP _nestedKriging_nestedKrigingSharded(SEXP XSEXP, SEXP YSEXP, SEXP clustersSEXP, SEXP xSEXP, SEXP covTypeSEXP, SEXP paramSEXP, SEXP sd2SEXP, SEXP krigingTypeSEXP, SEXP tagAlgoSEXP, SEXP numRanksSEXP, SEXP numThreadsSEXP, SEXP verboseLevelSEXP, SEXP nuggetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< const std::vector<signed long>& >::type clusters(clustersSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type covType(covTypeSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< const double >::type sd2(sd2SEXP);
+    Rcpp::traits::input_parameter< const std::string >::type krigingType(krigingTypeSEXP);
+    Rcpp::traits::input_parameter< const std::string >::type tagAlgo(tagAlgoSEXP);
+    Rcpp::traits::input_parameter< const long >::type numRanks(numRanksSEXP);
+    Rcpp::traits::input_parameter< const long >::type numThreads(numThreadsSEXP);
+    Rcpp::traits::input_parameter< const int >::type verboseLevel(verboseLevelSEXP);
+    Rcpp::traits::input_parameter< const arma::vec >::type nugget(nuggetSEXP);
+    rcpp_result_gen = Rcpp::wrap(nestedKrigingSharded(X, Y, clusters, x, covType, param, sd2, krigingType, tagAlgo, numRanks, numThreads, verboseLevel, nugget));
+    return rcpp_result_gen;
+END_RCPP
+}
+// checkpointInfo
+Rcpp::List checkpointInfo(const std::string file);
+RcppExport SEXP _nestedKriging_checkpointInfo(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(checkpointInfo(file));
+    return rcpp_result_gen;
+END_RCPP
+}
 // looErrors
 Rcpp::List looErrors(const arma::mat& X, const arma::vec& Y, const std::vector<signed long>& clusters, const std::vector<signed long>& indices, const std::string covType, const arma::vec& param, const double sd2, const std::string krigingType, const std::string tagAlgo, const long numThreadsZones, const long numThreads, const int verboseLevel, const int outputLevel, const Rcpp::IntegerVector globalOptions, const arma::vec nugget, const std::string method);
 RcppExport SEXP _nestedKriging_looErrors(SEXP XSEXP, SEXP YSEXP, SEXP clustersSEXP, SEXP indicesSEXP, SEXP covTypeSEXP, SEXP paramSEXP, SEXP sd2SEXP, SEXP krigingTypeSEXP, SEXP tagAlgoSEXP, SEXP numThreadsZonesSEXP, SEXP numThreadsSEXP, SEXP verboseLevelSEXP, SEXP outputLevelSEXP, SEXP globalOptionsSEXP, SEXP nuggetSEXP, SEXP methodSEXP) {
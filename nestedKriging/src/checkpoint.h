@@ -0,0 +1,346 @@
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+//===============================================================================
+// unit containing checkpoints of long runs: named records of doubles written in a binary file, atomically (written
+// to path.tmp, flushed to disk, then renamed over path), so that a crash during a write leaves the previous
+// checkpoint intact. The file starts with a fingerprint of the inputs of the run, a checkpoint of another run is
+// refused, and ends with a checksum, a truncated or corrupted file is refused.
+// File layout (native endianness): "NKCKPT01", fingerprint, number of records, then for each record the length
+// of its name, the name, the number of values and the values, then the checksum of all preceding bytes.
+//
+// classes:
+// Fingerprint, CheckpointRecords, CheckpointSchedule
+// functions:
+// checkpoint_info
+//===============================================================================
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h> // MoveFileExA, std::rename does not replace an existing file
+#endif
+
+#include "common.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== Fingerprint
+// 64-bit FNV-1a hash of the inputs of a run
+
+class Fingerprint {
+  std::uint64_t hash = 14695981039346656037ULL;
+
+public:
+  void addBytes(const void* data, const std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(std::size_t k=0; k<size; ++k) { hash ^= bytes[k]; hash *= 1099511628211ULL; }
+  }
+
+  Fingerprint& add(const double value) { addBytes(&value, sizeof(value)); return *this; }
+  Fingerprint& add(const std::string& text) { addBytes(text.data(), text.size()); return add(static_cast<double>(text.size())); }
+  Fingerprint& add(const arma::mat& values) {
+    addBytes(values.memptr(), sizeof(double)*values.n_elem);
+    return add(static_cast<double>(values.n_rows)).add(static_cast<double>(values.n_cols));
+  }
+  template <typename Integer>
+  Fingerprint& add(const std::vector<Integer>& values) {
+    for(const Integer value: values) add(static_cast<double>(value));
+    return add(static_cast<double>(values.size()));
+  }
+
+  std::uint64_t value() const {
+    return hash;
+  }
+};
+
+//=================================================== CheckpointRecords
+// records by name; load returns false when there is no file and throws when the file is not a valid checkpoint,
+// loadRun also throws when the checkpoint was written by another run
+
+class CheckpointRecords {
+  using Values = std::vector<double>;
+  static constexpr std::size_t magicSize = 8;
+
+  struct Record {
+    Values values{};                 // owned values (loaded or set), or
+    const double* view = nullptr;    // values of a matrix that outlives the write, not copied
+    std::size_t size = 0;
+    const double* data() const { return (view!=nullptr) ? view : values.data(); }
+  };
+  std::map<std::string, Record> records{};
+
+  class Writer {
+    std::FILE* file;
+    Fingerprint checksum{};
+    bool ok = true;
+  public:
+    explicit Writer(std::FILE* file) : file(file) {}
+    void write(const void* data, const std::size_t size) {
+      ok = ok && (std::fwrite(data, 1, size, file)==size);
+      checksum.addBytes(data, size);
+    }
+    void number(const std::uint64_t value) { write(&value, sizeof(value)); }
+    bool finish() {
+      const std::uint64_t sum = checksum.value();
+      ok = ok && (std::fwrite(&sum, 1, sizeof(sum), file)==sizeof(sum)) && (std::fflush(file)==0);
+      return ok;
+    }
+  };
+
+  static std::uint64_t checksum(const std::vector<char>& buffer, const std::size_t size) {
+    Fingerprint fingerprint;
+    fingerprint.addBytes(buffer.data(), size);
+    return fingerprint.value();
+  }
+
+  class Reader {
+    const std::vector<char>& buffer;
+    const std::size_t end;
+    std::size_t position = 0;
+  public:
+    Reader(const std::vector<char>& buffer, const std::size_t end) : buffer(buffer), end(end) {}
+    void read(void* data, const std::size_t size) {
+      if (size > end - position) throw std::runtime_error("checkpoint: truncated record");
+      std::memcpy(data, buffer.data() + position, size);
+      position += size;
+    }
+    std::uint64_t number() { std::uint64_t value = 0; read(&value, sizeof(value)); return value; }
+    bool atEnd() const { return position==end; }
+  };
+
+  static const char* magic() {
+    return "NKCKPT01";
+  }
+
+public:
+  bool has(const std::string& name) const {
+    return records.find(name)!=records.end();
+  }
+
+  const Values& get(const std::string& name) const {
+    const auto found = records.find(name);
+    if (found==records.end()) throw std::runtime_error("checkpoint: missing record " + name);
+    return found->second.values;
+  }
+
+  arma::mat getMatrix(const std::string& name, const Long rows, const Long cols) const {
+    const Values& values = get(name);
+    if (values.size()!=rows*cols) throw std::runtime_error("checkpoint: record " + name + " has an unexpected size");
+    return arma::mat(values.data(), rows, cols);
+  }
+
+  void set(const std::string& name, Values&& values) {
+    Record& record = records[name];
+    record.values = std::move(values);
+    record.view = nullptr;
+    record.size = record.values.size();
+  }
+
+  void setView(const std::string& name, const arma::mat& values) {
+    // large results are written from their own memory, they must not change until the write
+    Record& record = records[name];
+    record.values.clear();
+    record.view = values.memptr();
+    record.size = values.n_elem;
+  }
+
+  static bool replaceFile(const std::string& from, const std::string& to) {
+    // atomic replacement of an existing file: rename on POSIX, MoveFileEx on Windows
+    #if defined(_WIN32)
+      return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)!=0;
+    #else
+      return std::rename(from.c_str(), to.c_str())==0;
+    #endif
+  }
+
+  void write(const std::string& path, const std::uint64_t fingerprint) const {
+    // streamed to path.tmp, then renamed over path once on disk
+    const std::string temporaryPath = path + ".tmp";
+    std::FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+    if (file==nullptr) throw std::runtime_error("checkpoint: cannot write " + temporaryPath);
+    Writer writer(file);
+    writer.write(magic(), magicSize);
+    writer.number(fingerprint);
+    writer.number(records.size());
+    for(const auto& record: records) {
+      writer.number(record.first.size());
+      writer.write(record.first.data(), record.first.size());
+      writer.number(record.second.size);
+      writer.write(record.second.data(), sizeof(double)*record.second.size);
+    }
+    bool written = writer.finish();
+    #if defined(__unix__) || defined(__APPLE__)
+      written = written && (fsync(fileno(file))==0);
+    #endif
+    written = (std::fclose(file)==0) && written;
+    if (!written || !replaceFile(temporaryPath, path)) {
+      std::remove(temporaryPath.c_str());
+      throw std::runtime_error("checkpoint: cannot write " + path);
+    }
+  }
+
+  bool load(const std::string& path, std::uint64_t& fingerprint) {
+    // any valid checkpoint, fingerprint gives the run that wrote it
+    records.clear();
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file==nullptr) return false;
+    std::vector<char> buffer{};
+    char chunk[65536];
+    for(std::size_t got = std::fread(chunk, 1, sizeof(chunk), file); got>0; got = std::fread(chunk, 1, sizeof(chunk), file))
+      buffer.insert(buffer.end(), chunk, chunk + got);
+    std::fclose(file);
+
+    const std::size_t checksumSize = sizeof(std::uint64_t);
+    if ((buffer.size() < magicSize + 2*sizeof(std::uint64_t) + checksumSize) || (std::memcmp(buffer.data(), magic(), magicSize)!=0))
+      throw std::runtime_error("checkpoint: " + path + " is not a checkpoint file");
+    const std::size_t payloadSize = buffer.size() - checksumSize;
+    std::uint64_t storedChecksum = 0;
+    std::memcpy(&storedChecksum, buffer.data() + payloadSize, checksumSize);
+    if (storedChecksum!=checksum(buffer, payloadSize)) throw std::runtime_error("checkpoint: " + path + " is corrupted");
+
+    Reader reader(buffer, payloadSize);
+    char ignoredMagic[magicSize];
+    reader.read(ignoredMagic, magicSize);
+    fingerprint = reader.number();
+    const std::uint64_t numberOfRecords = reader.number();
+    for(std::uint64_t r=0; r<numberOfRecords; ++r) {
+      std::string name(reader.number(), '\0');
+      reader.read(&name[0], name.size());
+      Values values(reader.number());
+      reader.read(values.data(), sizeof(double)*values.size());
+      set(name, std::move(values));
+    }
+    if (!reader.atEnd()) throw std::runtime_error("checkpoint: " + path + " has trailing bytes");
+    return true;
+  }
+
+  bool loadRun(const std::string& path, const std::uint64_t fingerprint) {
+    std::uint64_t fingerprintOfFile = 0;
+    if (!load(path, fingerprintOfFile)) return false;
+    if (fingerprintOfFile!=fingerprint)
+      throw std::runtime_error("checkpoint: " + path + " belongs to another run (other inputs), remove it or choose another file");
+    return true;
+  }
+
+  std::vector<std::string> names() const {
+    std::vector<std::string> result{};
+    for(const auto& record: records) result.push_back(record.first);
+    return result;
+  }
+
+  static std::vector<double> generatorState(const std::mt19937& generator) {
+    // the 624 words and the position of the Mersenne twister, exact in doubles
+    std::ostringstream oss;
+    oss << generator;
+    std::istringstream iss(oss.str());
+    std::vector<double> state{};
+    for(unsigned long word = 0; iss >> word; ) state.push_back(static_cast<double>(word));
+    return state;
+  }
+
+  static void restoreGenerator(std::mt19937& generator, const std::vector<double>& state) {
+    std::ostringstream oss;
+    for(const double word: state) oss << static_cast<unsigned long>(word) << " ";
+    std::istringstream iss(oss.str());
+    iss >> generator;
+    if (iss.fail()) throw std::runtime_error("checkpoint: invalid generator state");
+  }
+};
+
+//=================================================== CheckpointSchedule
+// file path and interval; the path is given by the environment variable NESTEDKRIGING_CHECKPOINT, else
+// nestedKriging.checkpoint in the working directory
+
+class CheckpointSchedule {
+  using Time = std::chrono::steady_clock::time_point;
+  double intervalSeconds = 0.0;
+  Time lastWrite = std::chrono::steady_clock::now();
+
+public:
+  std::string path{};
+  Long writes = 0;
+
+  CheckpointSchedule() = default;
+
+  explicit CheckpointSchedule(const double intervalSeconds) : intervalSeconds(intervalSeconds), path(defaultPath()) {}
+
+  static std::string defaultPath() {
+    const char* chosen = std::getenv("NESTEDKRIGING_CHECKPOINT");
+    return ((chosen==nullptr) || (*chosen=='\0')) ? "nestedKriging.checkpoint" : chosen;
+  }
+
+  bool enabled() const {
+    return intervalSeconds>0;
+  }
+
+  bool due() const {
+    const double elapsed = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - lastWrite).count();
+    return enabled() && (elapsed>=intervalSeconds);
+  }
+
+  void write(const CheckpointRecords& records, const std::uint64_t fingerprint) {
+    records.write(path, fingerprint);
+    lastWrite = std::chrono::steady_clock::now();
+    ++writes;
+  }
+};
+
+//=================================================== checkpoint_info
+// records and progress of a checkpoint file, without its values
+
+inline Rcpp::List checkpoint_info(const std::string& path) {
+  const std::string chosenPath = path.empty() ? CheckpointSchedule::defaultPath() : path;
+  CheckpointRecords records;
+  std::uint64_t fingerprint = 0;
+  if (!records.load(chosenPath, fingerprint)) throw std::runtime_error("checkpoint: no file " + chosenPath);
+  const double kind = records.has("kind") ? records.get("kind").at(0) : 0.0;
+
+  const std::vector<std::string> names = records.names();
+  std::vector<double> sizes{};
+  for(const std::string& name: names) sizes.push_back(static_cast<double>(records.get(name).size()));
+
+  Rcpp::NumericVector progress{};
+  if (kind==1.0) {
+    const std::vector<double>& groupDone = records.get("groupDone");
+    double groupsDone = 0.0;
+    for(const double done: groupDone) groupsDone += (done>0) ? 1.0 : 0.0;
+    progress = Rcpp::NumericVector::create(Rcpp::Named("groups") = static_cast<double>(groupDone.size()),
+      Rcpp::Named("groupsDone") = groupsDone, Rcpp::Named("pairColumnsDone") = records.get("pairColumnsDone").at(0));
+  }
+  else if (kind==2.0)
+    progress = Rcpp::NumericVector::create(Rcpp::Named("iteration") = records.get("iteration").at(0));
+
+  std::ostringstream hexFingerprint;
+  hexFingerprint << std::hex << fingerprint;
+  return Rcpp::List::create(
+    Rcpp::Named("file") = chosenPath,
+    Rcpp::Named("run") = (kind==1.0) ? "nestedKriging" : ((kind==2.0) ? "estimParam" : "unknown"),
+    Rcpp::Named("fingerprint") = hexFingerprint.str(),
+    Rcpp::Named("progress") = progress,
+    Rcpp::Named("records") = Rcpp::DataFrame::create(Rcpp::Named("name") = names, Rcpp::Named("values") = sizes,
+                                                     Rcpp::Named("stringsAsFactors") = false));
+}
+
+} //end namespace nestedKrig
+
+#endif /* CHECKPOINT_HPP */
@@ -0,0 +1,162 @@
+
+#ifndef COMPACTSUPPORT_HPP
+#define COMPACTSUPPORT_HPP
+
+//===============================================================================
+// unit containing sparse tools for compactly supported kernels (wendland1, wendland2, *_tapered)
+// correlations vanish beyond the support radius: a neighbour search gives the nonzero items of Ki,
+// a reverse Cuthill-McKee ordering gathers them near the diagonal, and Ki is factorized in LAPACK band
+// storage, (kd+1) x ni doubles instead of ni^2. Cross-correlations between far away groups are skipped.
+//
+// classes:
+// NeighbourSearch, BandedCholeskyFactorization, BandedKrigingPredictor
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "packedMatrix.h"
+#include "iterativeSolver.h"
+#include "kriging.h"
+#include <algorithm>
+#include <queue>
+
+namespace nestedKrig {
+
+//=================================================== NeighbourSearch
+// pairs of points at distance <= radius: both sets are sorted along the first coordinate,
+// each point of A only visits the points of B within a window of width 2*radius on this coordinate
+
+struct NeighbourSearch {
+  static std::vector<Long> sortedAlongFirstCoordinate(const Points& points) {
+    std::vector<Long> order(points.size());
+    for(Long i=0; i<order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](Long a, Long b) { return points[a][0] < points[b][0]; });
+    return order;
+  }
+
+  template <typename Visitor>
+  static void forEachPairWithinRadius(const Points& pointsA, const Points& pointsB, const double radius, Visitor visit) {
+    const std::vector<Long> orderA = sortedAlongFirstCoordinate(pointsA), orderB = sortedAlongFirstCoordinate(pointsB);
+    const PointDimension d = pointsA.d;
+    const double radius2 = radius*radius;
+    Long windowStart = 0;
+    for(Long a: orderA) {
+      const double ta = pointsA[a][0];
+      while ((windowStart<orderB.size()) && (pointsB[orderB[windowStart]][0] < ta-radius)) ++windowStart;
+      for(Long k=windowStart; (k<orderB.size()) && (pointsB[orderB[k]][0] <= ta+radius); ++k) {
+        const Long b = orderB[k];
+        double distance2 = 0.0;
+        for(PointDimension l=0; l<d; ++l) {
+          const double t = pointsA[a][l] - pointsB[b][l];
+          distance2 += t*t;
+        }
+        if (distance2<=radius2) visit(a, b);
+      }
+    }
+  }
+
+  static bool farApart(const Points& pointsA, const Points& pointsB, const double radius) {
+    // bounding boxes separated by more than radius along one coordinate: all cross-correlations are zero
+    if ((pointsA.size()==0) || (pointsB.size()==0)) return true;
+    for(PointDimension k=0; k<pointsA.d; ++k) {
+      double minA = pointsA[0][k], maxA = minA, minB = pointsB[0][k], maxB = minB;
+      for(Long i=1; i<pointsA.size(); ++i) { minA = std::min(minA, pointsA[i][k]); maxA = std::max(maxA, pointsA[i][k]); }
+      for(Long j=1; j<pointsB.size(); ++j) { minB = std::min(minB, pointsB[j][k]); maxB = std::max(maxB, pointsB[j][k]); }
+      if ((minB-maxA>radius) || (minA-maxB>radius)) return true;
+    }
+    return false;
+  }
+
+  static arma::mat crossCorrelationsTimes(const Covariance& kernel, const Points& pointsA, const Points& pointsB, const arma::mat& W) {
+    // k(A,B) W, only nonzero correlations are evaluated
+    arma::mat result(pointsA.size(), W.n_cols, arma::fill::zeros);
+    const double radius = kernel.supportRadius();
+    if (farApart(pointsA, pointsB, radius)) return result;
+    forEachPairWithinRadius(pointsA, pointsB, radius, [&](Long a, Long b) {
+      result.row(a) += kernel.crossCorrelation(pointsA, a, pointsB, b) * W.row(b);
+    });
+    return result;
+  }
+};
+
+//=================================================== BandedCholeskyFactorization
+// factorization policy for FactorizedKrigingPredictor, K is given by a KernelOperator (never filled densely)
+
+class BandedCholeskyFactorization {
+  std::vector<Long> order{};    // order[position] = point
+  std::vector<Long> position{}; // position[point]
+  arma::mat bands{};
+
+  void reverseCuthillMcKee(const std::vector<std::vector<Long> >& neighbours) {
+    // breadth-first numbering from a point of smallest degree in each connected component,
+    // neighbours visited by increasing degree, then reversed: small bandwidth for local graphs
+    const Long n = neighbours.size();
+    std::vector<Long> byDegree(n);
+    for(Long i=0; i<n; ++i) byDegree[i] = i;
+    std::stable_sort(byDegree.begin(), byDegree.end(), [&](Long a, Long b) { return neighbours[a].size() < neighbours[b].size(); });
+    std::vector<bool> visited(n, false);
+    order.clear(); order.reserve(n);
+    for(Long start: byDegree) {
+      if (visited[start]) continue;
+      std::queue<Long> toVisit;
+      toVisit.push(start); visited[start] = true;
+      while (!toVisit.empty()) {
+        const Long point = toVisit.front(); toVisit.pop();
+        order.push_back(point);
+        std::vector<Long> next{};
+        for(Long neighbour: neighbours[point]) if (!visited[neighbour]) { visited[neighbour] = true; next.push_back(neighbour); }
+        std::stable_sort(next.begin(), next.end(), [&](Long a, Long b) { return neighbours[a].size() < neighbours[b].size(); });
+        for(Long neighbour: next) toVisit.push(neighbour);
+      }
+    }
+    std::reverse(order.begin(), order.end());
+    position.resize(n);
+    for(Long k=0; k<n; ++k) position[order[k]] = k;
+  }
+
+public:
+  using CovMatrix = KernelOperator;
+
+  explicit BandedCholeskyFactorization(const KernelOperator& K) {
+    const Long n = K.n_rows();
+    const Points& points = K.getPoints();
+    std::vector<std::vector<Long> > neighbours(n);
+    NeighbourSearch::forEachPairWithinRadius(points, points, K.getKernel().supportRadius(), [&](Long a, Long b) {
+      if (a!=b) neighbours[a].push_back(b);
+    });
+    reverseCuthillMcKee(neighbours);
+    Long bandwidth = 0;
+    for(Long i=0; i<n; ++i)
+      for(Long j: neighbours[i]) bandwidth = std::max(bandwidth, (position[i]>position[j]) ? position[i]-position[j] : position[j]-position[i]);
+    bands.zeros(bandwidth+1, n);
+    for(Long i=0; i<n; ++i) {
+      bands.at(bandwidth, position[i]) = K.at(i,i);
+      for(Long j: neighbours[i])
+        if (position[i]<position[j]) bands.at(bandwidth+position[i]-position[j], position[j]) = K.at(i,j);
+    }
+    BandedCholesky::factorize(bands);
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    const Long n = order.size(), s = rhsThenSolution.n_cols;
+    arma::mat reordered(n, s);
+    for(Long c=0; c<s; ++c)
+      for(Long k=0; k<n; ++k) reordered.at(k, c) = rhsThenSolution.at(order[k], c);
+    BandedCholesky::solveFactorized(bands, reordered);
+    for(Long c=0; c<s; ++c)
+      for(Long k=0; k<n; ++k) rhsThenSolution.at(order[k], c) = reordered.at(k, c);
+  }
+
+  Long bandwidth() const {
+    return bands.n_rows-1;
+  }
+};
+
+//=================================================== BandedKrigingPredictor
+// simple or ordinary Kriging predictor of a submodel, compactly supported kernels
+
+using BandedKrigingPredictor = FactorizedKrigingPredictor<BandedCholeskyFactorization>;
+
+} //end namespace nestedKrig
+
+#endif /* COMPACTSUPPORT_HPP */
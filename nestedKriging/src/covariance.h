@@ -17,8 +17,10 @@
 //   covariance.fillCorrMatrix(K, pointsX); // fill K with correlations matrix of X
 
 #include <cmath> // exp, pow, sqrt...
+#include <limits>
 #include "common.h"
 #include "messages.h"
+#include "packedMatrix.h"
 
 //========================================================================== CHOSEN_STORAGE
 // choice of the storage for Points:
@@ -106,6 +108,17 @@ public:
 
   virtual double corr(const Point& x1,const Point& x2) const noexcept =0;
   virtual Double scaling_factor() const =0;
+
+  // Euclidean distance between rescaled points beyond which corr is exactly zero, cf. compactSupport.h
+  virtual double supportRadius() const {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  // corr is a product over dimensions of one-dimensional correlations, cf. kroneckerGrid.h
+  virtual bool isSeparable() const {
+    return true;
+  }
+
   virtual ~CorrelationFunction(){}
 };
 
@@ -126,6 +139,10 @@ public:
   virtual Double scaling_factor() const override {
     return 1.0L;
   }
+
+  virtual bool isSeparable() const override {
+    return false;
+  }
 };
 
 //-------------- Gauss
@@ -238,6 +255,93 @@ public:
   }
 };
 
+//-------------- Wendland, compactly supported
+// phi_{l,k}(r) with l = floor(d/2)+k+1 is positive definite in dimension d, and zero for r>=1
+// r is the Euclidean distance between rescaled points: param gives the support radius along each dimension
+
+struct Wendland {
+  static double phi(const double r, const double l, const int smoothness) noexcept {
+    if (r>=1.0) return 0.0;
+    if (smoothness==1) return std::pow(1.0-r, l+1)*((l+1)*r+1);
+    return std::pow(1.0-r, l+2)*(((l*l+4*l+3)*r + 3*l+6)*r + 3)/3.0;
+  }
+
+  static double exponent(const PointDimension d, const int smoothness) noexcept {
+    return static_cast<double>(d/2 + smoothness + 1);
+  }
+};
+
+class CorrWendland : public CorrelationFunction {
+  const int smoothness;
+  const double l;
+public:
+  CorrWendland(const PointDimension d, const int smoothness) :
+    CorrelationFunction(d), smoothness(smoothness), l(Wendland::exponent(d, smoothness)) {
+  }
+
+  virtual double corr(const Point& x1, const Point& x2) const noexcept override {
+    double s = 0.0;
+    for (PointDimension k = 0; k < d; ++k) {
+      double t = x1[k] - x2[k];
+      s += t*t;
+    }
+    return Wendland::phi(std::sqrt(s), l, smoothness);
+  }
+
+  virtual Double scaling_factor() const override {
+    return 1.0L;
+  }
+
+  virtual double supportRadius() const override {
+    return 1.0;
+  }
+
+  virtual bool isSeparable() const override {
+    return false;
+  }
+};
+
+//-------------- Tapered kernel
+// product of a kernel with a Wendland phi_{l,1} taper: stays positive definite, becomes compactly supported
+// the taper radius is given in the rescaled units of the tapered kernel
+
+class CorrTapered : public CorrelationFunction {
+  const CorrelationFunction* tapered;
+  const double l;
+public:
+  static constexpr double taperRadius = 6.0; // e.g. exp: corr(6)=0.0025, matern5_2: corr(6)=0.047
+
+  CorrTapered(const PointDimension d, const CorrelationFunction* tapered) :
+    CorrelationFunction(d), tapered(tapered), l(Wendland::exponent(d, 1)) {
+  }
+
+  virtual double corr(const Point& x1, const Point& x2) const noexcept override {
+    double s = 0.0;
+    for (PointDimension k = 0; k < d; ++k) {
+      double t = x1[k] - x2[k];
+      s += t*t;
+    }
+    const double taper = Wendland::phi(std::sqrt(s)/taperRadius, l, 1);
+    return (taper>0.0) ? taper*tapered->corr(x1, x2) : 0.0;
+  }
+
+  virtual Double scaling_factor() const override {
+    return tapered->scaling_factor();
+  }
+
+  virtual double supportRadius() const override {
+    return taperRadius;
+  }
+
+  virtual bool isSeparable() const override {
+    return false;
+  }
+
+  virtual ~CorrTapered() {
+    delete tapered;
+  }
+};
+
 //=========================================== CovarianceParameters
 // class containing covariance parameters
 // this class also do precomputations in order to fasten further covariance calculations
@@ -264,6 +368,11 @@ private:
     else if (covType.compare("matern5_2") == 0) {return new CorrMatern52(d);}
     else if (covType.compare("powexp") == 0) {return new CorrPowerexp(d, param);}
     else if (covType.compare("white_noise") == 0) {return new CorrWhiteNoise(d);}
+    else if (covType.compare("wendland1") == 0) {return new CorrWendland(d, 1);}
+    else if (covType.compare("wendland2") == 0) {return new CorrWendland(d, 2);}
+    else if (covType.compare("exp_tapered") == 0) {return new CorrTapered(d, new Correxp(d));}
+    else if (covType.compare("matern3_2_tapered") == 0) {return new CorrTapered(d, new CorrMatern32(d));}
+    else if (covType.compare("matern5_2_tapered") == 0) {return new CorrTapered(d, new CorrMatern52(d));}
     else {
       //screen.warning("covType wrongly written, using exponential kernel");
       return new Correxp(d);}
@@ -282,6 +391,28 @@ public:
     scalingFactors(createScalingFactors()) {
   }
 
+  int markovStateDimension() const {
+    // for d=1, exp, matern3_2, matern5_2 are Gauss-Markov processes with a state of dimension 1, 2, 3
+    // (value and derivatives), cf. markovSolver.h. Returns 0 when there is no such representation
+    if (d!=1) return 0;
+    if (dynamic_cast<const Correxp*>(corrFunction)!=nullptr) return 1;
+    if (dynamic_cast<const CorrMatern32*>(corrFunction)!=nullptr) return 2;
+    if (dynamic_cast<const CorrMatern52*>(corrFunction)!=nullptr) return 3;
+    return 0;
+  }
+
+  bool isSeparable() const {
+    return corrFunction->isSeparable();
+  }
+
+  bool hasCompactSupport() const {
+    return std::isfinite(corrFunction->supportRadius());
+  }
+
+  bool isOneDimensionalExponential() const {
+    return markovStateDimension()==1;
+  }
+
   CovarianceParameters() = delete;
 
   ~CovarianceParameters() {
@@ -382,8 +513,10 @@ public:
 
   Covariance(const CovarianceParameters& params) : params(params), corrFunction(params.corrFunction) {}
 
-  void fillAllocatedDiagonal(arma::mat& matrixToFill, const NuggetVector& nugget) const noexcept {
-    const Long n = matrixToFill.n_rows, nuggetSize=nugget.size();
+private:
+  template <typename MatrixType>
+  void fillDiagonal(MatrixType& matrixToFill, const Long n, const NuggetVector& nugget) const noexcept {
+    const Long nuggetSize=nugget.size();
     if (nuggetSize==0) {
       for (Long i = 0; i < n; ++i) matrixToFill.at(i,i) = diagonalValue;
       }
@@ -399,13 +532,81 @@ public:
     }
   }
 
+public:
+  inline double diagonalValueAt(const Long i, const NuggetVector& nugget) const noexcept {
+    // same diagonal as fillDiagonal, one item at a time: nugget is recycled if shorter than the matrix
+    const Long nuggetSize=nugget.size();
+    return (nuggetSize==0) ? diagonalValue : diagonalValue + nugget[i%nuggetSize]*params.inverseVariance;
+  }
+
+  inline double crossCorrelation(const Points& pointsA, const Long i, const Points& pointsB, const Long j) const noexcept {
+    return corrFunction->corr(pointsA[i], pointsB[j]);
+  }
+
+  inline double supportRadius() const {
+    return corrFunction->supportRadius();
+  }
+
+  inline double corrMatrixEntry(const Points& points, const Long i, const Long j, const NuggetVector& nugget) const noexcept {
+    // item (i,j) of the correlation matrix of points, used by matrix-free operators that never store it
+    return (i==j) ? diagonalValueAt(i, nugget) : corrFunction->corr(points[i], points[j]);
+  }
+
+  void fillAllocatedDiagonal(arma::mat& matrixToFill, const NuggetVector& nugget) const noexcept {
+    fillDiagonal(matrixToFill, matrixToFill.n_rows, nugget);
+  }
+
   void fillAllocatedCorrMatrix(arma::mat& matrixToFill, const Points& points, const NuggetVector& nugget) const noexcept {
     // noexcept, assume that matrixToFill is a correctly allocated square matrix of size points.size()
     fillAllocatedDiagonal(matrixToFill, nugget);
-    for (Long i = 0; i < points.size(); ++i) // parallelizable
+    for (Long i = 0; i < points.size(); ++i) // see the tiled version below for large matrices
       for (Long j = 0; j < i; ++j)
         matrixToFill.at(i,j) = matrixToFill.at(j,i) = corrFunction->corr(points[i], points[j]);
   }
+
+  static constexpr Long tileSize = 64; // 64 x 64 doubles = 32Kb tile
+  static constexpr Long minSizeForTiledFill = 2*tileSize;
+
+  void fillAllocatedCorrMatrix(arma::mat& matrixToFill, const Points& points, const NuggetVector& nugget, const int numThreads) const noexcept {
+    // tiled symmetric fill, for large matrices: each lower-triangle tile (I,J), J<=I, is computed column by column
+    // then mirrored blockwise in the upper tile (J,I) while it is still in cache. Tiles are spread across numThreads
+    const Long n = points.size();
+    if (n<minSizeForTiledFill) {
+      fillAllocatedCorrMatrix(matrixToFill, points, nugget);
+      return;
+    }
+    fillAllocatedDiagonal(matrixToFill, nugget);
+    const Long numberOfTiles = (n + tileSize - 1)/tileSize;
+    #pragma omp parallel for schedule(dynamic) collapse(2) num_threads(numThreads) if (numThreads>1)
+    for (Long I = 0; I < numberOfTiles; ++I)
+      for (Long J = 0; J < numberOfTiles; ++J) {
+        if (J<=I) {
+          const Long iBegin = I*tileSize, iEnd = std::min(n, iBegin+tileSize);
+          const Long jBegin = J*tileSize, jEnd = std::min(n, jBegin+tileSize);
+          for (Long j = jBegin; j < jEnd; ++j)
+            for (Long i = std::max(iBegin, j+1); i < iEnd; ++i)
+              matrixToFill.at(i,j) = corrFunction->corr(points[i], points[j]);
+          for (Long i = iBegin; i < iEnd; ++i)
+            for (Long j = jBegin; j < std::min(jEnd, i); ++j)
+              matrixToFill.at(j,i) = matrixToFill.at(i,j);
+        }
+      }
+  }
+  void fillAllocatedCorrMatrix(PackedSymMatrix& matrixToFill, const Points& points, const NuggetVector& nugget, const int numThreads) const noexcept {
+    // packed storage: only the upper triangle is computed, column j is contiguous, rows 0...j
+    // columns are never mirrored, they are spread across numThreads
+    const Long n = points.size();
+    fillDiagonal(matrixToFill, n, nugget);
+    double* values = matrixToFill.memptr();
+    #pragma omp parallel for schedule(dynamic, 16) num_threads(numThreads) if (numThreads>1 && n>=minSizeForTiledFill)
+    for (Long j = 0; j < n; ++j) {
+      double* column = values + PackedSymMatrix::index(0,j);
+      for (Long i = 0; i < j; ++i) column[i] = corrFunction->corr(points[i], points[j]);
+    }
+  }
+  void fillAllocatedCorrMatrix(PackedSymMatrix& matrixToFill, const Points& points, const NuggetVector& nugget) const noexcept {
+    fillAllocatedCorrMatrix(matrixToFill, points, nugget, 1);
+  }
   void fillAllocatedCrossCorrelations(arma::mat& matrixToFill, const Points& pointsA, const Points& pointsB) const noexcept {
     // noexcept, assume that matrixToFill is a correctly allocated matrix of size pointsA.size() x pointsB.size()
     // Warning: part of critical importance for the performance of the Algo
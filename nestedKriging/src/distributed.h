@@ -0,0 +1,535 @@
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+//===============================================================================
+// unit containing a sharded nested Kriging, for datasets exceeding the memory of one node. The groups are spread
+// over P ranks, group g being owned by rank g modulo P: each rank keeps only the points of its groups and runs
+// partA on them. Pairs (i,j) are distributed on a 2-D grid: groups are dealt into B blocks, B(B+1)/2 >= P, and
+// each pair of blocks goes to one rank, that receives the points and weights alpha of the groups of its two
+// blocks only, about 2N/B ~ N sqrt(2/P) groups instead of N. Columns of mean_M, kM and KM are reduced on rank 0,
+// which runs partC. Ranks talk through a Communicator: LocalCluster runs them as threads of this process (tests,
+// one node), MpiCommunicator runs them as MPI processes (mpirun -np P), when compiled with -DNESTEDKRIGING_MPI,
+// e.g. by the driver of inst/mpi, each process reading only the rows of its groups into a LocalShard.
+// The dense solver is used, without nested options (LOO, zones, cross-covariances, alternatives).
+//
+// classes:
+// Communicator, LocalCluster, MpiCommunicator, PairDistribution, LocalShard, RankStatistics, ShardedNestedKriging
+// functions:
+// forEachInParallel, sharded_nested_kriging
+//===============================================================================
+
+#if defined(NESTEDKRIGING_MPI)
+#include <mpi.h>
+#include <list>
+#endif
+
+#include "common.h"
+#include "messages.h"
+#include "covariance.h"
+#include "kriging.h"
+#include "packedMatrix.h"
+#include "splitter.h"
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== Communicator
+// point to point messages of doubles; send is buffered and returns at once, receive blocks until the message is
+// there, messages with the same source, destination and tag are received in the order they were sent
+
+class Communicator {
+public:
+  using Message = std::vector<double>;
+  double bytesSent = 0.0;
+
+  virtual ~Communicator() {}
+  virtual int rank() const = 0;
+  virtual int size() const = 0;
+  virtual void send(const int destination, const int tag, Message&& message) = 0;
+  virtual Message receive(const int source, const int tag) = 0;
+  virtual void completeSends() {} // before the buffers of sent messages are released
+
+  void sendMatrix(const int destination, const int tag, const arma::mat& matrix) {
+    // header n_rows, n_cols, then the values column by column
+    Message message(2 + matrix.n_elem);
+    message[0] = static_cast<double>(matrix.n_rows);
+    message[1] = static_cast<double>(matrix.n_cols);
+    std::copy(matrix.memptr(), matrix.memptr() + matrix.n_elem, message.begin() + 2);
+    bytesSent += 8.0*static_cast<double>(message.size());
+    send(destination, tag, std::move(message));
+  }
+
+  arma::mat receiveMatrix(const int source, const int tag) {
+    const Message message = receive(source, tag);
+    if (message.size()<2) throw std::runtime_error("sharded run: truncated message");
+    const Long rows = static_cast<Long>(message[0]), cols = static_cast<Long>(message[1]);
+    if (message.size()!=2+rows*cols) throw std::runtime_error("sharded run: inconsistent message size");
+    return arma::mat(message.data() + 2, rows, cols);
+  }
+};
+
+//=================================================== LocalCluster
+// P ranks as threads of this process, one mailbox by (source, destination, tag); when a rank throws, the other
+// ranks waiting for a message are released, and the first exception is rethrown by run
+
+class LocalCluster {
+  using Message = Communicator::Message;
+  using MailboxKey = std::tuple<int, int, int>; // source, destination, tag
+
+  const int numberOfRanks;
+  std::mutex mutex{};
+  std::condition_variable arrival{};
+  std::map<MailboxKey, std::deque<Message> > mailboxes{};
+  bool aborted = false;
+
+  class Rank : public Communicator {
+    LocalCluster& cluster;
+    const int myRank;
+  public:
+    Rank(LocalCluster& cluster, const int myRank) : cluster(cluster), myRank(myRank) {}
+    int rank() const override { return myRank; }
+    int size() const override { return cluster.numberOfRanks; }
+
+    void send(const int destination, const int tag, Message&& message) override {
+      {
+        std::lock_guard<std::mutex> lock(cluster.mutex);
+        cluster.mailboxes[MailboxKey(myRank, destination, tag)].push_back(std::move(message));
+      }
+      cluster.arrival.notify_all();
+    }
+
+    Message receive(const int source, const int tag) override {
+      std::unique_lock<std::mutex> lock(cluster.mutex);
+      std::deque<Message>& mailbox = cluster.mailboxes[MailboxKey(source, myRank, tag)];
+      cluster.arrival.wait(lock, [&]() { return cluster.aborted || !mailbox.empty(); });
+      if (mailbox.empty()) throw std::runtime_error("sharded run: aborted by another rank");
+      Message message = std::move(mailbox.front());
+      mailbox.pop_front();
+      return message;
+    }
+  };
+
+  void abort() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      aborted = true;
+    }
+    arrival.notify_all();
+  }
+
+public:
+  explicit LocalCluster(const int numberOfRanks) : numberOfRanks(numberOfRanks) {
+    if (numberOfRanks<1) throw std::runtime_error("the number of ranks must be positive");
+  }
+
+  void run(const std::function<void(Communicator&)>& rankProgram) {
+    std::vector<std::exception_ptr> exceptions(numberOfRanks);
+    std::vector<std::thread> threads{};
+    for(int r=0; r<numberOfRanks; ++r)
+      threads.emplace_back([&, r]() {
+        Rank communicator(*this, r);
+        try { rankProgram(communicator); }
+        catch(...) { exceptions[r] = std::current_exception(); abort(); }
+      });
+    for(std::thread& thread: threads) thread.join();
+    for(const std::exception_ptr& exception: exceptions) if (exception) std::rethrow_exception(exception);
+  }
+};
+
+//=================================================== MpiCommunicator
+// one MPI process by rank, e.g. MpiCommunicator communicator(MPI_COMM_WORLD); sharded.runRank(communicator, shard);
+// sent buffers are kept until completeSends
+
+#if defined(NESTEDKRIGING_MPI)
+class MpiCommunicator : public Communicator {
+  MPI_Comm communicator;
+  std::list<Message> pendingMessages{};
+  std::vector<MPI_Request> pendingRequests{};
+
+public:
+  explicit MpiCommunicator(MPI_Comm communicator) : communicator(communicator) {}
+  ~MpiCommunicator() { completeSends(); }
+
+  int rank() const override { int r = 0; MPI_Comm_rank(communicator, &r); return r; }
+  int size() const override { int s = 1; MPI_Comm_size(communicator, &s); return s; }
+
+  void send(const int destination, const int tag, Message&& message) override {
+    pendingMessages.push_back(std::move(message));
+    MPI_Request request;
+    MPI_Isend(pendingMessages.back().data(), static_cast<int>(pendingMessages.back().size()), MPI_DOUBLE,
+              destination, tag, communicator, &request);
+    pendingRequests.push_back(request);
+  }
+
+  Message receive(const int source, const int tag) override {
+    MPI_Status status;
+    MPI_Probe(source, tag, communicator, &status);
+    int count = 0;
+    MPI_Get_count(&status, MPI_DOUBLE, &count);
+    Message message(count);
+    MPI_Recv(message.data(), count, MPI_DOUBLE, source, tag, communicator, MPI_STATUS_IGNORE);
+    return message;
+  }
+
+  void completeSends() override {
+    if (!pendingRequests.empty())
+      MPI_Waitall(static_cast<int>(pendingRequests.size()), pendingRequests.data(), MPI_STATUSES_IGNORE);
+    pendingRequests.clear();
+    pendingMessages.clear();
+  }
+};
+#endif
+
+//=================================================== PairDistribution
+// group g owned by rank g modulo P, in block g modulo B; block pairs (a,b), a<=b, dealt to the ranks in packed order
+
+class PairDistribution {
+  const Long N;
+  const int P;
+  Long B = 1;
+  std::vector<int> ownerOfBlockPair{};
+
+  Long blockOfGroup(const Long g) const {
+    return g % B;
+  }
+
+public:
+  PairDistribution(const Long numberOfGroups, const int numberOfRanks) : N(numberOfGroups), P(numberOfRanks) {
+    while (B*(B+1)/2 < static_cast<Long>(P)) ++B;
+    ownerOfBlockPair.resize(B*(B+1)/2);
+    for(Long blockPair=0; blockPair<ownerOfBlockPair.size(); ++blockPair)
+      ownerOfBlockPair[blockPair] = static_cast<int>(blockPair % P);
+  }
+
+  Long numberOfBlocks() const {
+    return B;
+  }
+
+  int ownerOfGroup(const Long g) const {
+    return static_cast<int>(g % P);
+  }
+
+  int ownerOfPair(const Long i, const Long j) const {
+    const Long a = blockOfGroup(i), b = blockOfGroup(j);
+    return ownerOfBlockPair[(a<b) ? PackedSymMatrix::index(a,b) : PackedSymMatrix::index(b,a)];
+  }
+
+  std::vector<Long> groupsOfRank(const int rank) const {
+    std::vector<Long> groups{};
+    for(Long g=rank; g<N; g+=P) groups.push_back(g);
+    return groups;
+  }
+
+  std::vector<std::pair<Long, Long> > pairsOfRank(const int rank) const {
+    // pairs i<j, in a fixed order shared by the rank and rank 0
+    std::vector<std::pair<Long, Long> > pairs{};
+    for(Long j=1; j<N; ++j)
+      for(Long i=0; i<j; ++i) if (ownerOfPair(i,j)==rank) pairs.push_back(std::make_pair(i,j));
+    return pairs;
+  }
+
+  bool rankNeedsGroup(const int rank, const Long g) const {
+    // true when the rank owns a block pair involving the block of g
+    for(Long c=0; c<B; ++c) {
+      const Long a = blockOfGroup(g);
+      if (ownerOfBlockPair[(a<c) ? PackedSymMatrix::index(a,c) : PackedSymMatrix::index(c,a)]==rank) return true;
+    }
+    return false;
+  }
+};
+
+//=================================================== forEachInParallel
+// item(k) for k<numberOfItems on numThreads threads; exceptions must not leave the parallel region: kept by item,
+// the first one rethrown after the region (e.g. a submodel that is not positive definite)
+
+template <typename ItemFunction>
+void forEachInParallel(const Long numberOfItems, const int numThreads, ItemFunction item) {
+  std::vector<std::exception_ptr> errors(numberOfItems);
+  #pragma omp parallel for schedule(dynamic) num_threads(numThreads) if (numThreads>1)
+  for(Long k=0; k<numberOfItems; ++k) {
+    try { item(k); }
+    catch(...) { errors[k] = std::current_exception(); }
+  }
+  for(const std::exception_ptr& error: errors) if (error) std::rethrow_exception(error);
+}
+
+//=================================================== LocalShard
+// rows of the groups owned by one rank, with their group in 0..N-1 (the same numbering on all ranks), and the
+// nugget: none, one value for all, or one value by row. An MPI process fills it with its own rows only; ofRank
+// slices a dataset held by one process (LocalCluster)
+
+struct LocalShard {
+  arma::mat X{};
+  arma::vec Y{};
+  std::vector<Long> groupOfRow{};
+  arma::vec nugget{};
+
+  static LocalShard ofRank(const arma::mat& X, const arma::vec& Y, const std::vector<Long>& groupOfRow,
+                           const arma::vec& nugget, const PairDistribution& distribution, const int rank) {
+    // nugget by observation repeated as in Submodels, when shorter than n
+    std::vector<Long> rows{};
+    for(Long obs=0; obs<groupOfRow.size(); ++obs) if (distribution.ownerOfGroup(groupOfRow[obs])==rank) rows.push_back(obs);
+    const bool nuggetByRow = (nugget.n_elem>1);
+    LocalShard shard;
+    shard.X.set_size(rows.size(), X.n_cols);
+    shard.Y.set_size(rows.size());
+    shard.groupOfRow.resize(rows.size());
+    if (nuggetByRow) shard.nugget.set_size(rows.size());
+    else shard.nugget = nugget;
+    for(Long r=0; r<rows.size(); ++r) {
+      shard.X.row(r) = X.row(rows[r]);
+      shard.Y[r] = Y[rows[r]];
+      shard.groupOfRow[r] = groupOfRow[rows[r]];
+      if (nuggetByRow) shard.nugget[r] = nugget[rows[r] % nugget.n_elem];
+    }
+    return shard;
+  }
+};
+
+//=================================================== ShardedNestedKriging
+// runRank is the program of one rank, given the shard of its groups: no rank holds the whole dataset;
+// predictions are on rank 0
+
+struct RankStatistics {
+  Long groups = 0, groupsReceived = 0, pairs = 0;
+  double bytesSent = 0.0;
+};
+
+class ShardedNestedKriging {
+  enum Tag : int { groupTag = 1, resultTag = 2, pairTag = 3 };
+
+  const CovarianceParameters covParam;
+  const Covariance kernel;
+  const Points predictionPoints;
+  const double sd2;
+  const bool ordinaryKriging;
+  const int numThreads;
+  const Long d, N, q;
+
+  struct Group {
+    arma::mat rows{};         // ni x d, unscaled
+    std::unique_ptr<Points> points{}; // Points are not assignable
+    arma::mat alpha{};        // ni x q, Ki^-1 ki
+  };
+
+  static Covariance::NuggetVector nuggetOfGroup(const arma::vec& nugget, const std::vector<Long>& rows) {
+    // as in Submodels: none, one value for all, or one value by row of the shard
+    if ((nugget.n_elem==0) || ((nugget.n_elem==1) && (std::fabs(nugget[0])<1e-100))) return Covariance::NuggetVector{};
+    if (nugget.n_elem==1) return nugget;
+    Covariance::NuggetVector groupNugget(rows.size());
+    for(Long r=0; r<rows.size(); ++r) groupNugget[r] = nugget[rows[r]];
+    return groupNugget;
+  }
+
+  std::vector<std::vector<Long> > rowsOfOwnGroups(const LocalShard& shard, const int rank, const int P) const {
+    // rows of the shard by own group, own groups being rank, rank+P, ...
+    if ((shard.X.n_rows!=shard.Y.n_elem) || (shard.X.n_rows!=shard.groupOfRow.size()) || (shard.X.n_cols!=d)
+        || ((shard.nugget.n_elem>1) && (shard.nugget.n_elem!=shard.X.n_rows)))
+      throw std::runtime_error("sharded run: incompatible dimensions of the shard of rank " + std::to_string(rank));
+    std::vector<std::vector<Long> > rowsOfGroup(distribution.groupsOfRank(rank).size());
+    for(Long row=0; row<shard.groupOfRow.size(); ++row) {
+      const Long g = shard.groupOfRow[row];
+      if ((g>=N) || (distribution.ownerOfGroup(g)!=rank))
+        throw std::runtime_error("sharded run: rank " + std::to_string(rank) + " does not own group " + std::to_string(g));
+      rowsOfGroup[g/P].push_back(row);
+    }
+    for(Long k=0; k<rowsOfGroup.size(); ++k)
+      if (rowsOfGroup[k].empty()) throw std::runtime_error("sharded run: no row for group " + std::to_string(rank + k*P));
+    return rowsOfGroup;
+  }
+
+  arma::mat partA(const LocalShard& shard, const std::vector<Long>& rows, Group& group) const {
+    // q x 3 columns sent to rank 0: mean_M, kM, KM_gg
+    const Long ni = rows.size();
+    group.rows.set_size(ni, d);
+    arma::rowvec Yi(ni);
+    for(Long r=0; r<ni; ++r) {
+      group.rows.row(r) = shard.X.row(rows[r]);
+      Yi[r] = shard.Y[rows[r]];
+    }
+    group.points.reset(new Points(group.rows, covParam));
+    arma::mat Ki(ni, ni), ki(ni, q);
+    kernel.fillAllocatedCorrMatrix(Ki, *group.points, nuggetOfGroup(shard.nugget, rows));
+    kernel.fillAllocatedCrossCorrelations(ki, *group.points, predictionPoints);
+    ChosenPredictor krigingPredictor(Ki, ki, Yi, ordinaryKriging);
+    arma::rowvec mean_M(q);
+    std::vector<double> cov_MY(q), cov_MM(q);
+    krigingPredictor.fillResults(group.alpha, mean_M, cov_MY, cov_MM);
+    arma::mat columns(q, 3);
+    for(Long m=0; m<q; ++m) {
+      columns(m,0) = mean_M[m];
+      columns(m,1) = cov_MY[m];
+      columns(m,2) = cov_MM[m];
+    }
+    return columns;
+  }
+
+  void partC(const arma::mat& KMbyPair, const arma::mat& kMbyGroup, const arma::mat& mean_MbyGroup) {
+    // as Algo::partC, on rank 0
+    const arma::mat kMbyPoint = kMbyGroup.t(), mean_MbyPoint = mean_MbyGroup.t(); // N x q
+    arma::mat weights;
+    ChosenBatchedSolver::findWeights(KMbyPair, kMbyPoint, weights, numThreads);
+    predmean.set_size(q);
+    predsd2.set_size(q);
+    for(Long m = 0; m < q; ++m) {
+      predmean(m) = arma::dot(weights.col(m), mean_MbyPoint.col(m));
+      predsd2(m) = std::max(0.0, sd2*(1 - arma::dot(weights.col(m), kMbyPoint.col(m))));
+    }
+  }
+
+public:
+  const PairDistribution distribution;
+  arma::vec predmean{}, predsd2{};
+  std::vector<RankStatistics> statistics; // one item by rank, each filled by its rank
+
+  ShardedNestedKriging(const arma::mat& x, const std::string& covType, const arma::vec& param, const double sd2,
+                       const bool ordinaryKriging, const Long numberOfGroups, const int numberOfRanks, const int numThreads)
+    : covParam(x.n_cols, param, sd2, covType), kernel(covParam), predictionPoints(x, covParam), sd2(sd2),
+      ordinaryKriging(ordinaryKriging), numThreads((numThreads>1) ? numThreads : 1), d(x.n_cols), N(numberOfGroups),
+      q(x.n_rows), distribution(N, numberOfRanks), statistics(numberOfRanks) {
+    if (N<1) throw std::runtime_error("sharded run: no group");
+  }
+
+  void runRank(Communicator& communicator, const LocalShard& shard) {
+    const int rank = communicator.rank(), P = communicator.size();
+    if (static_cast<Long>(P)!=statistics.size()) throw std::runtime_error("sharded run: unexpected number of ranks");
+    RankStatistics& stats = statistics[rank];
+
+    // groups of this rank: rows of the shard, then partA, one group by thread
+    const std::vector<Long> myGroups = distribution.groupsOfRank(rank);
+    const std::vector<std::vector<Long> > rowsOfGroup = rowsOfOwnGroups(shard, rank, P);
+    std::map<Long, Group> groups{}; // own groups, then received ones
+    for(const Long g: myGroups) groups[g];
+    std::vector<arma::mat> columnsOfGroup(myGroups.size());
+    forEachInParallel(myGroups.size(), numThreads, [&](const Long k) {
+      columnsOfGroup[k] = partA(shard, rowsOfGroup[k], groups.at(myGroups[k]));
+    });
+    stats.groups = myGroups.size();
+
+    // points and alpha of own groups to the ranks whose block pairs need them, in increasing group order
+    for(const Long g: myGroups)
+      for(int s=0; s<P; ++s)
+        if ((s!=rank) && distribution.rankNeedsGroup(s, g)) {
+          communicator.sendMatrix(s, groupTag, groups[g].rows);
+          communicator.sendMatrix(s, groupTag, groups[g].alpha);
+        }
+    for(Long g=0; g<N; ++g)
+      if ((distribution.ownerOfGroup(g)!=rank) && distribution.rankNeedsGroup(rank, g)) {
+        const int owner = distribution.ownerOfGroup(g);
+        Group& group = groups[g];
+        group.rows = communicator.receiveMatrix(owner, groupTag);
+        group.alpha = communicator.receiveMatrix(owner, groupTag);
+        group.points.reset(new Points(group.rows, covParam));
+        ++stats.groupsReceived;
+      }
+
+    // partB on the pairs of this rank: KM_ij(m) = alpha_i(m)' K_ij alpha_j(m)
+    const std::vector<std::pair<Long, Long> > myPairs = distribution.pairsOfRank(rank);
+    arma::mat pairColumns(q, myPairs.size());
+    forEachInParallel(myPairs.size(), numThreads, [&](const Long p) {
+      const Group& groupI = groups.at(myPairs[p].first);
+      const Group& groupJ = groups.at(myPairs[p].second);
+      arma::mat Kij(groupI.points->size(), groupJ.points->size());
+      kernel.fillAllocatedCrossCorrelations(Kij, *groupI.points, *groupJ.points);
+      const arma::mat Zij = Kij * groupJ.alpha;
+      for(Long m=0; m<q; ++m) pairColumns(m,p) = arma::dot(groupI.alpha.col(m), Zij.col(m));
+    });
+    stats.pairs = myPairs.size();
+
+    // reduction on rank 0
+    for(Long k=0; k<myGroups.size(); ++k) communicator.sendMatrix(0, resultTag, columnsOfGroup[k]);
+    communicator.sendMatrix(0, pairTag, pairColumns);
+    if (rank==0) {
+      arma::mat KMbyPair(q, PackedSymMatrix::packedSize(N)), kMbyGroup(q, N), mean_MbyGroup(q, N);
+      for(int s=0; s<P; ++s) {
+        for(const Long g: distribution.groupsOfRank(s)) {
+          const arma::mat columns = communicator.receiveMatrix(s, resultTag);
+          mean_MbyGroup.col(g) = columns.col(0);
+          kMbyGroup.col(g) = columns.col(1);
+          KMbyPair.col(PackedSymMatrix::index(g,g)) = columns.col(2);
+        }
+        const std::vector<std::pair<Long, Long> > pairsOfS = distribution.pairsOfRank(s);
+        const arma::mat columns = communicator.receiveMatrix(s, pairTag);
+        for(Long p=0; p<pairsOfS.size(); ++p) KMbyPair.col(PackedSymMatrix::index(pairsOfS[p].first, pairsOfS[p].second)) = columns.col(p);
+      }
+      partC(KMbyPair, kMbyGroup, mean_MbyGroup);
+    }
+    communicator.completeSends();
+    stats.bytesSent = communicator.bytesSent;
+  }
+};
+
+//=================================================== sharded_nested_kriging
+// P ranks of a LocalCluster, numThreads threads by rank; returns mean, sd2, durations and statistics by rank
+
+inline Rcpp::List sharded_nested_kriging(const arma::mat& X, const arma::vec& Y, const ClusterVector& clusters,
+                                         const arma::mat& x, const std::string covType, const arma::vec& param,
+                                         const double sd2, const bool ordinaryKriging, const std::string tagAlgo,
+                                         const long numRanks, const long numThreads, const int verboseLevel,
+                                         const arma::vec& nugget) {
+  const Screen screen(verboseLevel);
+  Chrono chrono(screen, tagAlgo);
+  chrono.start();
+  if (numRanks<1) throw std::runtime_error("numRanks must be positive");
+  if ((X.n_rows!=Y.n_elem) || (X.n_rows!=clusters.size()) || (X.n_cols!=x.n_cols))
+    throw std::runtime_error("sharded run: incompatible dimensions of X, Y, clusters, x");
+  const CleanScheme<ClusterVector> cleanScheme(clusters);
+  std::vector<Long> groupOfRow(cleanScheme.size());
+  for(Long obs=0; obs<groupOfRow.size(); ++obs) groupOfRow[obs] = cleanScheme[obs];
+  ShardedNestedKriging sharded(x, covType, param, sd2, ordinaryKriging, cleanScheme.distinctValues(),
+                               static_cast<int>(numRanks), static_cast<int>(numThreads));
+  chrono.saveStep("preparation");
+  LocalCluster cluster(static_cast<int>(numRanks));
+  cluster.run([&](Communicator& communicator) {
+    // each rank keeps a copy of the rows of its groups only, as an MPI process reading its own rows
+    const int rank = communicator.rank();
+    sharded.runRank(communicator, LocalShard::ofRank(X, Y, groupOfRow, nugget, sharded.distribution, rank));
+  });
+  chrono.saveStep("ranks");
+  chrono.report.saveCounter("sharded.numRanks", numRanks);
+  chrono.report.saveCounter("sharded.numBlocks", sharded.distribution.numberOfBlocks());
+  const Long P = sharded.statistics.size();
+  std::vector<double> groups(P), groupsReceived(P), pairs(P), bytesSent(P);
+  for(Long r=0; r<P; ++r) {
+    groups[r] = sharded.statistics[r].groups;
+    groupsReceived[r] = sharded.statistics[r].groupsReceived;
+    pairs[r] = sharded.statistics[r].pairs;
+    bytesSent[r] = sharded.statistics[r].bytesSent;
+  }
+  const ChronoReport& report = chrono.report;
+  std::ostringstream versionInfos;
+  versionInfos << VERSION_CODE  << " built " << BUILT_ID;
+  return Rcpp::List::create(
+    Rcpp::Named("mean") = sharded.predmean,
+    Rcpp::Named("sd2") = sharded.predsd2,
+    Rcpp::Named("duration") = report.totalDuration,
+    Rcpp::Named("durationDetails") = Rcpp::DataFrame::create(
+      Rcpp::Named("stepName") = report.stepNames,
+      Rcpp::Named("duration") = report.durations),
+    Rcpp::Named("counterDetails") = Rcpp::DataFrame::create(
+      Rcpp::Named("counterName") = report.counterNames,
+      Rcpp::Named("value") = report.counterValues),
+    Rcpp::Named("ranks") = Rcpp::DataFrame::create(
+      Rcpp::Named("groups") = groups,
+      Rcpp::Named("groupsReceived") = groupsReceived,
+      Rcpp::Named("pairs") = pairs,
+      Rcpp::Named("bytesSent") = bytesSent),
+    Rcpp::Named("sourceCode") = versionInfos.str()
+  );
+}
+
+} //end namespace nestedKrig
+
+#endif /* DISTRIBUTED_HPP */
@@ -0,0 +1,217 @@
+
+#ifndef HARDWARECOUNTERS_HPP
+#define HARDWARECOUNTERS_HPP
+
+//===============================================================================
+// unit containing optional hardware performance counters (Linux perf_event_open), by step and by thread:
+// cycles, instructions, cache misses and branch misses, e.g. to check the cache locality of a Points storage.
+// Each thread of the inner parallel context opens its own counter group, counting its user-space work until the
+// end of the Algo; counters are read at each step. They are disabled by the Algo for zones run in a task pool,
+// where the threads of a zone are not known in advance. Counters may be unavailable (non-Linux platforms, containers
+// without perf events, perf_event_paranoid>2): the report is then empty and nothing else changes.
+// Limitation: groups are opened by the OS threads of one parallel region, without inherit, and row t assumes that
+// the thread number t of the later regions runs on the same OS thread, as in OpenMP runtimes that keep a pool of
+// threads, which the standard does not guarantee. Threads of nested regions (the Ki fill threads of partA when
+// there are more threads than groups) are new OS threads that are not counted; the per-thread breakdown is then
+// skipped and each step reports one row, thread -1, with the totals of the counted threads.
+//
+// classes:
+// HardwareCounterReport, ThreadHardwareCounters, HardwareCounters
+//===============================================================================
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#include "common.h"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== HardwareCounterReport
+// one row by step and by thread, or by step only (thread -1, totals), NaN for an event that the processor does not provide
+
+struct HardwareCounterReport {
+  static constexpr Long numberOfEvents = 4;
+  static constexpr int allThreads = -1;
+  using Values = std::array<double, numberOfEvents>; // cycles, instructions, cache misses, branch misses
+
+  std::vector<std::string> stepNames{};
+  std::vector<int> threads{};
+  std::vector<double> cycles{}, instructions{}, cacheMisses{}, branchMisses{};
+
+  void add(const std::string& stepName, const int thread, const Values& values) {
+    stepNames.push_back(stepName); threads.push_back(thread);
+    cycles.push_back(values[0]); instructions.push_back(values[1]);
+    cacheMisses.push_back(values[2]); branchMisses.push_back(values[3]);
+  }
+
+  void append(const HardwareCounterReport& other) {
+    stepNames.insert(stepNames.end(), other.stepNames.begin(), other.stepNames.end());
+    threads.insert(threads.end(), other.threads.begin(), other.threads.end());
+    cycles.insert(cycles.end(), other.cycles.begin(), other.cycles.end());
+    instructions.insert(instructions.end(), other.instructions.begin(), other.instructions.end());
+    cacheMisses.insert(cacheMisses.end(), other.cacheMisses.begin(), other.cacheMisses.end());
+    branchMisses.insert(branchMisses.end(), other.branchMisses.begin(), other.branchMisses.end());
+  }
+};
+
+//=================================================== ThreadHardwareCounters
+// one perf event group counting the thread that opens it, values scaled when the kernel multiplexes counters
+
+class ThreadHardwareCounters {
+  using Values = HardwareCounterReport::Values;
+  enum : int { closed = -1 };
+  std::array<int, HardwareCounterReport::numberOfEvents> descriptors;
+  int leader = closed;
+
+#if defined(__linux__)
+  static int openEvent(const unsigned long long config, const int groupLeader) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = (groupLeader==closed) ? 1 : 0;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // pid 0, cpu -1: the calling thread, on any cpu
+    return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, groupLeader, 0));
+  }
+#endif
+
+public:
+  ThreadHardwareCounters() {
+    descriptors.fill(closed);
+  }
+
+  ThreadHardwareCounters(const ThreadHardwareCounters&) = delete;
+  ThreadHardwareCounters& operator=(const ThreadHardwareCounters&) = delete;
+
+  ~ThreadHardwareCounters() {
+    #if defined(__linux__)
+      for(const int descriptor: descriptors) if (descriptor!=closed) close(descriptor);
+    #endif
+  }
+
+  void open() {
+    // to be called by the counted thread, events refused by the kernel are skipped
+    #if defined(__linux__)
+      const std::array<unsigned long long, HardwareCounterReport::numberOfEvents> configs {{
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES }};
+      for(Long event=0; event<configs.size(); ++event) {
+        const int descriptor = openEvent(configs[event], leader);
+        if (descriptor<0) continue;
+        descriptors[event] = descriptor;
+        if (leader==closed) leader = descriptor;
+      }
+      if (leader!=closed) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+    #endif
+  }
+
+  bool available() const {
+    return leader!=closed;
+  }
+
+  Values read() const {
+    Values values;
+    values.fill(std::numeric_limits<double>::quiet_NaN());
+    #if defined(__linux__)
+      if (leader==closed) return values;
+      // group format: number of events, time enabled, time running, then one value by opened event
+      std::array<unsigned long long, 3+HardwareCounterReport::numberOfEvents> buffer{};
+      if (::read(leader, buffer.data(), sizeof(buffer))<=0) return values;
+      const double scale = (buffer[2]>0) ? static_cast<double>(buffer[1])/static_cast<double>(buffer[2]) : 0.0;
+      Long position = 3;
+      for(Long event=0; event<descriptors.size(); ++event)
+        if (descriptors[event]!=closed) values[event] = scale*static_cast<double>(buffer[position++]);
+    #endif
+    return values;
+  }
+};
+
+//=================================================== HardwareCounters
+// counters of the threads 0..numThreads-1 of the parallel regions that follow, differences by step,
+// by thread or summed over the threads (totalsOnly, when nested regions run threads that are not counted)
+
+class HardwareCounters {
+  using Values = HardwareCounterReport::Values;
+  std::vector<ThreadHardwareCounters> threads{};
+  std::vector<Values> lastValues{};
+  bool anyAvailable = false;
+  bool onlyTotals = false;
+
+  std::vector<Values> readAll() const {
+    std::vector<Values> values(threads.size());
+    for(Long t=0; t<threads.size(); ++t) values[t] = threads[t].read();
+    return values;
+  }
+
+public:
+  HardwareCounterReport report{};
+
+  HardwareCounters(const bool enabled, const int numThreads, const bool totalsOnly) : onlyTotals(totalsOnly) {
+    if (!enabled) return;
+    const int numberOfThreads = (numThreads>1) ? numThreads : 1;
+    threads = std::vector<ThreadHardwareCounters>(numberOfThreads);
+    #pragma omp parallel num_threads(numberOfThreads)
+    {
+      #if defined(_OPENMP)
+        const int t = omp_get_thread_num();
+      #else
+        const int t = 0;
+      #endif
+      if (t<numberOfThreads) threads[t].open();
+    }
+    for(const ThreadHardwareCounters& counters: threads) anyAvailable = anyAvailable || counters.available();
+  }
+
+  bool available() const {
+    return anyAvailable;
+  }
+
+  bool totalsOnly() const {
+    return onlyTotals;
+  }
+
+  void start() {
+    if (anyAvailable) lastValues = readAll();
+  }
+
+  void saveStep(const std::string& stepName) {
+    if (!anyAvailable) return;
+    const std::vector<Values> values = readAll();
+    Values total;
+    total.fill(std::numeric_limits<double>::quiet_NaN());
+    for(Long t=0; t<threads.size(); ++t) {
+      if (!threads[t].available()) continue;
+      Values difference;
+      for(Long event=0; event<difference.size(); ++event) difference[event] = values[t][event] - lastValues[t][event];
+      if (!onlyTotals) report.add(stepName, static_cast<int>(t), difference);
+      for(Long event=0; event<total.size(); ++event)
+        if (!std::isnan(difference[event])) total[event] = (std::isnan(total[event]) ? 0.0 : total[event]) + difference[event];
+    }
+    if (onlyTotals) report.add(stepName, HardwareCounterReport::allThreads, total);
+    lastValues = values;
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* HARDWARECOUNTERS_HPP */
@@ -0,0 +1,297 @@
+
+#ifndef HIERARCHICALMATRIX_HPP
+#define HIERARCHICALMATRIX_HPP
+
+//===============================================================================
+// unit containing a hierarchical (HODLR) representation of large submodel correlation matrices
+// points are recursively bisected at the median of their largest spread coordinate; for smooth kernels, the
+// off-diagonal block between the two halves of a node is numerically of low rank, and is compressed by adaptive
+// cross approximation (ACA) from O((n1+n2) r) kernel evaluations. Leaves are dense Cholesky factors, each node is
+// inverted by Sherman-Morrison-Woodbury from its children: factorization O(n r^2 log^2 n), solve O(n r log n).
+// Ranks are capped at half the size of the smallest half of a node, where U V^T is as large as the block: a node
+// whose block is not of low rank (rough kernels, halves that are not well separated) falls back to a dense leaf.
+//
+// classes:
+// CompressionStatistics, CompressibleKernelOperator, AdaptiveCrossApproximation, HierarchicalMatrix,
+// HierarchicalFactorization, HierarchicalKrigingPredictor
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "kriging.h"
+#include "iterativeSolver.h" // KernelOperator
+#include <algorithm>
+#include <cmath>
+
+namespace nestedKrig {
+
+//=================================================== CompressionStatistics
+// number and largest rank of the compressed blocks, number of dense fall backs, reported in the chrono report
+
+struct CompressionStatistics {
+  Long compressedBlocks = 0, maxRank = 0, denseFallBacks = 0;
+
+  void add(const Long rank) {
+    ++compressedBlocks;
+    maxRank = std::max(maxRank, rank);
+  }
+
+  void add(const CompressionStatistics& other) {
+    compressedBlocks += other.compressedBlocks;
+    maxRank = std::max(maxRank, other.maxRank);
+    denseFallBacks += other.denseFallBacks;
+  }
+};
+
+//=================================================== CompressibleKernelOperator
+// KernelOperator carrying the relative tolerance of low-rank blocks, and their statistics once factorized
+
+class CompressibleKernelOperator : public KernelOperator {
+public:
+  double tolerance = 1e-8;
+  CompressionStatistics compression{};
+
+  using KernelOperator::KernelOperator;
+};
+
+//=================================================== AdaptiveCrossApproximation
+// partially pivoted ACA: block ~ U V^T, one residual row and one residual column per rank,
+// stops when the last rank-one term is below tolerance times the estimated Frobenius norm of the block,
+// converged is false when maxRank is reached before (the block is then not of low rank)
+
+struct AdaptiveCrossApproximation {
+  arma::mat U{}, V{};
+  bool converged = false;
+
+  template <typename Entry>
+  AdaptiveCrossApproximation(const Long m, const Long n, Entry entry, const double tolerance, const Long maxRank) {
+    std::vector<arma::vec> us{}, vs{};
+    std::vector<bool> usedRows(m, false);
+    double norm2 = 0.0;
+    Long pivotRow = 0;
+    converged = (m==0) || (n==0);
+    while ((!converged) && (us.size()<maxRank)) {
+      usedRows[pivotRow] = true;
+      arma::vec row(n);
+      for(Long j=0; j<n; ++j) row[j] = entry(pivotRow, j);
+      for(Long l=0; l<us.size(); ++l) row -= us[l][pivotRow]*vs[l];
+      Long pivotColumn = 0;
+      for(Long j=1; j<n; ++j) if (std::fabs(row[j])>std::fabs(row[pivotColumn])) pivotColumn = j;
+      const double pivot = row[pivotColumn];
+      if (pivot!=0.0) {
+        const arma::vec v = row/pivot;
+        arma::vec u(m);
+        for(Long i=0; i<m; ++i) u[i] = entry(i, pivotColumn);
+        for(Long l=0; l<us.size(); ++l) u -= vs[l][pivotColumn]*us[l];
+        for(Long l=0; l<us.size(); ++l) norm2 += 2*arma::dot(u, us[l])*arma::dot(v, vs[l]);
+        const double term2 = arma::dot(u, u)*arma::dot(v, v);
+        norm2 += term2;
+        us.push_back(u); vs.push_back(v);
+        if (term2<=tolerance*tolerance*norm2) converged = true;
+      }
+      // next pivot: largest unused item of the last column, or next unused row when this residual row vanishes
+      Long nextRow = m;
+      for(Long i=0; i<m; ++i)
+        if ((!usedRows[i]) && ((nextRow==m) || ((pivot!=0.0) && (std::fabs(us.back()[i])>std::fabs(us.back()[nextRow]))))) nextRow = i;
+      if (nextRow==m) converged = true; // all rows used: the approximation is exact
+      else pivotRow = nextRow;
+    }
+    U.set_size(m, us.size()); V.set_size(n, vs.size());
+    for(Long l=0; l<us.size(); ++l) { U.col(l) = us[l]; V.col(l) = vs[l]; }
+  }
+
+  Long rank() const {
+    return U.n_cols;
+  }
+};
+
+//=================================================== HierarchicalMatrix
+// symmetric HODLR matrix, A = diag(A_first, A_second) + W C at each node, with W = [U 0; 0 V], C = [0 V^T; U^T 0]
+// A^-1 B = D^-1 B - D^-1 W (I + C D^-1 W)^-1 C D^-1 B, where D^-1 is applied recursively by the children
+
+class HierarchicalMatrix {
+  struct Node {
+    Long begin = 0, end = 0;
+    Long first = 0, second = 0; // 0 for leaves, the root is never a child
+    bool denseFallBack = false; // leaf replacing a node whose block is not of low rank
+    arma::mat U{}, V{};         // A(first, second) ~ U V^T
+    arma::mat factor{};         // leaves: upper Cholesky factor
+    arma::mat DinvW{};          // D^-1 W
+    arma::mat capacitance{};    // I + C D^-1 W
+  };
+
+  const KernelOperator& K;
+  std::vector<Long> order{}; // order[position] = point, each node is a range of positions
+  std::vector<Node> nodes{};
+  CompressionStatistics compression{};
+
+  inline double entry(const Long positionA, const Long positionB) const {
+    return K.at(order[positionA], order[positionB]);
+  }
+
+  Long build(const Long begin, const Long end) {
+    const Long nodeIndex = nodes.size();
+    nodes.push_back(Node{});
+    nodes[nodeIndex].begin = begin; nodes[nodeIndex].end = end;
+    if (end-begin<=leafSize) return nodeIndex;
+    const Points& points = K.getPoints();
+    PointDimension axis = 0;
+    double bestSpread = -1.0;
+    for(PointDimension k=0; k<points.d; ++k) {
+      double minValue = points[order[begin]][k], maxValue = minValue;
+      for(Long r=begin+1; r<end; ++r) {
+        minValue = std::min(minValue, points[order[r]][k]);
+        maxValue = std::max(maxValue, points[order[r]][k]);
+      }
+      if (maxValue-minValue>bestSpread) { bestSpread = maxValue-minValue; axis = k; }
+    }
+    const Long middle = begin + (end-begin)/2;
+    std::nth_element(order.begin()+begin, order.begin()+middle, order.begin()+end,
+                     [&](Long a, Long b) { return points[a][axis] < points[b][axis]; });
+    const Long first = build(begin, middle);
+    const Long second = build(middle, end);
+    nodes[nodeIndex].first = first; nodes[nodeIndex].second = second;
+    return nodeIndex;
+  }
+
+  void factorizeLeaf(Node& node) const {
+    const Long n = node.end-node.begin;
+    arma::mat block(n, n);
+    for(Long b=0; b<n; ++b)
+      for(Long a=0; a<n; ++a) block.at(a,b) = entry(node.begin+a, node.begin+b);
+    if (!arma::chol(node.factor, block)) throw std::runtime_error("hierarchical matrix: diagonal block is not positive definite");
+  }
+
+  void releaseSubtree(const Long nodeIndex) {
+    Node& node = nodes[nodeIndex];
+    if (node.first!=0) { releaseSubtree(node.first); releaseSubtree(node.second); }
+    node = Node{};
+  }
+
+  void fallBackToDenseLeaf(Node& node) {
+    releaseSubtree(node.first);
+    releaseSubtree(node.second);
+    node.first = 0; node.second = 0;
+    node.denseFallBack = true;
+    factorizeLeaf(node);
+  }
+
+  void factorizeNode(Node& node, const double tolerance) {
+    const Node& first = nodes[node.first];
+    const Node& second = nodes[node.second];
+    const Long n1 = first.end-first.begin, n2 = second.end-second.begin;
+    const Long begin1 = first.begin, begin2 = second.begin;
+    const Long maxRank = std::max(static_cast<Long>(1), std::min(n1, n2)/2);
+    const AdaptiveCrossApproximation aca(n1, n2, [&](Long a, Long b) { return entry(begin1+a, begin2+b); },
+                                         tolerance, maxRank);
+    if (!aca.converged) {
+      fallBackToDenseLeaf(node);
+      return;
+    }
+    node.U = aca.U; node.V = aca.V;
+    const Long r = aca.rank();
+    if (r==0) return;
+    arma::mat W(n1+n2, 2*r, arma::fill::zeros);
+    W.submat(0, 0, n1-1, r-1) = node.U;
+    W.submat(n1, r, n1+n2-1, 2*r-1) = node.V;
+    node.DinvW = W;
+    solveChildren(node, node.DinvW);
+    node.capacitance = arma::eye<arma::mat>(2*r, 2*r) + timesC(node, node.DinvW);
+  }
+
+  static arma::mat timesC(const Node& node, const arma::mat& X) {
+    // C X = [V^T X_second; U^T X_first]
+    const Long n1 = node.U.n_rows, n = X.n_rows;
+    return arma::join_cols(arma::mat(node.V.t()*X.rows(n1, n-1)), arma::mat(node.U.t()*X.rows(0, n1-1)));
+  }
+
+  void solveChildren(const Node& node, arma::mat& rhsThenSolution) const {
+    const Long n1 = nodes[node.first].end-nodes[node.first].begin, n = rhsThenSolution.n_rows;
+    arma::mat X1 = rhsThenSolution.rows(0, n1-1), X2 = rhsThenSolution.rows(n1, n-1);
+    solveNode(nodes[node.first], X1);
+    solveNode(nodes[node.second], X2);
+    rhsThenSolution.rows(0, n1-1) = X1;
+    rhsThenSolution.rows(n1, n-1) = X2;
+  }
+
+  void solveNode(const Node& node, arma::mat& rhsThenSolution) const {
+    if (node.first==0) {
+      rhsThenSolution = arma::solve(arma::trimatu(node.factor),
+                          arma::solve(arma::trimatl(node.factor.t()), rhsThenSolution, arma::solve_opts::fast), arma::solve_opts::fast);
+      return;
+    }
+    solveChildren(node, rhsThenSolution);
+    if (node.U.n_cols==0) return;
+    rhsThenSolution -= node.DinvW*arma::solve(node.capacitance, timesC(node, rhsThenSolution));
+  }
+
+  void addStatistics(const Long nodeIndex) {
+    // blocks of the final tree, without those of the subtrees replaced by dense leaves
+    const Node& node = nodes[nodeIndex];
+    if (node.denseFallBack) ++compression.denseFallBacks;
+    if (node.first==0) return;
+    compression.add(node.U.n_cols);
+    addStatistics(node.first);
+    addStatistics(node.second);
+  }
+
+public:
+  static constexpr Long leafSize = 64;
+
+  HierarchicalMatrix(const KernelOperator& K, const double tolerance) : K(K), order(K.n_rows()) {
+    for(Long i=0; i<order.size(); ++i) order[i] = i;
+    if (order.empty()) return;
+    build(0, order.size());
+    // children are created after their parent: reverse order is bottom-up
+    for(Long nodeIndex=nodes.size(); nodeIndex>0; --nodeIndex) {
+      Node& node = nodes[nodeIndex-1];
+      if (node.first==0) factorizeLeaf(node);
+      else factorizeNode(node, tolerance);
+    }
+    addStatistics(0);
+  }
+
+
+  void solve(arma::mat& rhsThenSolution) const {
+    // A^-1 rhs, rows in the original numbering of points
+    const Long n = order.size(), s = rhsThenSolution.n_cols;
+    if (n==0) return;
+    arma::mat reordered(n, s);
+    for(Long c=0; c<s; ++c)
+      for(Long k=0; k<n; ++k) reordered.at(k, c) = rhsThenSolution.at(order[k], c);
+    solveNode(nodes[0], reordered);
+    for(Long c=0; c<s; ++c)
+      for(Long k=0; k<n; ++k) rhsThenSolution.at(order[k], c) = reordered.at(k, c);
+  }
+
+  const CompressionStatistics& statistics() const {
+    return compression;
+  }
+};
+
+//=================================================== HierarchicalFactorization
+// factorization policy for FactorizedKrigingPredictor, compression statistics are returned in K
+
+class HierarchicalFactorization {
+  HierarchicalMatrix matrix;
+
+public:
+  using CovMatrix = CompressibleKernelOperator;
+
+  explicit HierarchicalFactorization(CompressibleKernelOperator& K) : matrix(K, K.tolerance) {
+    K.compression.add(matrix.statistics());
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    matrix.solve(rhsThenSolution);
+  }
+};
+
+//=================================================== HierarchicalKrigingPredictor
+// simple or ordinary Kriging predictor of a submodel, HODLR compressed Ki
+
+using HierarchicalKrigingPredictor = FactorizedKrigingPredictor<HierarchicalFactorization>;
+
+} //end namespace nestedKrig
+
+#endif /* HIERARCHICALMATRIX_HPP */
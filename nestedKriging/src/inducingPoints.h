@@ -0,0 +1,179 @@
+
+#ifndef INDUCINGPOINTS_HPP
+#define INDUCINGPOINTS_HPP
+
+//===============================================================================
+// unit containing an inducing point engine (FITC and PITC), an alternative to nested Kriging for large data
+// inducing points u are centroids of slabs of each group, the prior covariance of Y(X) is approximated by
+// A = Q + Lambda with Q = K_fu K_uu^-1 K_uf and Lambda = diag(K - Q) (FITC) or blockdiag_i(K_ii - Q_ii) (PITC),
+// the blocks being the groups of the splitter. With B = K_uu + K_uf Lambda^-1 K_fu (m x m):
+//   mean(x) = beta + k_xu B^-1 K_uf Lambda^-1 (y - beta), var(x) = 1 - k_xu K_uu^-1 k_ux + k_xu B^-1 k_ux
+// (+ the ordinary Kriging term when the constant mean beta is estimated), cost O(n m^2 + sum ni^3) for PITC
+//
+// classes:
+// InducingPointsSystem, InducingPointsEngine
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "iterativeSolver.h" // BlockJacobiPreconditioner::orderAlongLargestSpread
+#include <cmath>
+
+namespace nestedKrig {
+
+//=================================================== InducingPointsSystem
+// sums over groups of K_uf Lambda^-1 [K_fu, y, 1] and 1^T Lambda^-1 [y, 1], for one approximation
+
+struct InducingPointsSystem {
+  arma::mat B;
+  arma::vec cY, cOne;
+  double sOneY = 0.0, sOneOne = 0.0;
+
+  explicit InducingPointsSystem(const Long m) : B(m, m, arma::fill::zeros), cY(m, arma::fill::zeros), cOne(m, arma::fill::zeros) {}
+
+  void add(const arma::mat& Kiu, const arma::mat& LambdaInvKiu, const arma::vec& yi, const arma::vec& LambdaInvOne) {
+    B += Kiu.t()*LambdaInvKiu;
+    cY += LambdaInvKiu.t()*yi;
+    cOne += LambdaInvKiu.t()*arma::ones<arma::vec>(yi.n_elem);
+    sOneY += arma::dot(LambdaInvOne, yi);
+    sOneOne += arma::accu(LambdaInvOne);
+  }
+
+  void add(const InducingPointsSystem& other) {
+    B += other.B; cY += other.cY; cOne += other.cOne; sOneY += other.sOneY; sOneOne += other.sOneOne;
+  }
+};
+
+//=================================================== InducingPointsEngine
+
+class InducingPointsEngine {
+  const Covariance& kernel;
+  const std::vector<Points>& splittedX;
+  const std::vector<arma::rowvec>& splittedY;
+  const std::vector<Covariance::NuggetVector>& splittedNuggets;
+  const bool ordinaryKriging;
+  Points inducingPoints{};
+  arma::mat Ruu{}; // K_uu = Ruu^T Ruu
+
+  void chooseInducingPoints(const Long pointsByGroup) {
+    // centroids of slabs of consecutive points along the coordinate of largest spread, in each group
+    const Long N = splittedX.size();
+    const PointDimension d = splittedX[0].d;
+    std::vector<std::vector<double> > centroids{};
+    for(Long i=0; i<N; ++i) {
+      const Points& points = splittedX[i];
+      const Long ni = points.size(), slabs = (pointsByGroup<ni) ? pointsByGroup : ni;
+      const std::vector<Long> order = BlockJacobiPreconditioner::orderAlongLargestSpread(points);
+      for(Long s=0; s<slabs; ++s) {
+        const Long begin = (s*ni)/slabs, end = ((s+1)*ni)/slabs;
+        std::vector<double> centroid(d, 0.0);
+        for(Long r=begin; r<end; ++r)
+          for(PointDimension k=0; k<d; ++k) centroid[k] += points[order[r]][k]/(end-begin);
+        centroids.push_back(centroid);
+      }
+    }
+    inducingPoints.reserve(centroids.size(), d);
+    for(Long u=0; u<centroids.size(); ++u)
+      for(PointDimension k=0; k<d; ++k) inducingPoints.cell(u, k) = centroids[u][k];
+  }
+
+  void addJitter(arma::mat& matrix) const {
+    for(Long i=0; i<matrix.n_rows; ++i) matrix.at(i,i) += jitter;
+  }
+
+public:
+  static constexpr double jitter = 1e-8; // added to K_uu and Lambda, whose conditioning degrades as u gets closer to X
+
+  InducingPointsEngine(const Covariance& kernel, const std::vector<Points>& splittedX, const std::vector<arma::rowvec>& splittedY,
+                       const std::vector<Covariance::NuggetVector>& splittedNuggets, const bool ordinaryKriging, const Long pointsByGroup)
+    : kernel(kernel), splittedX(splittedX), splittedY(splittedY), splittedNuggets(splittedNuggets), ordinaryKriging(ordinaryKriging) {
+    chooseInducingPoints(pointsByGroup);
+    arma::mat Kuu;
+    kernel.fillCorrMatrix(Kuu, inducingPoints, Covariance::NuggetVector{});
+    addJitter(Kuu);
+    if (!arma::chol(Ruu, Kuu)) throw std::runtime_error("inducing points: K_uu is not positive definite");
+  }
+
+  Long numberOfInducingPoints() const {
+    return inducingPoints.size();
+  }
+
+  void predict(const Points& predictionPoints, const double sd2, const int numThreads,
+               arma::vec& meanFITC, arma::vec& sd2FITC, arma::vec& meanPITC, arma::vec& sd2PITC) const {
+    // both approximations share K_iu, one pass over the groups
+    const Long N = splittedX.size(), m = inducingPoints.size();
+    InducingPointsSystem systemFITC(m), systemPITC(m);
+    bool allBlocksPositive = true;
+    #pragma omp parallel num_threads(numThreads) if (numThreads>1)
+    {
+      InducingPointsSystem localFITC(m), localPITC(m);
+      #pragma omp for schedule(dynamic)
+      for(Long i=0; i<N; ++i) {
+        arma::mat Kiu, Kii;
+        kernel.fillCrossCorrelations(Kiu, splittedX[i], inducingPoints);
+        kernel.fillCorrMatrix(Kii, splittedX[i], splittedNuggets[i]);
+        const arma::vec yi = splittedY[i].t();
+        const arma::mat Wi = arma::solve(arma::trimatl(Ruu.t()), Kiu.t(), arma::solve_opts::fast).t(); // Q_ii = Wi Wi^T
+        arma::mat LambdaPITC = Kii - Wi*Wi.t();
+        addJitter(LambdaPITC);
+        const arma::vec LambdaFITC = LambdaPITC.diag();
+        const arma::vec ones = arma::ones<arma::vec>(yi.n_elem);
+        arma::mat LambdaInvKiu = Kiu;
+        for(Long c=0; c<m; ++c)
+          for(Long r=0; r<yi.n_elem; ++r) LambdaInvKiu.at(r,c) /= LambdaFITC[r];
+        localFITC.add(Kiu, LambdaInvKiu, yi, ones/LambdaFITC);
+        arma::mat R;
+        if (!arma::chol(R, LambdaPITC)) {
+          #pragma omp atomic write
+          allBlocksPositive = false;
+          continue;
+        }
+        arma::mat rhs = arma::join_rows(Kiu, ones);
+        rhs = arma::solve(arma::trimatu(R), arma::solve(arma::trimatl(R.t()), rhs, arma::solve_opts::fast), arma::solve_opts::fast);
+        localPITC.add(Kiu, rhs.head_cols(m), yi, rhs.col(m));
+      }
+      #pragma omp critical
+      {
+        systemFITC.add(localFITC);
+        systemPITC.add(localPITC);
+      }
+    }
+    if (!allBlocksPositive) throw std::runtime_error("inducing points: PITC block is not positive definite");
+    arma::mat kxu;
+    kernel.fillCrossCorrelations(kxu, predictionPoints, inducingPoints);
+    predictFrom(systemFITC, kxu, sd2, meanFITC, sd2FITC);
+    predictFrom(systemPITC, kxu, sd2, meanPITC, sd2PITC);
+  }
+
+private:
+  void predictFrom(const InducingPointsSystem& system, const arma::mat& kxu, const double sd2, arma::vec& mean, arma::vec& sd2Pred) const {
+    const Long q = kxu.n_rows;
+    arma::mat RB;
+    if (!arma::chol(RB, arma::mat(system.B + Ruu.t()*Ruu))) throw std::runtime_error("inducing points: K_uu + K_uf Lambda^-1 K_fu is not positive definite");
+    auto solveB = [&](const arma::mat& rhs) {
+      return arma::mat(arma::solve(arma::trimatu(RB), arma::solve(arma::trimatl(RB.t()), rhs, arma::solve_opts::fast), arma::solve_opts::fast));
+    };
+    const arma::mat BinvKux = solveB(kxu.t()); // m x q
+    const arma::vec BinvcOne = solveB(system.cOne);
+    // 1^T A^-1 1 and 1^T A^-1 y, by Woodbury
+    const double oneAinvOne = system.sOneOne - arma::dot(system.cOne, BinvcOne);
+    const double beta = ordinaryKriging ? (system.sOneY - arma::dot(BinvcOne, system.cY))/oneAinvOne : 0.0;
+    const arma::vec BinvcResidual = solveB(system.cY - beta*system.cOne);
+    const arma::mat Vxu = arma::solve(arma::trimatl(Ruu.t()), kxu.t(), arma::solve_opts::fast); // ||Vxu_m||^2 = k_xu K_uu^-1 k_ux
+    mean.set_size(q); sd2Pred.set_size(q);
+    for(Long p=0; p<q; ++p) {
+      const arma::vec kux = kxu.row(p).t();
+      mean[p] = beta + arma::dot(kux, BinvcResidual);
+      double variance = 1.0 - arma::dot(Vxu.col(p), Vxu.col(p)) + arma::dot(kux, BinvKux.col(p));
+      if (ordinaryKriging) {
+        const double t = 1.0 - arma::dot(kux, BinvcOne);
+        variance += t*t/oneAinvOne;
+      }
+      sd2Pred[p] = sd2*std::max(0.0, variance);
+    }
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* INDUCINGPOINTS_HPP */
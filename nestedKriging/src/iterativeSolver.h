@@ -0,0 +1,235 @@
+
+#ifndef ITERATIVESOLVER_HPP
+#define ITERATIVESOLVER_HPP
+
+//===============================================================================
+// unit containing a matrix-free iterative solver, for submodels too large for a ni x ni matrix
+// K is never stored: products K*X are computed tile by tile from the kernel, and K X = B is solved
+// for all the right-hand sides at once by preconditioned conjugate gradients (one K*P product per iteration)
+// memory is O(ni*q) for the iterates and O(ni*blockSize) for the preconditioner, instead of O(ni^2)
+//
+// classes:
+// IterativeSolverStatistics, KernelOperator, BlockJacobiPreconditioner, PreconditionedConjugateGradient,
+// IterativeKrigingPredictor
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "kriging.h"
+#include <cmath>
+
+namespace nestedKrig {
+
+//=================================================== IterativeSolverStatistics
+// convergence summary of the solves of one or several submodels, reported in the chrono report
+
+struct IterativeSolverStatistics {
+  Long solves = 0, totalIterations = 0, maxIterations = 0;
+  double maxRelativeResidual = 0.0;
+
+  void add(const IterativeSolverStatistics& other) {
+    solves += other.solves;
+    totalIterations += other.totalIterations;
+    maxIterations = std::max(maxIterations, other.maxIterations);
+    maxRelativeResidual = std::max(maxRelativeResidual, other.maxRelativeResidual);
+  }
+};
+
+//=================================================== KernelOperator
+// stands for the correlation matrix of points (with nugget) without storing it
+// bind() plays the role of fillAllocatedCorrMatrix, multiply() evaluates the kernel by tiles
+
+class KernelOperator {
+  const Covariance* kernel = nullptr;
+  const Points* points = nullptr;
+  const Covariance::NuggetVector* nugget = nullptr;
+  Long dimension = 0;
+  int numThreads = 1;
+
+public:
+  IterativeSolverStatistics statistics{};
+
+  KernelOperator(const Long nrows, const Long ncols) : dimension(nrows) {
+    if (nrows!=ncols) throw std::runtime_error("kernel operator must be square");
+  }
+
+  void bind(const Covariance& kernelToUse, const Points& pointsToUse, const Covariance::NuggetVector& nuggetToUse, const int numThreadsToUse) {
+    // caution: kernel, points and nugget are referenced, they must outlive the operator
+    kernel = &kernelToUse; points = &pointsToUse; nugget = &nuggetToUse; numThreads = numThreadsToUse;
+    dimension = pointsToUse.size();
+  }
+
+  inline Long n_rows() const { return dimension; }
+  inline const Points& getPoints() const { return *points; }
+  inline const Covariance& getKernel() const { return *kernel; }
+
+  arma::mat toDense() const {
+    // for structured solvers falling back to a factorization, costs ni^2 doubles
+    arma::mat denseMatrix(dimension, dimension);
+    for(Long j=0; j<dimension; ++j)
+      for(Long i=0; i<dimension; ++i) denseMatrix.at(i,j) = at(i,j);
+    return denseMatrix;
+  }
+
+  inline double at(const Long i, const Long j) const {
+    return kernel->corrMatrixEntry(*points, i, j, *nugget);
+  }
+
+  arma::mat multiply(const arma::mat& X) const {
+    // row tiles are spread across threads, each thread owns its rows of the result: no reduction needed
+    constexpr Long tileSize = Covariance::tileSize;
+    const Long n = dimension, numberOfTiles = (n + tileSize - 1)/tileSize;
+    arma::mat result(n, X.n_cols, arma::fill::zeros);
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads) if (numThreads>1)
+    for (Long I = 0; I < numberOfTiles; ++I) {
+      const Long iBegin = I*tileSize, iEnd = std::min(n, iBegin+tileSize);
+      arma::mat tile{};
+      for (Long J = 0; J < numberOfTiles; ++J) {
+        const Long jBegin = J*tileSize, jEnd = std::min(n, jBegin+tileSize);
+        tile.set_size(iEnd-iBegin, jEnd-jBegin);
+        for (Long j = jBegin; j < jEnd; ++j)
+          for (Long i = iBegin; i < iEnd; ++i) tile.at(i-iBegin, j-jBegin) = at(i, j);
+        result.rows(iBegin, iEnd-1) += tile * X.rows(jBegin, jEnd-1);
+      }
+    }
+    return result;
+  }
+};
+
+//=================================================== BlockJacobiPreconditioner
+// sub-clusters: slabs of consecutive points along the coordinate of largest spread,
+// the diagonal block of K on each slab is factorized exactly (dense Cholesky, blockSize^2 doubles)
+
+class BlockJacobiPreconditioner {
+  std::vector<std::vector<Long> > blocks{};
+  std::vector<arma::mat> choleskyFactors{};
+
+public:
+  static std::vector<Long> orderAlongLargestSpread(const Points& points) {
+    const Long n = points.size();
+    PointDimension bestCoordinate = 0;
+    double bestSpread = -1.0;
+    for(PointDimension k=0; k<points.d; ++k) {
+      double minValue = points[0][k], maxValue = points[0][k];
+      for(Long i=1; i<n; ++i) {
+        minValue = std::min(minValue, points[i][k]);
+        maxValue = std::max(maxValue, points[i][k]);
+      }
+      if (maxValue-minValue > bestSpread) { bestSpread = maxValue-minValue; bestCoordinate = k; }
+    }
+    std::vector<Long> order(n);
+    for(Long i=0; i<n; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](Long a, Long b) { return points[a][bestCoordinate] < points[b][bestCoordinate]; });
+    return order;
+  }
+
+  static constexpr Long defaultBlockSize = 256;
+
+  explicit BlockJacobiPreconditioner(const KernelOperator& K, const Long blockSize = defaultBlockSize) {
+    const Long n = K.n_rows();
+    if (n==0) return;
+    const std::vector<Long> order = orderAlongLargestSpread(K.getPoints());
+    const Long numberOfBlocks = (n + blockSize - 1)/blockSize;
+    blocks.resize(numberOfBlocks);
+    choleskyFactors.resize(numberOfBlocks);
+    for(Long b=0; b<numberOfBlocks; ++b) {
+      const Long begin = b*blockSize, end = std::min(n, begin+blockSize);
+      blocks[b].assign(order.begin()+begin, order.begin()+end);
+      const std::vector<Long>& block = blocks[b];
+      const Long size = block.size();
+      arma::mat Kbb(size, size);
+      for(Long j=0; j<size; ++j)
+        for(Long i=0; i<size; ++i) Kbb.at(i,j) = K.at(block[i], block[j]);
+      if (!arma::chol(choleskyFactors[b], Kbb)) throw std::runtime_error("block Jacobi preconditioner: diagonal block is not positive definite");
+    }
+  }
+
+  void apply(const arma::mat& residuals, arma::mat& preconditioned) const {
+    // preconditioned = M^-1 residuals, M = block diagonal part of K
+    preconditioned.set_size(residuals.n_rows, residuals.n_cols);
+    const Long s = residuals.n_cols;
+    for(Long b=0; b<blocks.size(); ++b) {
+      const std::vector<Long>& block = blocks[b];
+      const Long size = block.size();
+      arma::mat z(size, s);
+      for(Long c=0; c<s; ++c)
+        for(Long i=0; i<size; ++i) z.at(i,c) = residuals.at(block[i], c);
+      const arma::mat& R = choleskyFactors[b];
+      z = arma::solve(arma::trimatl(R.t()), z, arma::solve_opts::fast);
+      z = arma::solve(arma::trimatu(R), z, arma::solve_opts::fast);
+      for(Long c=0; c<s; ++c)
+        for(Long i=0; i<size; ++i) preconditioned.at(block[i], c) = z.at(i,c);
+    }
+  }
+};
+
+//=================================================== PreconditionedConjugateGradient
+// all right-hand sides iterate in lockstep and share one kernel product K*P per iteration,
+// each column has its own step sizes and stops when its relative residual reaches the tolerance
+
+class PreconditionedConjugateGradient {
+  KernelOperator& K;
+  const BlockJacobiPreconditioner preconditioner;
+
+public:
+  using CovMatrix = KernelOperator;
+  static constexpr double tolerance = 1e-10; // relative residual |b - K x| / |b|
+  static constexpr Long minIterations = 50;
+
+  explicit PreconditionedConjugateGradient(KernelOperator& K, const Long blockSize = BlockJacobiPreconditioner::defaultBlockSize)
+    : K(K), preconditioner(K, blockSize) {}
+
+  void solve(arma::mat& rhsThenSolution) {
+    const Long n = rhsThenSolution.n_rows, s = rhsThenSolution.n_cols;
+    const Long maxIterations = (n>minIterations) ? n : minIterations;
+    arma::mat X(n, s, arma::fill::zeros), R = rhsThenSolution, Z{}, P{};
+    preconditioner.apply(R, Z);
+    P = Z;
+    std::vector<double> rz(s), rhsNorms(s), relativeResiduals(s, 0.0);
+    std::vector<Long> active{};
+    for(Long c=0; c<s; ++c) {
+      rz[c] = arma::dot(R.col(c), Z.col(c));
+      rhsNorms[c] = arma::norm(R.col(c));
+      if (rhsNorms[c]>0) { active.push_back(c); relativeResiduals[c] = 1.0; }
+    }
+    Long iterations = 0;
+    while ((!active.empty()) && (iterations<maxIterations)) {
+      ++iterations;
+      arma::mat activeP(n, active.size());
+      for(Long a=0; a<active.size(); ++a) activeP.col(a) = P.col(active[a]);
+      const arma::mat KP = K.multiply(activeP);
+      for(Long a=0; a<active.size(); ++a) {
+        const Long c = active[a];
+        const double alpha = rz[c]/arma::dot(activeP.col(a), KP.col(a));
+        X.col(c) += alpha*P.col(c);
+        R.col(c) -= alpha*KP.col(a);
+        relativeResiduals[c] = arma::norm(R.col(c))/rhsNorms[c];
+      }
+      preconditioner.apply(R, Z);
+      std::vector<Long> stillActive{};
+      for(Long c: active) {
+        if (relativeResiduals[c]<=tolerance) continue;
+        const double rzNew = arma::dot(R.col(c), Z.col(c));
+        P.col(c) = Z.col(c) + (rzNew/rz[c])*P.col(c);
+        rz[c] = rzNew;
+        stillActive.push_back(c);
+      }
+      active.swap(stillActive);
+    }
+    rhsThenSolution = X;
+    IterativeSolverStatistics thisSolve{};
+    thisSolve.solves = 1;
+    thisSolve.totalIterations = thisSolve.maxIterations = iterations;
+    for(Long c=0; c<s; ++c) thisSolve.maxRelativeResidual = std::max(thisSolve.maxRelativeResidual, relativeResiduals[c]);
+    K.statistics.add(thisSolve);
+  }
+};
+
+//=================================================== IterativeKrigingPredictor
+// simple or ordinary Kriging predictor of a submodel, K^-1 [k, 1] obtained by conjugate gradients
+
+using IterativeKrigingPredictor = FactorizedKrigingPredictor<PreconditionedConjugateGradient>;
+
+} //end namespace nestedKrig
+
+#endif /* ITERATIVESOLVER_HPP */
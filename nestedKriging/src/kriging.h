@@ -5,11 +5,15 @@
 //===============================================================================
 // unit containing tools for Linear Solvers and kriging Solvers
 // Classes:
-// ChosenSolver, KrigingPredictor , ChosenPredictor, ChosenLOOKrigingPredictor
+// ChosenSolver, MixedPrecisionCholesky, ChosenBatchedSolver, PackedBatchedSolver, MixedPrecisionBatchedSolver,
+// KrigingPredictor , ChosenPredictor, ChosenLOOKrigingPredictor, PackedKrigingPredictor, MixedPrecisionKrigingPredictor
 //===============================================================================
 
 #include "common.h"
 #include "leaveOneOut.h"
+#include "packedMatrix.h"
+#include "trace.h"
+#include <limits>
 
 namespace nestedKrig {
 
@@ -18,7 +22,7 @@ namespace nestedKrig {
 // please choose by setting: using ChosenSolver = (YourChosenClass) ; (see below)
 // solve matrix equation K * alpha = k in alpha
 
-enum class SolverChoice { InvSympd, Cholesky, Solve };
+enum class SolverChoice { InvSympd, Cholesky, Solve, PackedCholesky, MixedPrecision };
 #define CHOSEN_SOLVER SolverChoice::Solve
 
 template <SolverChoice SOLVER>
@@ -52,9 +56,152 @@ struct LinearSolver<SolverChoice::Solve>  {
   }
 };
 
+template <>
+struct LinearSolver<SolverChoice::PackedCholesky>  {
+  static void findWeights(PackedSymMatrix& K, const arma::mat& k, arma::mat& alpha)  {
+    // caution: K is overwritten by its Cholesky factor
+    PackedCholesky::factorize(K);
+    alpha = k;
+    PackedCholesky::solveFactorized(K, alpha);
+  }
+  static void findWeights(const arma::mat& K, const arma::mat& k, arma::mat& alpha)  {
+    PackedSymMatrix Kpacked(K);
+    findWeights(Kpacked, k, alpha);
+  }
+};
+
+//============================== Mixed precision Cholesky
+// the factorization is computed in float (half the memory traffic, twice the simd lanes),
+// double accuracy is restored by iterative refinement: x += K^-1 (b - K x), with residuals computed in double
+// falls back to a double factorization when the float one fails or when refinement stagnates (ill-conditioned K)
+
+class MixedPrecisionCholesky {
+  const arma::mat& K;
+  arma::fmat Rfloat{};
+  arma::mat Rdouble{};
+  bool useDouble = false;
+
+  static constexpr int maxRefinements = 10;
+  static constexpr double refinementTolerance = 1e-12; // relative size of the last correction
+  static constexpr double stagnationTolerance = 1e-8;  // accepted when refinement stagnates at double rounding level
+
+  void fallBackToDouble() {
+    useDouble = true;
+    Rdouble = arma::chol(K);
+  }
+
+  void solveInFloat(arma::mat& rhsThenSolution) const {
+    arma::fmat z = arma::conv_to<arma::fmat>::from(rhsThenSolution);
+    z = arma::solve(arma::trimatl(Rfloat.t()), z, arma::solve_opts::fast);
+    z = arma::solve(arma::trimatu(Rfloat), z, arma::solve_opts::fast);
+    rhsThenSolution = arma::conv_to<arma::mat>::from(z);
+  }
+
+  void solveInDouble(arma::mat& rhsThenSolution) const {
+    arma::mat z = arma::solve(arma::trimatl(Rdouble.t()), rhsThenSolution, arma::solve_opts::fast);
+    rhsThenSolution = arma::solve(arma::trimatu(Rdouble), z, arma::solve_opts::fast);
+  }
+
+  bool solveWithRefinement(arma::mat& rhsThenSolution) const {
+    arma::mat x = rhsThenSolution;
+    solveInFloat(x);
+    double previousCorrection = std::numeric_limits<double>::infinity(), correctionSize = previousCorrection;
+    for(int iteration=0; iteration<maxRefinements; ++iteration) {
+      arma::mat correction = rhsThenSolution - K*x;
+      solveInFloat(correction);
+      x += correction;
+      correctionSize = arma::abs(correction).max();
+      const double solutionSize = arma::abs(x).max();
+      if (correctionSize <= refinementTolerance*solutionSize) {
+        rhsThenSolution = x;
+        return true;
+      }
+      if (!(correctionSize < 0.5*previousCorrection)) break;
+      previousCorrection = correctionSize;
+    }
+    const bool accurateEnough = (correctionSize <= stagnationTolerance*arma::abs(x).max());
+    if (accurateEnough) rhsThenSolution = x;
+    return accurateEnough;
+  }
+
+public:
+  using CovMatrix = arma::mat;
+
+  explicit MixedPrecisionCholesky(const arma::mat& K) : K(K) {
+    const arma::fmat Kfloat = arma::conv_to<arma::fmat>::from(K);
+    if (!arma::chol(Rfloat, Kfloat)) fallBackToDouble();
+  }
+
+  void solve(arma::mat& rhsThenSolution) {
+    if ((!useDouble) && solveWithRefinement(rhsThenSolution)) return;
+    if (!useDouble) fallBackToDouble();
+    solveInDouble(rhsThenSolution);
+  }
+
+  bool usesDoubleFallBack() const {
+    return useDouble;
+  }
+};
+
+template <>
+struct LinearSolver<SolverChoice::MixedPrecision>  {
+  static void findWeights(const arma::mat& K, const arma::mat& k, arma::mat& alpha)  {
+    MixedPrecisionCholesky factorization(K);
+    alpha = k;
+    factorization.solve(alpha);
+  }
+};
 
 using ChosenSolver = LinearSolver<CHOSEN_SOLVER>;
 
+//============================== Batched Linear Solvers
+// solve the q independent systems K_m * weights.col(m) = k.col(m), m=0...q-1
+// K_m are given in a pair-major q x N(N+1)/2 matrix, K_m(i,j) = KbyPair(m, PackedSymMatrix::index(i,j)),
+// as written by partB. They are transposed lazily, by blocks of pointsByBlock pred points: for each pair (i,j),
+// one contiguous read of the block values, then each thread factorizes its own N x N matrices
+// MatrixType is the storage of the N x N matrices given to the solver, arma::mat or PackedSymMatrix
+// small batches stay serial (e.g. repeated LOO calls in parameter estimation), each solve is traced when tracer is enabled
+
+template <typename SolverType, typename MatrixType=arma::mat>
+struct BatchedLinearSolver {
+  static constexpr Long minBatchSizeForThreads = 16;
+  static constexpr Long pointsByBlock = 8; // a cache line of doubles per pair (i,j)
+
+  static void gatherBlock(const arma::mat& KbyPair, const Long N, const Long mBegin, std::vector<MatrixType>& Kblock) {
+    for(Long j=0; j<N; ++j)
+      for(Long i=0; i<=j; ++i) {
+        const double* valuesOfPair = KbyPair.colptr(PackedSymMatrix::index(i,j)) + mBegin;
+        for(Long b=0; b<Kblock.size(); ++b) Kblock[b].at(i,j) = Kblock[b].at(j,i) = valuesOfPair[b];
+      }
+  }
+
+  static void findWeights(const arma::mat& KbyPair, const arma::mat& k, arma::mat& weights, const int numThreads,
+                          Tracer& tracer = Tracer::off())  {
+    const Long q = KbyPair.n_rows, N = k.n_rows;
+    const Long numberOfBlocks = (q + pointsByBlock - 1)/pointsByBlock;
+    weights.set_size(N, q);
+    const bool useThreads = (q>=minBatchSizeForThreads) && (numThreads>1);
+    #pragma omp parallel for schedule(static) num_threads(numThreads) if (useThreads)
+    for(Long block=0; block<numberOfBlocks; ++block) {
+      const Long mBegin = block*pointsByBlock;
+      const Long blockSize = (q-mBegin < pointsByBlock)? q-mBegin : pointsByBlock;
+      std::vector<MatrixType> Kblock(blockSize, MatrixType(N, N));
+      gatherBlock(KbyPair, N, mBegin, Kblock);
+      for(Long b=0; b<blockSize; ++b) {
+        TraceScope traceScope(tracer, "partC", "solve", static_cast<long>(mBegin+b));
+        const arma::vec kColm = k.col(mBegin+b);
+        arma::mat weightsColm(N,1);
+        SolverType::findWeights(Kblock[b], kColm, weightsColm);
+        weights.col(mBegin+b) = weightsColm;
+      }
+    }
+  }
+};
+
+using ChosenBatchedSolver = BatchedLinearSolver<ChosenSolver>;
+using PackedBatchedSolver = BatchedLinearSolver<LinearSolver<SolverChoice::PackedCholesky>, PackedSymMatrix>;
+using MixedPrecisionBatchedSolver = BatchedLinearSolver<LinearSolver<SolverChoice::MixedPrecision> >;
+
 //============================================================================
 // Kriging predictors: from covariances (K, k) and observations Y
 // K has size ni x ni, k has size ni x q, weights has size ni x q
@@ -186,6 +333,8 @@ class ChosenPredictor {
   KrigingPredictor* krigingPredictor = nullptr;
 
 public:
+  using CovMatrix = arma::mat; // storage of the covariance matrix K given to the constructor
+
   ChosenPredictor(const arma::mat& K, const arma::mat& k, const type_Y& Y, const bool ordinaryKriging)  {
     if (ordinaryKriging) {krigingPredictor=new OrdinaryKrigingPredictor(K, k, Y); }
     else {krigingPredictor=new SimpleKrigingPredictor(K, k, Y); }
@@ -222,6 +371,10 @@ public:
 // To be solved:
 // -Weffc++ gives: "class has virtual functions and accessible non-virtual destructor"? but no inheritance here?
 class ChosenLOOKrigingPredictor {
+public:
+  using CovMatrix = arma::mat;
+
+private:
   const arma::mat& K;
   const arma::mat& k;
   const type_Y& Y;
@@ -296,6 +449,65 @@ public:
 
 };
 
+//---------------------------------------------------------------------------- FactorizedKrigingPredictor
+// simple or ordinary Kriging predictor using a factorization of K, given by the policy Factorization:
+// Factorization(K) factorizes K, Factorization::solve(B) replaces B by K^-1 B
+// for ordinary Kriging, K^-1 [k, 1] is obtained with one solve, without computing K^-1
+// no LOO support: use ChosenLOOKrigingPredictor
+
+struct PackedCholeskyFactorization {
+  // caution: K is overwritten by its Cholesky factor, so that no other ni x ni matrix is allocated
+  using CovMatrix = PackedSymMatrix;
+  const PackedSymMatrix& U;
+  explicit PackedCholeskyFactorization(PackedSymMatrix& K) : U(K) { PackedCholesky::factorize(K); }
+  void solve(arma::mat& rhsThenSolution) const { PackedCholesky::solveFactorized(U, rhsThenSolution); }
+};
+
+template <typename Factorization>
+class FactorizedKrigingPredictor {
+public:
+  using CovMatrix = typename Factorization::CovMatrix;
+
+private:
+  CovMatrix& K;
+  const arma::mat& k;
+  const type_Y& Y;
+  const bool ordinaryKriging;
+
+public:
+  FactorizedKrigingPredictor() = delete;
+
+  FactorizedKrigingPredictor(CovMatrix& K, const arma::mat& k, const type_Y& Y, bool ordinaryKriging, const LOOExclusions&)
+    : K(K), k(k), Y(Y), ordinaryKriging(ordinaryKriging) {
+  }
+
+  void fillResults(arma::mat& weights, arma::rowvec& mean_M, std::vector<double>& cov_MY, std::vector<double>& cov_MM) const {
+    const Long ni = k.n_rows, q = k.n_cols;
+    Factorization factorization(K);
+    if (!ordinaryKriging) {
+      weights = k;
+      factorization.solve(weights);
+      mean_M = Y * weights;
+      for(Long m=0;m<q;++m) cov_MM[m] = cov_MY[m] = arma::dot(k.col(m), weights.col(m));
+      return;
+    }
+    arma::mat solutions = arma::join_rows(k, arma::ones<arma::vec>(ni)); // [K^-1 k, K^-1 1]
+    factorization.solve(solutions);
+    const arma::vec Kinv_ones = solutions.col(q);
+    const arma::rowvec tmp1 = (1 - Kinv_ones.t() * k) / arma::accu(Kinv_ones);
+    weights = solutions.head_cols(q);
+    for(Long m=0;m<q;++m) {
+      weights.col(m) += tmp1(m) * Kinv_ones;
+      cov_MY[m] = arma::dot(k.col(m), weights.col(m));
+      cov_MM[m] = cov_MY[m] + tmp1(m) * arma::accu(weights.col(m));
+    }
+    mean_M = Y * weights;
+  }
+};
+
+using PackedKrigingPredictor = FactorizedKrigingPredictor<PackedCholeskyFactorization>;
+using MixedPrecisionKrigingPredictor = FactorizedKrigingPredictor<MixedPrecisionCholesky>;
+
 } //end namespace
 #endif /* KRIGING_HPP */
 
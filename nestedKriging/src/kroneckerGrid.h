@@ -0,0 +1,251 @@
+
+#ifndef KRONECKERGRID_HPP
+#define KRONECKERGRID_HPP
+
+//===============================================================================
+// unit containing fast paths for designs on regular or irregular grids (cartesian products of axes)
+// for a separable kernel, the correlation matrix of a grid is a Kronecker product C_{d-1} x ... x C_0 of small
+// one-dimensional correlation matrices (one by axis). With a constant nugget, K = Q (L + nugget) Q^T where
+// Q = x_k Q_k and L = x_k L_k come from the eigendecompositions of the C_k, so that K^-1 b only needs products
+// by the Q_k along each axis: O(ni sum_k n_k) instead of O(ni^3). Cross-correlations between two grids are
+// Kronecker products too, their products by a matrix use the same axis-wise products.
+//
+// classes:
+// GridStructure, KroneckerGrid, KroneckerFactorization, KroneckerKrigingPredictor
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "iterativeSolver.h"
+#include "kriging.h"
+#include <algorithm>
+
+namespace nestedKrig {
+
+//=================================================== GridStructure
+// detects whether points are exactly all the combinations of their distinct coordinates
+// grid order: dimension 0 varies fastest, gridIndex = i_0 + n_0 (i_1 + n_1 (i_2 + ...))
+
+class GridStructure {
+  std::vector<std::vector<double> > axes{};
+  std::vector<Long> gridIndexOfPoint{};
+  bool isGrid = false;
+
+  void detect(const Points& points) {
+    const Long n = points.size();
+    const PointDimension d = points.d;
+    if ((n==0) || (d==0)) return;
+    axes.resize(d);
+    Long gridSize = 1;
+    for(PointDimension k=0; k<d; ++k) {
+      std::vector<double>& axis = axes[k];
+      axis.resize(n);
+      for(Long i=0; i<n; ++i) axis[i] = points[i][k];
+      std::sort(axis.begin(), axis.end());
+      axis.erase(std::unique(axis.begin(), axis.end()), axis.end());
+      gridSize *= axis.size();
+      if (gridSize>n) return;
+    }
+    if (gridSize!=n) return;
+    std::vector<bool> alreadySeen(n, false);
+    gridIndexOfPoint.resize(n);
+    for(Long i=0; i<n; ++i) {
+      Long index = 0, stride = 1;
+      for(PointDimension k=0; k<d; ++k) {
+        const Long position = std::lower_bound(axes[k].begin(), axes[k].end(), points[i][k]) - axes[k].begin();
+        index += position*stride;
+        stride *= axes[k].size();
+      }
+      if (alreadySeen[index]) return;
+      alreadySeen[index] = true;
+      gridIndexOfPoint[i] = index;
+    }
+    isGrid = true;
+  }
+
+public:
+  GridStructure() {}
+
+  explicit GridStructure(const Points& points) {
+    detect(points);
+  }
+
+  inline bool valid() const { return isGrid; }
+  inline Long size() const { return gridIndexOfPoint.size(); }
+  inline PointDimension numberOfAxes() const { return axes.size(); }
+  inline const std::vector<double>& axis(const PointDimension k) const { return axes[k]; }
+  inline Long gridIndex(const Long point) const { return gridIndexOfPoint[point]; }
+
+  std::vector<Long> axisSizes() const {
+    std::vector<Long> sizes(axes.size());
+    for(PointDimension k=0; k<axes.size(); ++k) sizes[k] = axes[k].size();
+    return sizes;
+  }
+
+  bool hasSeveralAxes() const {
+    // a grid with only one non-trivial axis is a 1-D design: Kronecker products bring nothing
+    Long nonTrivialAxes = 0;
+    for(const std::vector<double>& axis: axes) if (axis.size()>1) ++nonTrivialAxes;
+    return isGrid && (nonTrivialAxes>=2);
+  }
+};
+
+//=================================================== KroneckerGrid
+// axis-wise tools. A column-major ni x q matrix is seen as a tensor of dimensions n_0 x ... x n_{d-1} x q
+
+struct KroneckerGrid {
+  static arma::mat axisCorrelations(const Covariance& kernel, const PointDimension d, const PointDimension k,
+                                    const std::vector<double>& axisA, const std::vector<double>& axisB) {
+    // one-dimensional factor of a separable kernel: correlation of two points differing only along axis k
+    Points pair;
+    pair.reserve(2, d);
+    for(PointDimension l=0; l<d; ++l) pair.cell(0,l) = pair.cell(1,l) = 0.0;
+    const Covariance::NuggetVector noNugget{};
+    arma::mat correlations(axisA.size(), axisB.size());
+    for(Long j=0; j<axisB.size(); ++j)
+      for(Long i=0; i<axisA.size(); ++i) {
+        pair.cell(0,k) = axisA[i];
+        pair.cell(1,k) = axisB[j];
+        correlations.at(i,j) = kernel.corrMatrixEntry(pair, 0, 1, noNugget);
+      }
+    return correlations;
+  }
+
+  static std::vector<arma::mat> crossFactors(const Covariance& kernel, const GridStructure& gridA, const GridStructure& gridB) {
+    const PointDimension d = gridA.numberOfAxes();
+    std::vector<arma::mat> factors(d);
+    for(PointDimension k=0; k<d; ++k) factors[k] = axisCorrelations(kernel, d, k, gridA.axis(k), gridB.axis(k));
+    return factors;
+  }
+
+  static arma::mat axisProducts(const std::vector<arma::mat>& factors, const arma::mat& input, std::vector<Long> dims) {
+    // (F_{d-1} x ... x F_0) input, in grid order, factors[k] has size m_k x dims[k]
+    const Long q = input.n_cols;
+    arma::mat current = input;
+    for(PointDimension k=0; k<factors.size(); ++k) {
+      const arma::mat& F = factors[k];
+      Long left = 1, right = q;
+      for(PointDimension l=0; l<k; ++l) left *= dims[l];
+      for(PointDimension l=k+1; l<dims.size(); ++l) right *= dims[l];
+      const Long nk = dims[k], mk = F.n_rows;
+      arma::mat next(left*mk*right, 1);
+      if (left==1) {
+        const arma::mat slices(current.memptr(), nk, right);
+        const arma::mat product = F*slices;
+        std::copy(product.memptr(), product.memptr()+mk*right, next.memptr());
+      }
+      else for(Long r=0; r<right; ++r) {
+        const arma::mat slice(current.memptr()+r*left*nk, left, nk);
+        const arma::mat product = slice*F.t();
+        std::copy(product.memptr(), product.memptr()+left*mk, next.memptr()+r*left*mk);
+      }
+      current = next;
+      dims[k] = mk;
+    }
+    return arma::mat(current.memptr(), current.n_elem/q, q);
+  }
+
+  static arma::mat crossCorrelationsTimes(const Covariance& kernel, const GridStructure& gridA, const GridStructure& gridB, const arma::mat& W) {
+    // k(A,B) W without filling the nA x nB cross-correlations
+    const Long nA = gridA.size(), nB = gridB.size(), q = W.n_cols;
+    arma::mat gridW(nB, q);
+    for(Long c=0; c<q; ++c)
+      for(Long i=0; i<nB; ++i) gridW.at(gridB.gridIndex(i), c) = W.at(i, c);
+    const arma::mat gridResult = axisProducts(crossFactors(kernel, gridA, gridB), gridW, gridB.axisSizes());
+    arma::mat result(nA, q);
+    for(Long c=0; c<q; ++c)
+      for(Long i=0; i<nA; ++i) result.at(i, c) = gridResult.at(gridA.gridIndex(i), c);
+    return result;
+  }
+
+  static void fillAllocatedCrossCorrelations(arma::mat& matrixToFill, const Covariance& kernel, const GridStructure& gridA, const GridStructure& gridB) {
+    // k(A,B) = F_{d-1} x ... x F_0 in grid orders: one product by item instead of one kernel evaluation
+    const std::vector<arma::mat> factors = crossFactors(kernel, gridA, gridB);
+    arma::mat kronecker = factors[0];
+    for(PointDimension k=1; k<factors.size(); ++k) kronecker = arma::kron(factors[k], kronecker);
+    for(Long j=0; j<gridB.size(); ++j) {
+      const Long gridj = gridB.gridIndex(j);
+      for(Long i=0; i<gridA.size(); ++i) matrixToFill.at(i,j) = kronecker.at(gridA.gridIndex(i), gridj);
+    }
+  }
+};
+
+//=================================================== KroneckerFactorization
+// factorization policy for FactorizedKrigingPredictor, K is given by a KernelOperator (never filled)
+// submodels that are not grids, or with a nugget that varies among points, fall back to a dense Cholesky factorization
+
+class KroneckerFactorization {
+  GridStructure grid;
+  std::vector<arma::mat> eigenvectors{}, eigenvectorsTransposed{};
+  arma::vec inverseEigenvalues{}; // 1/(eigenvalues of K), in grid order
+  arma::mat denseFactor{};
+  bool useDense = false;
+
+  void fallBackToDense(const KernelOperator& K) {
+    useDense = true;
+    denseFactor = arma::chol(K.toDense());
+  }
+
+  static bool constantDiagonal(const KernelOperator& K) {
+    for(Long i=1; i<K.n_rows(); ++i) if (K.at(i,i)!=K.at(0,0)) return false;
+    return true;
+  }
+
+public:
+  using CovMatrix = KernelOperator;
+
+  explicit KroneckerFactorization(const KernelOperator& K) : grid(K.getPoints()) {
+    if ((!grid.valid()) || (!constantDiagonal(K))) {
+      fallBackToDense(K);
+      return;
+    }
+    const PointDimension d = grid.numberOfAxes();
+    eigenvectors.resize(d); eigenvectorsTransposed.resize(d);
+    arma::vec eigenvalues = arma::ones<arma::vec>(1);
+    for(PointDimension k=0; k<d; ++k) {
+      const arma::mat Ck = KroneckerGrid::axisCorrelations(K.getKernel(), d, k, grid.axis(k), grid.axis(k));
+      arma::vec eigenvaluesk;
+      arma::eig_sym(eigenvaluesk, eigenvectors[k], Ck);
+      eigenvectorsTransposed[k] = eigenvectors[k].t();
+      for(Long i=0; i<eigenvaluesk.n_elem; ++i) eigenvaluesk[i] = std::max(eigenvaluesk[i], 0.0); // C_k is semi-definite
+      arma::vec product(eigenvalues.n_elem*eigenvaluesk.n_elem);
+      for(Long j=0; j<eigenvaluesk.n_elem; ++j)
+        for(Long i=0; i<eigenvalues.n_elem; ++i) product[i+j*eigenvalues.n_elem] = eigenvalues[i]*eigenvaluesk[j];
+      eigenvalues = product;
+    }
+    const double nugget = K.at(0,0) - 1.0;
+    inverseEigenvalues = 1/(eigenvalues + nugget);
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    if (useDense) {
+      arma::mat z = arma::solve(arma::trimatl(denseFactor.t()), rhsThenSolution, arma::solve_opts::fast);
+      rhsThenSolution = arma::solve(arma::trimatu(denseFactor), z, arma::solve_opts::fast);
+      return;
+    }
+    const Long n = grid.size(), s = rhsThenSolution.n_cols;
+    arma::mat gridB(n, s);
+    for(Long c=0; c<s; ++c)
+      for(Long i=0; i<n; ++i) gridB.at(grid.gridIndex(i), c) = rhsThenSolution.at(i, c);
+    const std::vector<Long> dims = grid.axisSizes();
+    arma::mat rotated = KroneckerGrid::axisProducts(eigenvectorsTransposed, gridB, dims);
+    for(Long c=0; c<s; ++c)
+      for(Long i=0; i<n; ++i) rotated.at(i, c) *= inverseEigenvalues[i];
+    const arma::mat gridSolution = KroneckerGrid::axisProducts(eigenvectors, rotated, dims);
+    for(Long c=0; c<s; ++c)
+      for(Long i=0; i<n; ++i) rhsThenSolution.at(i, c) = gridSolution.at(grid.gridIndex(i), c);
+  }
+
+  bool usesDenseFallBack() const {
+    return useDense;
+  }
+};
+
+//=================================================== KroneckerKrigingPredictor
+// simple or ordinary Kriging predictor of a gridded submodel, separable kernels
+
+using KroneckerKrigingPredictor = FactorizedKrigingPredictor<KroneckerFactorization>;
+
+} //end namespace nestedKrig
+
+#endif /* KRONECKERGRID_HPP */
@@ -0,0 +1,314 @@
+
+#ifndef MARKOVSOLVER_HPP
+#define MARKOVSOLVER_HPP
+
+//===============================================================================
+// unit containing an exact O(n) solver for the one-dimensional exponential kernel
+// exp(-|s-t|) is the correlation of an Ornstein-Uhlenbeck process, which is Markov: once points are sorted,
+// the inverse T of the correlation matrix C is tridiagonal. With the diagonal D (nuggets), K = C + D = C (I + T D),
+// and K^-1 b = D^-1 (D^-1 + T)^-1 T b, where D^-1 + T is a symmetric positive definite tridiagonal matrix.
+// cross-correlations products C(A,B) W are also obtained in O(nA + nB) by two sweeps over sorted points.
+// matern3_2 and matern5_2 are Markov with a state (value, derivatives) of dimension 2 and 3: a Kalman filter
+// gives K = L S L^T (innovations), and K^-1 b is obtained by the filter followed by its adjoint, in O(ni) too.
+//
+// classes:
+// MarkovExp, MarkovExpFactorization, MarkovExpKrigingPredictor, StateSpaceMaternFactorization, StateSpaceKrigingPredictor
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include "iterativeSolver.h"
+#include "kriging.h"
+#include <cmath>
+
+namespace nestedKrig {
+
+static_assert(tinyNuggetOffDiag==0.0, "the Markov structure of the exponential kernel requires exact off-diagonal correlations");
+
+//=================================================== MarkovExp
+// tools on one-dimensional rescaled points, where the kernel is exactly exp(-|s-t|)
+
+struct MarkovExp {
+  static std::vector<Long> sortedOrder(const Points& points) {
+    std::vector<Long> order(points.size());
+    for(Long i=0; i<order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](Long a, Long b) { return points[a][0] < points[b][0]; });
+    return order;
+  }
+
+  static arma::mat crossProduct(const Points& pointsA, const Points& pointsB, const arma::mat& W) {
+    return crossProduct(pointsA, sortedOrder(pointsA), pointsB, sortedOrder(pointsB), W);
+  }
+
+  static arma::mat crossProduct(const Points& pointsA, const std::vector<Long>& orderA, const Points& pointsB,
+                                const std::vector<Long>& orderB, const arma::mat& W) {
+    // C(A,B) W, forward sweep for the points of B on the left of each a, backward sweep for those on the right
+    // the running sums are damped by exp(-gap) between consecutive positions, so that no exp(+t) is ever computed
+    // orderA, orderB: sortedOrder of the points, computed once by group when called for many pairs
+    const Long nA = pointsA.size(), nB = pointsB.size(), q = W.n_cols;
+    arma::mat result(nA, q, arma::fill::zeros);
+    arma::rowvec accumulated(q);
+
+    accumulated.zeros();
+    double position = 0.0;
+    Long b = 0;
+    for(Long a: orderA) {
+      const double ta = pointsA[a][0];
+      while ((b<nB) && (pointsB[orderB[b]][0] <= ta)) {
+        const double tb = pointsB[orderB[b]][0];
+        if (b>0) accumulated *= std::exp(-(tb-position));
+        accumulated += W.row(orderB[b]);
+        position = tb;
+        ++b;
+      }
+      if (b>0) result.row(a) += accumulated*std::exp(-(ta-position));
+    }
+
+    accumulated.zeros();
+    b = nB;
+    for(Long k=nA; k>0; --k) {
+      const Long a = orderA[k-1];
+      const double ta = pointsA[a][0];
+      while ((b>0) && (pointsB[orderB[b-1]][0] > ta)) {
+        const double tb = pointsB[orderB[b-1]][0];
+        if (b<nB) accumulated *= std::exp(-(position-tb));
+        accumulated += W.row(orderB[b-1]);
+        position = tb;
+        --b;
+      }
+      if (b<nB) result.row(a) += accumulated*std::exp(-(position-ta));
+    }
+    return result;
+  }
+};
+
+//=================================================== DenseFallBack
+// dense Cholesky factorization, for the designs where the sweeps of the Markov solvers are undefined
+
+struct DenseFallBack {
+  arma::mat factor{};
+
+  void factorize(const KernelOperator& K) {
+    factor = arma::chol(K.toDense());
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    arma::mat z = arma::solve(arma::trimatl(factor.t()), rhsThenSolution, arma::solve_opts::fast);
+    rhsThenSolution = arma::solve(arma::trimatu(factor), z, arma::solve_opts::fast);
+  }
+};
+
+//=================================================== MarkovExpFactorization
+// factorization policy for FactorizedKrigingPredictor, K is given by a KernelOperator (never filled)
+// duplicated points make T undefined: in this case, a dense Cholesky factorization is used instead
+
+class MarkovExpFactorization {
+  std::vector<Long> order{};
+  arma::vec precisionDiag{}, precisionOffDiag{}; // T, in sorted order
+  arma::vec nuggets{};                            // D, in sorted order
+  arma::vec ldlDiag{}, ldlLower{};                // D^-1 + T = L diag(ldlDiag) L^T
+  DenseFallBack dense{};
+  bool useDense = false;
+
+  void fallBackToDense(const KernelOperator& K) {
+    useDense = true;
+    dense.factorize(K);
+  }
+
+  bool buildTridiagonalSystem(const KernelOperator& K) {
+    const Long n = K.n_rows();
+    const Points& points = K.getPoints();
+    precisionDiag.set_size(n); precisionOffDiag.zeros(n); nuggets.set_size(n);
+    precisionDiag.fill(1.0);
+    for(Long k=0; k<n; ++k) {
+      nuggets[k] = K.at(order[k], order[k]) - 1.0;
+      if (!(nuggets[k]>0)) return false;
+    }
+    for(Long k=0; k+1<n; ++k) {
+      const double gap = points[order[k+1]][0] - points[order[k]][0];
+      if (!(gap>0)) return false;
+      const double rho = std::exp(-gap), oneMinusRho2 = -std::expm1(-2*gap);
+      precisionOffDiag[k] = -rho/oneMinusRho2;
+      precisionDiag[k] += rho*rho/oneMinusRho2;
+      precisionDiag[k+1] += rho*rho/oneMinusRho2;
+    }
+    ldlDiag.set_size(n); ldlLower.zeros(n);
+    ldlDiag[0] = 1/nuggets[0] + precisionDiag[0];
+    for(Long k=0; k+1<n; ++k) {
+      ldlLower[k] = precisionOffDiag[k]/ldlDiag[k];
+      ldlDiag[k+1] = 1/nuggets[k+1] + precisionDiag[k+1] - ldlLower[k]*precisionOffDiag[k];
+    }
+    return true;
+  }
+
+public:
+  using CovMatrix = KernelOperator;
+
+  explicit MarkovExpFactorization(const KernelOperator& K) {
+    order = MarkovExp::sortedOrder(K.getPoints());
+    if ((K.n_rows()==0) || (!buildTridiagonalSystem(K))) fallBackToDense(K);
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    if (useDense) {
+      dense.solve(rhsThenSolution);
+      return;
+    }
+    const Long n = order.size(), s = rhsThenSolution.n_cols;
+    std::vector<double> y(n);
+    for(Long c=0; c<s; ++c) {
+      double* column = rhsThenSolution.colptr(c);
+      for(Long k=0; k<n; ++k) { // y = T b
+        y[k] = precisionDiag[k]*column[order[k]];
+        if (k>0) y[k] += precisionOffDiag[k-1]*column[order[k-1]];
+        if (k+1<n) y[k] += precisionOffDiag[k]*column[order[k+1]];
+      }
+      for(Long k=1; k<n; ++k) y[k] -= ldlLower[k-1]*y[k-1]; // z = (D^-1 + T)^-1 y
+      for(Long k=0; k<n; ++k) y[k] /= ldlDiag[k];
+      for(Long k=n-1; k>0; --k) y[k-1] -= ldlLower[k-1]*y[k];
+      for(Long k=0; k<n; ++k) column[order[k]] = y[k]/nuggets[k]; // x = D^-1 z
+    }
+  }
+
+  bool usesDenseFallBack() const {
+    return useDense;
+  }
+};
+
+//=================================================== MarkovExpKrigingPredictor
+// simple or ordinary Kriging predictor of a submodel in O(ni q), for d=1 and covType="exp"
+
+using MarkovExpKrigingPredictor = FactorizedKrigingPredictor<MarkovExpFactorization>;
+
+//=================================================== StateSpaceMaternFactorization
+// Matern nu = StateDimension - 1/2 with unit lengthscale (rescaled points), state z = (f, f', ...), f = H z
+// the transition between sorted points at distance gap is exp(F gap) = exp(-gap) (I + N gap + N^2 gap^2/2 ...),
+// where N = F + I is nilpotent. Forward (filter): e_k = b_k - H A_k m_{k-1}, m_k = A_k m_{k-1} + G_k e_k, which is e = L^-1 b.
+// Backward (adjoint of the filter): x = L^-T S^-1 e, thus x = K^-1 b
+// duplicated or nearly duplicated points (zero gap, or a predicted variance of f below the tiny nugget: the point is
+// determined by the previous ones) make the transition singular: in this case, a dense Cholesky factorization is used
+
+template <int StateDimension>
+class StateSpaceMaternFactorization {
+  static constexpr Long p = StateDimension;
+  std::vector<Long> order{};
+  arma::mat transitions{};          // column k: A_k (p x p, column major), from sorted point k-1 to k
+  arma::mat gains{};                // column k: G_k
+  arma::vec innovationVariances{};  // S_k
+  DenseFallBack dense{};
+  bool useDense = false;
+
+  static arma::mat nilpotentDrift() {
+    if (p==2) return arma::mat("1 1; -1 -1");
+    return arma::mat("1 1 0; 0 1 1; -1 -3 -2");
+  }
+
+  static arma::mat stationaryCovariance() {
+    if (p==2) return arma::eye<arma::mat>(2, 2);
+    arma::mat Pinf("3 0 -1; 0 1 0; -1 0 3");
+    return Pinf/3.0;
+  }
+
+  static arma::mat transition(const double gap) {
+    const arma::mat N = nilpotentDrift();
+    arma::mat term = arma::eye<arma::mat>(p, p), A = term;
+    for(Long k=1; k<p; ++k) {
+      term = term*N*(gap/k);
+      A += term;
+    }
+    return A*std::exp(-gap);
+  }
+
+  bool buildFilter(const KernelOperator& K) {
+    const Long n = K.n_rows();
+    const Points& points = K.getPoints();
+    transitions.set_size(p*p, n); gains.set_size(p, n); innovationVariances.set_size(n);
+    const arma::mat Pinf = stationaryCovariance(), I = arma::eye<arma::mat>(p, p);
+    arma::mat P = Pinf;
+    for(Long k=0; k<n; ++k) {
+      arma::mat A = I, Ppredicted = Pinf;
+      if (k>0) {
+        const double gap = points[order[k]][0] - points[order[k-1]][0];
+        if (!(gap>0)) return false;
+        A = transition(gap);
+        Ppredicted = A*P*A.t() + Pinf - A*Pinf*A.t();
+        if (!(Ppredicted.at(0,0)>tinyNuggetOnDiag)) return false;
+      }
+      const double nugget = K.at(order[k], order[k]) - 1.0;
+      const double S = Ppredicted.at(0,0) + nugget;
+      const arma::vec G = Ppredicted.col(0)/S;
+      arma::mat IminusGH = I;
+      IminusGH.col(0) -= G;
+      P = IminusGH*Ppredicted*IminusGH.t() + (nugget*G)*G.t(); // Joseph form
+      for(Long c=0; c<p*p; ++c) transitions.at(c, k) = A[c];
+      for(Long r=0; r<p; ++r) gains.at(r, k) = G[r];
+      innovationVariances[k] = S;
+    }
+    return true;
+  }
+
+public:
+  using CovMatrix = KernelOperator;
+
+  explicit StateSpaceMaternFactorization(const KernelOperator& K) {
+    static_assert((StateDimension==2) || (StateDimension==3), "state space representation available for matern3_2 and matern5_2");
+    order = MarkovExp::sortedOrder(K.getPoints());
+    if ((K.n_rows()==0) || (!buildFilter(K))) {
+      useDense = true;
+      dense.factorize(K);
+    }
+  }
+
+  void solve(arma::mat& rhsThenSolution) const {
+    if (useDense) {
+      dense.solve(rhsThenSolution);
+      return;
+    }
+    const Long n = order.size(), s = rhsThenSolution.n_cols;
+    std::vector<double> w(n);
+    double m[p], predicted[p], lambda[p], mu[p];
+    for(Long c=0; c<s; ++c) {
+      double* column = rhsThenSolution.colptr(c);
+      for(Long r=0; r<p; ++r) m[r] = 0.0;
+      for(Long k=0; k<n; ++k) { // forward: innovations, w = S^-1 L^-1 b
+        const double* A = transitions.colptr(k);
+        const double* G = gains.colptr(k);
+        for(Long r=0; r<p; ++r) {
+          predicted[r] = 0.0;
+          for(Long j=0; j<p; ++j) predicted[r] += A[r+j*p]*m[j];
+        }
+        const double innovation = column[order[k]] - predicted[0];
+        for(Long r=0; r<p; ++r) m[r] = predicted[r] + G[r]*innovation;
+        w[k] = innovation/innovationVariances[k];
+      }
+      for(Long r=0; r<p; ++r) lambda[r] = 0.0;
+      for(Long k=n; k>0; --k) { // backward: x = L^-T w
+        const double* A = transitions.colptr(k-1);
+        const double* G = gains.colptr(k-1);
+        double x = w[k-1];
+        for(Long r=0; r<p; ++r) x += G[r]*lambda[r];
+        column[order[k-1]] = x;
+        for(Long r=0; r<p; ++r) mu[r] = lambda[r];
+        mu[0] -= x;
+        for(Long j=0; j<p; ++j) {
+          lambda[j] = 0.0;
+          for(Long r=0; r<p; ++r) lambda[j] += A[r+j*p]*mu[r];
+        }
+      }
+    }
+  }
+
+  bool usesDenseFallBack() const {
+    return useDense;
+  }
+};
+
+//=================================================== StateSpaceKrigingPredictor
+// simple or ordinary Kriging predictor of a submodel in O(ni q), for d=1 and covType="matern3_2" or "matern5_2"
+
+template <int StateDimension>
+using StateSpaceKrigingPredictor = FactorizedKrigingPredictor<StateSpaceMaternFactorization<StateDimension> >;
+
+} //end namespace nestedKrig
+
+#endif /* MARKOVSOLVER_HPP */
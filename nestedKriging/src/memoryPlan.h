@@ -0,0 +1,179 @@
+
+#ifndef MEMORYPLAN_HPP
+#define MEMORYPLAN_HPP
+
+//===============================================================================
+// unit containing the memory accounting of the Algo: bytes projected before the run from n, N, q, d, the number of
+// threads and the required outputs, then the resident set size (RSS) sampled at the start and the end of each step
+// (VmRSS on Linux, nothing is reset). Elsewhere, the sample is the high-water mark of the process (getrusage).
+// Allocations freed within a step are not seen by the samples.
+// Projections are those of the dense algorithm (Cholesky submodels, dense cross-correlations), an upper bound
+// for the other solvers; inputs held by R are not counted. Results are kept for the whole run, the scratch of
+// each step only during the step, so that the projected peak is results + inputs + the largest step scratch.
+//
+// classes:
+// MemoryPlan
+//===============================================================================
+
+#include "common.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+namespace nestedKrig {
+
+//=================================================== MemoryPlan
+// one row by item: "inputs", "results", one row by step (its scratch), then "peak"; measured values are the largest
+// RSS sample of the step (of all steps for "peak"), NaN until the step is run, and for the platforms without getrusage
+
+class MemoryPlan {
+  static constexpr double bytesByDouble = 8.0;
+  std::vector<std::string> _items{};
+  std::vector<double> _projectedBytes{}, _measuredResidentBytes{};
+  double lastSample = std::numeric_limits<double>::quiet_NaN();
+
+  void addItem(const std::string& item, const double projected) {
+    _items.push_back(item);
+    _projectedBytes.push_back(projected);
+    _measuredResidentBytes.push_back(std::numeric_limits<double>::quiet_NaN());
+  }
+
+  Long positionOf(const std::string& item) const {
+    return std::find(_items.begin(), _items.end(), item) - _items.begin();
+  }
+
+  static std::vector<double> largestFirst(const std::vector<Long>& sizes) {
+    std::vector<double> sorted(sizes.begin(), sizes.end());
+    std::sort(sorted.begin(), sorted.end(), std::greater<double>());
+    return sorted;
+  }
+
+public:
+  const std::vector<std::string>& items = _items;
+  const std::vector<double>& projectedBytes = _projectedBytes;
+  const std::vector<double>& measuredResidentBytes = _measuredResidentBytes;
+
+  MemoryPlan() = default;
+
+  MemoryPlan(const std::vector<Long>& groupSizes, const Long n, const Long q, const Long d, const int numThreads,
+             const bool alternatives, const bool covariances, const double outOfCoreBudgetBytes = 0.0) {
+    const std::vector<double> ni = largestFirst(groupSizes);
+    const double N = static_cast<double>(ni.size()), nd = static_cast<double>(n), qd = static_cast<double>(q);
+    const double dd = static_cast<double>(d), B = bytesByDouble;
+    // steps run at most one group (or pair, or block) by thread, the largest ones in the worst case
+    const Long concurrent = std::min(static_cast<Long>((numThreads>1) ? numThreads : 1), static_cast<Long>(ni.size()));
+    const double largest = ni.empty() ? 0.0 : ni[0], second = (ni.size()>1) ? ni[1] : largest;
+
+    addItem("inputs", B*(nd*dd + nd + qd*dd));
+    // predictions, weights, kM, mean_M, sd2_M, KM, then alpha (out-of-core: its pages in use, within the budget)
+    double results = B*(2*qd + 4*N*qd + qd*N*(N+1)/2);
+    results += (outOfCoreBudgetBytes>0) ? std::min(B*nd*qd, outOfCoreBudgetBytes) : B*nd*qd;
+    if (alternatives) results += B*12*qd;
+    if (covariances) results += B*(qd*qd*N*N + qd*qd*N + 2*qd*qd);
+    addItem("results", results);
+
+    double partA = 0.0; // Ki, its factor, ki and a copy of the weights
+    for(Long i=0; i<concurrent; ++i) partA += B*(2*ni[i]*ni[i] + 2*ni[i]*qd);
+    addItem("partA", partA);
+    const double pairs = std::min(static_cast<double>(concurrent), N*(N-1)/2);
+    addItem("partB", pairs*B*(largest*second + largest*qd)); // Kij and Zij
+    addItem("partC", B*(2*N*qd + concurrent*9*N*N));         // transposes, then 8 gathered N x N matrices and a factor
+    addItem("partD", covariances ? B*qd*qd : 0.0);           // k(x,x)
+    addItem("partE", alternatives ? B*N*qd : 0.0);           // mean_M by point
+
+    double largestStep = 0.0;
+    for(Long item=2; item<_items.size(); ++item) largestStep = std::max(largestStep, _projectedBytes[item]);
+    addItem("peak", _projectedBytes[0] + _projectedBytes[1] + largestStep);
+  }
+
+  double projectedPeakBytes() const {
+    return _projectedBytes.empty() ? 0.0 : _projectedBytes.back();
+  }
+
+  static double residentBytes() {
+    // current RSS: VmRSS on Linux (kilobytes), else the process high-water mark, getrusage gives kilobytes on Linux,
+    // bytes on macOS
+    #if defined(__linux__)
+      std::FILE* file = std::fopen("/proc/self/status", "r");
+      if (file!=nullptr) {
+        char line[256];
+        double kilobytes = -1.0;
+        while ((kilobytes<0) && (std::fgets(line, sizeof(line), file)!=nullptr))
+          if ((std::strncmp(line, "VmRSS:", 6)!=0) || (std::sscanf(line + 6, "%lf", &kilobytes)!=1)) kilobytes = -1.0;
+        std::fclose(file);
+        if (kilobytes>=0) return 1024.0*kilobytes;
+      }
+    #endif
+    #if defined(__unix__) || defined(__APPLE__)
+      struct rusage usage;
+      if (getrusage(RUSAGE_SELF, &usage)!=0) return std::numeric_limits<double>::quiet_NaN();
+      #if defined(__APPLE__)
+        return static_cast<double>(usage.ru_maxrss);
+      #else
+        return 1024.0*static_cast<double>(usage.ru_maxrss);
+      #endif
+    #else
+      return std::numeric_limits<double>::quiet_NaN();
+    #endif
+  }
+
+  void startMeasures() {
+    lastSample = residentBytes();
+  }
+
+  void measure(const std::string& stepName) {
+    // largest of the samples at the start and the end of the step
+    const double sample = residentBytes();
+    const double measured = std::isnan(lastSample) ? sample : std::max(lastSample, sample);
+    lastSample = sample;
+    const Long position = positionOf(stepName);
+    if (position<_items.size()) _measuredResidentBytes[position] = measured;
+    if ((!_items.empty()) && (std::isnan(_measuredResidentBytes.back()) || (measured>_measuredResidentBytes.back())))
+      _measuredResidentBytes.back() = measured;
+  }
+
+  void checkBudget(const double budgetBytes) const {
+    if ((budgetBytes<=0) || (projectedPeakBytes()<=budgetBytes)) return;
+    std::ostringstream oss;
+    oss << "memory plan: projected peak of " << projectedPeakBytes()/1048576 << " MiB exceeds the budget of "
+        << budgetBytes/1048576 << " MiB (see memoryPlan in a dry run)";
+    throw std::runtime_error(oss.str());
+  }
+
+  void fuseParallelPlans(const std::vector<MemoryPlan>& plans) {
+    // zones run concurrently: projected bytes add up, measured samples are those of the same process
+    if (plans.empty()) return;
+    *this = plans[0];
+    for(Long z=1; z<plans.size(); ++z) {
+      if (plans[z].items!=_items) throw std::runtime_error("incompatible parallel memory plans");
+      for(Long item=0; item<_items.size(); ++item) {
+        _projectedBytes[item] += plans[z].projectedBytes[item];
+        const double measured = plans[z].measuredResidentBytes[item];
+        if (std::isnan(_measuredResidentBytes[item]) || (measured>_measuredResidentBytes[item])) _measuredResidentBytes[item] = measured;
+      }
+    }
+  }
+
+  // not defaulted: the public references must refer to this object's members, not to other's
+  MemoryPlan(const MemoryPlan& other) { *this = other; }
+  MemoryPlan& operator=(const MemoryPlan& other) {
+    _items = other.items; _projectedBytes = other.projectedBytes; _measuredResidentBytes = other.measuredResidentBytes;
+    lastSample = other.lastSample;
+    return *this;
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* MEMORYPLAN_HPP */
@@ -5,19 +5,22 @@
 //===============================================================================
 // unit used for messages, warnings, time indications and interaction with user
 // classes:
-// Screen, ChronoReport, ChronoEngine, Chrono, ProgressBar
+// LogQueue, Screen, ChronoReport, ChronoEngine, Chrono, ProgressBar
 //===============================================================================
 
 #include <ostream>
 //#include <stdio.h>
 //#include <cstdio>
-//#include <iomanip> // for setw
+#include <iomanip> // for setprecision
 
 #include <sstream> // for ostringstream
 #include <string>
 
+#include <atomic>
 #include <chrono>
+#include <vector>
 #include "common.h"
+#include "workload.h"
 
 // for printing threads information
 #if defined(_OPENMP)
@@ -33,24 +36,133 @@ namespace nestedKrig {
 
 #define CHOSEN_PROGRESSBAR 2 //1: faster in monothread but indicative, 2: safer
 
+//========================================================= LogQueue
+// bounded lock-free multi-producer queue of messages (Vyukov's sequence numbers), one consumer at a time:
+// producers never wait, a message is dropped (and counted) when the queue is full
+
+class LogQueue {
+public:
+  struct Entry {
+    std::string text{};
+    double time = 0.0; // seconds since the creation of the queue
+    int thread = 0;
+  };
+
+private:
+  struct Slot {
+    std::atomic<Long> sequence{0};
+    Entry entry{};
+  };
+
+  const Long capacity;
+  std::vector<Slot> slots;
+  std::atomic<Long> tail{0};
+  Long head = 0; // consumer only
+  std::atomic<Long> dropped{0};
+  std::atomic_flag consuming = ATOMIC_FLAG_INIT;
+  const std::chrono::steady_clock::time_point origin;
+
+  static int threadNumber() noexcept {
+    #if defined(_OPENMP)
+      return omp_get_thread_num();
+    #else
+      return 0;
+    #endif
+  }
+
+public:
+  explicit LogQueue(const Long capacity) : capacity(capacity), slots(capacity), origin(std::chrono::steady_clock::now()) {
+    for(Long k=0; k<capacity; ++k) slots[k].sequence.store(k, std::memory_order_relaxed);
+  }
+
+  bool push(std::string&& text) noexcept {
+    Long position = tail.load(std::memory_order_relaxed);
+    for(;;) {
+      Slot& slot = slots[position % capacity];
+      const Long sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence==position) {
+        if (tail.compare_exchange_weak(position, position+1, std::memory_order_relaxed)) break;
+      }
+      else if (sequence<position) { // slot not consumed yet: full
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else position = tail.load(std::memory_order_relaxed);
+    }
+    Slot& slot = slots[position % capacity];
+    slot.entry.text = std::move(text);
+    slot.entry.time = std::chrono::duration<double>(std::chrono::steady_clock::now()-origin).count();
+    slot.entry.thread = threadNumber();
+    slot.sequence.store(position+1, std::memory_order_release);
+    return true;
+  }
+
+  template <typename Consumer>
+  bool tryDrain(Consumer consume) {
+    // false when another thread is draining, messages are then left to it
+    if (consuming.test_and_set(std::memory_order_acquire)) return false;
+    for(;;) {
+      Slot& slot = slots[head % capacity];
+      if (slot.sequence.load(std::memory_order_acquire)!=head+1) break;
+      consume(slot.entry);
+      slot.sequence.store(head+capacity, std::memory_order_release);
+      ++head;
+    }
+    consuming.clear(std::memory_order_release);
+    return true;
+  }
+
+  Long droppedMessages() const noexcept {
+    return dropped.load(std::memory_order_relaxed);
+  }
+};
+
 //========================================================= Screen
 // class to show messages on the screen, and declaration of a global variable screen
+// messages are queued without lock, then printed by the thread 0 of the team that queued them,
+// or by the next message printed outside parallel regions (i.e. after each parallel loop)
 
 class Screen {
 
-  static void printLine(const std::string& message, const std::string& prefix="") noexcept {
-    std::ostringstream oss;
-    oss << prefix << message << "\n";
-    #pragma omp critical
-      {
-      std::cout << oss.str();  // one << only, thread-safe print for std::cout (do not interleave texts)
-      std::cout << std::flush; // because buffered output, see Screen constructor
-      }
+  static LogQueue& queue() {
+    static LogQueue messages(4096);
+    return messages;
+  }
+
+  static void writeLines(const std::string& lines) {
+    std::cout << lines;      // one << only, do not interleave texts
+    std::cout << std::flush; // because buffered output, see Screen constructor
     // CAUTION: mutlithreaded Rcout raises unexpected CRASH even with a critical pragma
     // Rcpp::Rcout << oss.str(); // see RaiseFatalError_and_CrashRSession_1() in sandBox.h
     // RcppThread::Rcout << oss.str(); //not satisfying here: may wait a long time before printing many messages
   }
 
+  static void drain() {
+    std::ostringstream oss;
+    Long printed = 0;
+    const bool drained = queue().tryDrain([&](const LogQueue::Entry& entry) {
+      oss << entry.text << " [" << std::fixed << std::setprecision(3) << entry.time << "s, thread " << entry.thread << "]\n";
+      ++printed;
+    });
+    if (drained && (printed>0)) writeLines(oss.str());
+  }
+
+  static bool isPrintingThread() noexcept {
+    #if defined(_OPENMP)
+      return (!omp_in_parallel()) || (omp_get_thread_num()==0);
+    #else
+      return true;
+    #endif
+  }
+
+  static void printLine(const std::string& message, const std::string& prefix="") noexcept {
+    try {
+      queue().push(prefix + message);
+      if (isPrintingThread()) drain();
+    }
+    catch(...) {} // a message is never worth an exception
+  }
+
 public:
   struct verboseLevels {enum levels {errorsOnly=-1, errorsAndWarningsOnly=0, allMessages=1}; };
   const bool showMessages;
@@ -74,9 +186,19 @@ public:
     if (showWarnings) printLine(message, tag + " [nested Kriging warning] ");
   }
 
+  static void flush() noexcept {
+    // prints the remaining queued messages
+    try { drain(); } catch(...) {}
+  }
+
+  static Long droppedMessages() noexcept {
+    return queue().droppedMessages();
+  }
+
   static void error(const std::string& message, std::exception const& e) {
     std::string errorMessage = static_cast<std::string>("[nested Kriging exception] ") + message + " : " +  e.what();
     printLine(errorMessage);
+    flush();
     #pragma omp critical
     Rcpp::Rcerr << errorMessage;
     Rcpp::stop(errorMessage);
@@ -113,23 +235,59 @@ class ChronoReport {
   std::vector<double> _durations {};
   std::vector<std::string> _stepNames {};
   double _totalDuration {0.0};
+  std::vector<double> _counterValues {};
+  std::vector<std::string> _counterNames {};
+  std::vector<Workload> _workloads {};
+
+  template <typename Quantity>
+  std::vector<double> ratesOf(Quantity quantity, const double unit) const {
+    // quantity by second of each step, 0 when the step has no modelled work
+    std::vector<double> rates(_durations.size(), 0.0);
+    for(Long step=0; step<rates.size(); ++step)
+      if (_durations[step]>0) rates[step] = quantity(_workloads[step])/(unit*_durations[step]);
+    return rates;
+  }
 
 public:
   const std::vector<double>& durations= _durations;
   const std::vector<std::string>& stepNames=_stepNames;
   const double& totalDuration=_totalDuration;
+  const std::vector<double>& counterValues= _counterValues;
+  const std::vector<std::string>& counterNames=_counterNames;
+  const std::vector<Workload>& workloads=_workloads;
 
   void reserveSteps(const Long size) {
     _durations.reserve(size);
     _stepNames.reserve(size);
+    _workloads.reserve(size);
   }
 
-  void saveStep(const double duration, const double durationSinceStart, const std::string& stepName) {
+  void saveStep(const double duration, const double durationSinceStart, const std::string& stepName, const Workload& workload) {
     _durations.push_back(duration);
     _stepNames.push_back(stepName);
+    _workloads.push_back(workload);
     _totalDuration = durationSinceStart;
   }
 
+  //--- achieved throughput of each step, from its analytic workload
+  std::vector<double> gigaflopsBySecond() const {
+    return ratesOf([](const Workload& w) { return w.flops; }, 1e9);
+  }
+
+  std::vector<double> kernelEvaluationsBySecond() const {
+    return ratesOf([](const Workload& w) { return w.kernelEvaluations; }, 1.0);
+  }
+
+  std::vector<double> gigabytesBySecond() const {
+    return ratesOf([](const Workload& w) { return w.bytes; }, 1e9);
+  }
+
+  void saveCounter(const std::string& counterName, const double value) {
+    // counters are step-independent figures, e.g. iteration counts of iterative solvers
+    _counterNames.push_back(counterName);
+    _counterValues.push_back(value);
+  }
+
   bool comparableWith(const ChronoReport& other) const {
     return (durations.size()==other.durations.size()) && (stepNames==other.stepNames);
   }
@@ -140,24 +298,36 @@ public:
     if (nbReports==0) throw( std::runtime_error("no parallel reports in ChronoReport"));
     for(Long z=1; z<nbReports; ++z)
       if (!reports[0].comparableWith(reports[z])) throw( std::runtime_error("incompatible parallel reports in ChronoReport"));
-    //--- update durations
+    //--- update durations, and workloads of all zones
     Long nbSteps = reports[0].durations.size();
       _durations.resize(nbSteps);
+      _workloads.assign(nbSteps, Workload{});
     for(Long step=0; step<nbSteps; ++step) {
       double& durationStep = _durations[step] = 0.0;
       for(Long z=0; z<nbReports; ++z) durationStep = std::max(durationStep, reports[z].durations[step]);
+      for(Long z=0; z<nbReports; ++z) _workloads[step] += reports[z].workloads[step];
     }
     //--- update stepNames and totalDuration
     _stepNames = reports[0].stepNames;
     _totalDuration = 0.0;
     for(Long z=0; z<nbReports; ++z) _totalDuration = std::max(_totalDuration, reports[z].totalDuration);
+    //--- update counters, worst case across zones
+    _counterNames.clear(); _counterValues.clear();
+    for(Long z=0; z<nbReports; ++z)
+      for(Long c=0; c<reports[z].counterNames.size(); ++c) {
+        const Long position = std::find(_counterNames.begin(), _counterNames.end(), reports[z].counterNames[c]) - _counterNames.begin();
+        if (position==_counterNames.size()) saveCounter(reports[z].counterNames[c], reports[z].counterValues[c]);
+        else _counterValues[position] = std::max(_counterValues[position], reports[z].counterValues[c]);
+      }
   }
 
   ChronoReport () = default;
-  ChronoReport (const ChronoReport &other) = default;
-  ChronoReport (ChronoReport &&other) = default;
+  // not defaulted: the public references must refer to this object's members, not to other's
+  ChronoReport (const ChronoReport &other) { *this = other; }
+  ChronoReport (ChronoReport &&other) { *this = other; }
   ChronoReport& operator= (const ChronoReport &other) {
     _durations=other.durations; _stepNames=other.stepNames; _totalDuration=other.totalDuration;
+    _counterValues=other.counterValues; _counterNames=other.counterNames; _workloads=other.workloads;
     return *this;
   }
 };
@@ -223,10 +393,10 @@ public:
     return duration(timeAtStart, now());
   }
 
-  void saveStep(const std::string& stepName) noexcept {
+  void saveStep(const std::string& stepName, const Workload& workload = Workload{}) noexcept {
     double elapsed= duration(timeAtStep, now());
     timeAtStep = now();
-    report.saveStep(elapsed, durationSinceStart(), stepName);
+    report.saveStep(elapsed, durationSinceStart(), stepName, workload);
   }
 
   void print(const std::string& message) noexcept {
@@ -267,14 +437,15 @@ template <int ShowProgress>
 class ProgressBar {
   Chrono& chrono;
   const Long total, nbSteps;
-  Long nextTick, done;
+  Long nextTick;
+  std::atomic<Long> done; // lock-free progress counter
 
   static inline Long ceilOfRatio(Long x, Long y) noexcept { //gives ceil(x/static_cast<double>(y))
     return 1+(x-1)/y;
   }
 
 public:
-  Long get_done() const noexcept { return(done); } // used in unit tests
+  Long get_done() const noexcept { return(done.load()); } // used in unit tests
 
   ProgressBar(Chrono& chrono, const Long total, const Long nbSteps) noexcept
   : chrono(chrono), total(total), nbSteps(nbSteps), nextTick(ceilOfRatio(total, nbSteps)), done(0) {
@@ -307,9 +478,7 @@ public:
 #elif CHOSEN_PROGRESSBAR == 2 //safer
 
   inline void next() noexcept {
-    Long localdone;
-    #pragma omp atomic capture
-    localdone = ++done;
+    const Long localdone = done.fetch_add(1, std::memory_order_relaxed)+1;
     if (((localdone*nbSteps)%total) < nbSteps) {
       Long currentStep = (localdone*nbSteps) / total;
       chrono.printProgression(currentStep, nbSteps);
@@ -317,9 +486,7 @@ public:
   }
 
   inline bool signalingNext(bool showProgression = true) noexcept {
-    Long localdone;
-    #pragma omp atomic capture
-    localdone = ++done;
+    const Long localdone = done.fetch_add(1, std::memory_order_relaxed)+1;
     if (((localdone*nbSteps)%total) < nbSteps) {
       Long currentStep = (localdone*nbSteps) / total;
       if (showProgression) chrono.printProgression(currentStep, nbSteps);
@@ -330,7 +497,7 @@ public:
 
 
   Long get_nextTick() { // used in unit tests
-    Long currentStep = (done*nbSteps) / total;
+    Long currentStep = (done.load()*nbSteps) / total;
     nextTick = ceilOfRatio((currentStep+1)*total, nbSteps);
     return(nextTick);
   }
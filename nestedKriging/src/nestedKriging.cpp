@@ -5,6 +5,8 @@
 
 #include <vector>
 #include "nestedKriging.h"
+#include "vecchia.h"
+#include "distributed.h"
 #include "paramEstimation.h"
 #include "tests.h"
 #include "sandBox.h"
@@ -97,6 +99,116 @@ const arma::vec nugget = Rcpp::NumericVector::create(0)
       return Rcpp::List::create(Rcpp::Named("Exception") = e.what());
   }
 }
+//------------------------------------------------------------- vecchiaKrigingDirect
+// same interface as nestedKrigingDirect, Vecchia approximation with numNeighbours conditioning points
+// clusters and numThreadsZones are accepted for compatibility and not used; outputLevel with alternatives or
+// covariances, and developer options of the nested Algo (globalOptions from packedStorage on), are refused
+// [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::export]]
+Rcpp::List vecchiaKrigingDirect(
+const arma::mat& X,
+const arma::vec& Y,
+const std::vector<signed long>& clusters,
+const arma::mat& x,
+const std::string covType,
+const arma::vec& param,
+const double sd2,
+const std::string krigingType="simple",
+const std::string tagAlgo="",
+const long numThreadsZones=1,
+const long numThreads=16,
+const int verboseLevel=10,
+const int outputLevel=1,
+const Rcpp::IntegerVector globalOptions = Rcpp::IntegerVector::create(0),
+const arma::vec nugget = Rcpp::NumericVector::create(0),
+const long numNeighbours=30
+)
+{
+  (void) clusters; (void) numThreadsZones; // one set of neighbours for all points, no zones
+  try {
+      using Option = nestedKrig::GlobalOptions::Option;
+      const nestedKrig::RequiredByUser required(outputLevel);
+      if (required.alternatives() || required.covariances())
+        throw std::runtime_error("Vecchia: outputLevel with alternatives or covariances is not available");
+      const nestedKrig::GlobalOptions options(globalOptions);
+      for(const Option option: options.allOptions)
+        if ((static_cast<unsigned int>(option)>=static_cast<unsigned int>(Option::packedStorage)) && (options.getOptionValue(option)!=0))
+          throw std::runtime_error("Vecchia: developer option " + options.getOptionString(option) + " is not available");
+      bool OrdinaryKriging = (krigingType=="ordinary");
+      return nestedKrig::vecchia_kriging(X, Y, x, covType, param, sd2, OrdinaryKriging, tagAlgo, numThreads, verboseLevel, nugget, numNeighbours);
+  }
+  catch(const std::exception& e) {
+      return Rcpp::List::create(Rcpp::Named("Exception") = e.what());
+  }
+}
+//------------------------------------------------------------- nestedKrigingPlanner
+// recommended clusters number and split of numThreads (0 = all cores) between zones and groups, for n observations
+// in dimension d and q prediction points, within memoryBudget MiB (0 = unlimited); cf. planner.h
+// [[Rcpp::export]]
+Rcpp::List nestedKrigingPlanner(
+const long n,
+const long d,
+const long q,
+const std::string covType,
+const long numThreads=0,
+const double memoryBudget=0,
+const std::string krigingType="simple",
+const int outputLevel=0
+)
+{
+  try {
+      if ((n<1) || (d<1) || (q<1)) throw std::runtime_error("n, d and q must be positive");
+      const nestedKrig::RequiredByUser required(outputLevel);
+      return nestedKrig::plan_nested_kriging(n, d, q, covType, numThreads, memoryBudget, krigingType=="ordinary",
+                                             required.alternatives(), required.covariances());
+  }
+  catch(const std::exception& e) {
+      return Rcpp::List::create(Rcpp::Named("Exception") = e.what());
+  }
+}
+//------------------------------------------------------------- nestedKrigingSharded
+// nested Kriging with clusters sharded over numRanks ranks, each running numThreads threads; cf. distributed.h
+// ranks are threads of this process here, MPI processes in a driver compiled with -DNESTEDKRIGING_MPI
+// [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::export]]
+Rcpp::List nestedKrigingSharded(
+const arma::mat& X,
+const arma::vec& Y,
+const std::vector<signed long>& clusters,
+const arma::mat& x,
+const std::string covType,
+const arma::vec& param,
+const double sd2,
+const std::string krigingType="simple",
+const std::string tagAlgo="",
+const long numRanks=2,
+const long numThreads=1,
+const int verboseLevel=0,
+const arma::vec nugget = Rcpp::NumericVector::create(0)
+)
+{
+  try {
+      bool OrdinaryKriging = (krigingType=="ordinary");
+      return nestedKrig::sharded_nested_kriging(X, Y, clusters, x, covType, param, sd2, OrdinaryKriging, tagAlgo,
+                                                numRanks, numThreads, verboseLevel, nugget);
+  }
+  catch(const std::exception& e) {
+      return Rcpp::List::create(Rcpp::Named("Exception") = e.what());
+  }
+}
+//------------------------------------------------------------- checkpointInfo
+// run, progress and records of a checkpoint file ("" = file NESTEDKRIGING_CHECKPOINT, else nestedKriging.checkpoint);
+// cf. checkpoint.h
+// [[Rcpp::export]]
+Rcpp::List checkpointInfo(const std::string file="")
+{
+  try {
+      return nestedKrig::checkpoint_info(file);
+  }
+  catch(const std::exception& e) {
+      return Rcpp::List::create(Rcpp::Named("Exception") = e.what());
+  }
+}
 //------------------------------------------------------------- looErrors
 // [[Rcpp::depends(RcppArmadillo)]]
 // [[Rcpp::export]]
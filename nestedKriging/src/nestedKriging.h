@@ -24,6 +24,21 @@
 #include "splitter.h"
 #include "leaveOneOut.h"
 #include "kriging.h"
+#include "iterativeSolver.h"
+#include "markovSolver.h"
+#include "kroneckerGrid.h"
+#include "compactSupport.h"
+#include "randomFeatures.h"
+#include "inducingPoints.h"
+#include "hierarchicalMatrix.h"
+#include "trace.h"
+#include "hardwareCounters.h"
+#include "memoryPlan.h"
+#include "planner.h"
+#include "numa.h"
+#include "outOfCore.h"
+#include "checkpoint.h"
+#include <exception>
 
 namespace nestedKrig {
 
@@ -41,19 +56,44 @@ using NuggetVector = Covariance::NuggetVector;
 
 class GlobalOptions {
 public:
-  enum class Option : unsigned int {implAlgoB=0, numThreadsOther=1, otherOption=2, _count_=3 };
-  const std::vector<std::string> optionNames { "implAlgoB", "numThreadsOther", "otherOption"};
-  const std::vector<Option> allOptions { Option::implAlgoB, Option::numThreadsOther, Option::otherOption };
+  enum class Option : unsigned int {implAlgoB=0, numThreadsOther=1, otherOption=2, packedStorage=3, mixedPrecision=4, iterativeSolver=5, randomFeatures=6, inducingPoints=7, hierarchicalMatrices=8, trace=9, hardwareCounters=10, memoryBudget=11, dryRun=12, numaPlacement=13, outOfCore=14, checkpoint=15, _count_=16 };
+  const std::vector<std::string> optionNames { "implAlgoB", "numThreadsOther", "otherOption", "packedStorage", "mixedPrecision", "iterativeSolver", "randomFeatures", "inducingPoints", "hierarchicalMatrices", "trace", "hardwareCounters", "memoryBudget", "dryRun", "numaPlacement", "outOfCore", "checkpoint"};
+  const std::vector<Option> allOptions { Option::implAlgoB, Option::numThreadsOther, Option::otherOption, Option::packedStorage,
+                                         Option::mixedPrecision, Option::iterativeSolver, Option::randomFeatures,
+                                         Option::inducingPoints, Option::hierarchicalMatrices, Option::trace,
+                                         Option::hardwareCounters, Option::memoryBudget, Option::dryRun, Option::numaPlacement,
+                                         Option::outOfCore, Option::checkpoint };
 
 private:
-  static const int defaultOptionValue=1;
+  // default value by option, packedStorage: 0 = dense Ki (default), 1 = packed symmetric Ki (memory-bound runs)
+  // mixedPrecision: 0 = double (default), 1 = float factorizations with double refinement, has priority over packedStorage
+  // iterativeSolver: 0 = factorized Ki (default), 1 = matrix-free conjugate gradients for very large submodels, has priority
+  //                  over mixedPrecision and packedStorage
+  // randomFeatures: 0 = exact partB (default), D>0 = partB approximated with D random Fourier features (gauss, exp,
+  //                 matern kernels without cross-covariances, exact partB otherwise)
+  // inducingPoints: 0 = none (default), k>0 = FITC and PITC predictions added to the alternatives, with k inducing points by group
+  // hierarchicalMatrices: 0 = none (default), t>0 = HODLR Ki and low-rank large Kij in partB, relative tolerance 10^-t,
+  //                       dense nodes of Ki where blocks are not of low rank (partA.hodlrDenseFallBacks),
+  //                       has priority over iterativeSolver, mixedPrecision and packedStorage
+  // trace: 0 = none (default), k>0 = Chrome trace of submodels, pairs and solves in output$trace, last k events by thread
+  // hardwareCounters: 0 = none (default), 1 = cycles, instructions, cache and branch misses by step and thread (Linux perf events)
+  // memoryBudget: 0 = unlimited (default), b>0 = refuse to run when the projected peak memory exceeds b MiB
+  // dryRun: 0 = run (default), 1 = only return the memory plan, without allocating nor computing results
+  // numaPlacement: 0 = none (default), 1 = threads bound and spread, group data first touched by the thread running the
+  //                group, pairs scheduled on the node of their second group (multi-socket machines, not in zones)
+  // outOfCore: 0 = in memory (default), b>0 = weights alpha in a memory mapped scratch file, partB by tiles of pairs
+  //            whose weights fit in b MiB (directory: environment variable NESTEDKRIGING_SCRATCH, else TMPDIR or /tmp)
+  // checkpoint: 0 = none (default), s>0 = completed submodels and pair columns (estimParam: SPSA iterations) saved every
+  //             s seconds in the file NESTEDKRIGING_CHECKPOINT (else nestedKriging.checkpoint), a run with the same
+  //             inputs resumes from it (single zone, without LOO nor cross-covariances)
+  const std::vector<int> defaultOptionValues { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
   std::vector<int> optionValues {};
 
   void setDefaultValues() {
     Long totalNumberOfOptions = static_cast<Long>(Option::_count_)+1;
     optionValues.resize(totalNumberOfOptions);
-    for(auto& option: optionValues) option = defaultOptionValue;
+    for(Long i=0; i<totalNumberOfOptions; ++i) optionValues[i] = (i<defaultOptionValues.size())?defaultOptionValues[i]:1;
   }
 
   void setOptions(const Rcpp::IntegerVector& userChoices) {
@@ -79,6 +119,18 @@ public:
     return optionNames[optionIndex];
   }
 
+  static bool isDiagnostic(const Option option) {
+    // options that leave the results unchanged, excluded from the fingerprints of checkpoints
+    return (option==Option::checkpoint) || (option==Option::trace) || (option==Option::hardwareCounters)
+        || (option==Option::memoryBudget);
+  }
+
+  GlobalOptions withOptionValue(const Option option, const int value) const {
+    GlobalOptions changed(*this);
+    changed.optionValues[static_cast<int>(option)] = value;
+    return changed;
+  }
+
   std::string str() const {
     std::ostringstream oss;
     oss << " => developer options: ";
@@ -91,11 +143,13 @@ public:
 //
 // class giving informations on parallel programming settings
 // when threads number are set to 0, defaults are employed (nb of cores for inner context)
+// in a task pool (AlgoZones), zones, submodels and pairs are tasks of one team of outer x inner threads
 
 class Parallelism {
 
   std::array<int, 3> threadsNumberByContext{ {1, 1, 1} };
   std::array<int, 3> boundedThreadsNumberByContext{ {1, 1, 1} };
+  bool taskPool = false;
 
   template<int context>
   int defaultNumThreads() { return 1; }
@@ -127,6 +181,11 @@ public:
     }
   }
 
+  template<int context>
+  inline int getThreadsNumber() const {
+    return threadsNumberByContext[context];
+  }
+
   template<int context>
   inline int getBoundedThreadsNumber() const {
     return boundedThreadsNumberByContext[context];
@@ -135,12 +194,23 @@ public:
   template<int context>
   void switchToContext() const {
 #if defined(_OPENMP)
-    omp_set_num_threads(getBoundedThreadsNumber<context>());
-    // to be checked: omp_set_num_threads can be called within a multithread session (in AlgoZone only)
-    // but this routine can only be called from the serial portions of the code ?
+    // no effect in a task pool, where the team is created once for all zones
+    if (!taskPool) omp_set_num_threads(getBoundedThreadsNumber<context>());
 #endif
   }
 
+  void enableTaskPool() {
+    taskPool = true;
+  }
+
+  bool inTaskPool() const {
+    return taskPool;
+  }
+
+  int getTaskPoolThreadsNumber() const {
+    return getBoundedThreadsNumber<outerContext>()*getBoundedThreadsNumber<innerContext>();
+  }
+
 static  std::string informationString() {
 #if defined(_OPENMP)
     std::ostringstream oss;
@@ -155,8 +225,8 @@ static  std::string informationString() {
 
 #if defined(_OPENMP)
 template<>
-int Parallelism::defaultNumThreads<Parallelism::innerContext>() {
-  return omp_get_thread_num();
+inline int Parallelism::defaultNumThreads<Parallelism::innerContext>() {
+  return omp_get_num_procs();
 }
 #endif
 
@@ -203,14 +273,16 @@ class Submodels {
     std::vector<NuggetVector> splittedNuggets{};
 
 Submodels(const arma::mat& X, const arma::mat& x, const arma::vec& Y,
-          const CovarianceParameters& covParams, const Splitter& splitter, const NuggetVector& nugget)
+          const CovarianceParameters& covParams, const Splitter& splitter, const NuggetVector& nugget,
+          const NumaPlacement& placement = NumaPlacement::off())
       : d(X.n_cols),
         predictionPoints(x, covParams),
         N(splitter.get_N()), cmax(splitter.get_maxGroupSize())
          {
+      // groups are first touched by the thread that will run them, when the placement is enabled
       const Points pointsX(X, covParams);
-      splitter.split<Points>(pointsX, splittedX);
-      splitter.split<arma::rowvec>(Y.t(), splittedY);
+      splitter.split<Points>(pointsX, splittedX, placement);
+      splitter.split<arma::rowvec>(Y.t(), splittedY, placement);
       createSplittedNuggets(splitter, X.n_rows, nugget);
 
       }
@@ -321,9 +393,12 @@ public:
   //--- results by subModel
   std::vector<std::vector<arma::mat> > KKM {}; // q x q items, each = NxN cov matrix between Mi(x), M_j(x')
   std::vector<std::vector<arma::vec> > kkM {}; // q x q items, each = Nx1 cov matrix between Mi(x), Y(x')
-  std::vector<arma::mat> KM;    // q items, each = NxN cov matrix between Mi(x)
-  std::vector<arma::vec> kM;    // q items, each = Nx1 cov vector between Mi(x) and Y(x)
-  std::vector<arma::vec> mean_M;   // q items, each = Nx1 prediction mean vector E[ Mi(x) | Y(X)=y]
+  // pair-major storage: values for all pred points of one group i (or one pair i,j) are contiguous, so that
+  // threads of partA and partB only write their own columns; use the ...OfPoint(m) accessors for one pred point
+  // KM is symmetric, only pairs i<=j are stored, in the column PackedSymMatrix::index(i,j)
+  arma::mat KMbyPair;           // q x N(N+1)/2, KMbyPair(m, index(i,j)) = cov between Mi(x), Mj(x) at pred point m
+  arma::mat kMbyGroup;          // q x N, kMbyGroup(m,i) = cov between Mi(x) and Y(x) at pred point m
+  arma::mat mean_MbyGroup;      // q x N, mean_MbyGroup(m,i) = prediction mean E[ Mi(x) | Y(X)=y] at pred point m
   std::vector<arma::vec> sd2_M;   // q items, each = Nx1 prediction sd2 vector var[ Mi(x) | Y(X)=y]
   std::vector<arma::mat> alpha;  // N items, each = ni x q matrix of weights: columns give weigths for each pred point in the submodel
   arma::mat weights;             // q columns, each = Nx1 weigts between submodels (N x q matrix)
@@ -337,13 +412,25 @@ public:
   //--- aggregated results Alternatives
   arma::vec meanPOE{}, meanGPOE{}, meanBCM{}, meanRBCM{}, meanGPOE_1N{}, meanSPV{};  // q x 1 predicted mean for each pred point using POE, GPOE...
   arma::vec sd2POE{}, sd2GPOE{}, sd2BCM{}, sd2RBCM{}, sd2GPOE_1N{}, sd2SPV{};      // q x 1 predicted sd2  for each pred point using POE, GPOE...
+  arma::vec meanFITC{}, meanPITC{}, sd2FITC{}, sd2PITC{}; // q x 1 inducing points predictions, empty unless required in globalOptions
+
+  //--- execution trace, empty unless required in globalOptions
+  bool traced = false;
+  std::vector<TraceEvent> traceEvents{};
+  Long droppedTraceEvents = 0;
+
+  //--- hardware counters by step and thread, empty unless required in globalOptions and available
+  HardwareCounterReport hardwareCounterReport{};
+
+  //--- projected memory, and resident memory sampled at the steps
+  MemoryPlan memoryPlan{};
 
   Output(Long N, Long q, int outputDetailLevel) : requiredByUser(outputDetailLevel),
-    KM(q), kM(q), mean_M(q), sd2_M(q), alpha(N), weights(N,q), predmean(q), predsd2(q), kagg(q,q), cagg(q,q) {
+    KMbyPair(q,PackedSymMatrix::packedSize(N)), kMbyGroup(q,N), mean_MbyGroup(q,N), sd2_M(q), alpha(N), weights(N,q), predmean(q), predsd2(q), kagg(q,q), cagg(q,q) {
     reserveMatrices(N, q);
   }
 
-  Output() :  requiredByUser(0), KM{}, kM{}, mean_M{}, sd2_M{}, alpha{}, weights{}, predmean{}, predsd2{},
+  Output() :  requiredByUser(0), KMbyPair{}, kMbyGroup{}, mean_MbyGroup{}, sd2_M{}, alpha{}, weights{}, predmean{}, predsd2{},
               kagg{}, cagg{} {}
 
   void reserveMatrices(Long N, Long q) {
@@ -351,16 +438,11 @@ public:
       predmean.resize(q);
       predsd2.resize(q);
       weights.set_size(N,q);
-      KM.resize(q);
-      kM.resize(q);
-      mean_M.resize(q);
+      KMbyPair.set_size(q,PackedSymMatrix::packedSize(N));
+      kMbyGroup.set_size(q,N);
+      mean_MbyGroup.set_size(q,N);
       sd2_M.resize(q);
-      for(Long m=0; m<q; ++m) {
-        kM[m].set_size(N);
-        mean_M[m].set_size(N);
-        sd2_M[m].set_size(N);
-        KM[m].set_size(N,N);
-      }
+      for(Long m=0; m<q; ++m) sd2_M[m].set_size(N);
       if (requiredByUser.alternatives()) {
         meanPOE.set_size(q); meanGPOE.set_size(q); meanBCM.set_size(q); meanRBCM.set_size(q); meanGPOE_1N.set_size(q); meanSPV.set_size(q);
         sd2POE.set_size(q);  sd2GPOE.set_size(q);  sd2BCM.set_size(q);  sd2RBCM.set_size(q); sd2GPOE_1N.set_size(q); sd2SPV.set_size(q);
@@ -375,7 +457,7 @@ public:
         // fill all objects with NaN to ensure that uninitialized values are unused
         double defaultValue = std::numeric_limits<double>::signaling_NaN();
         Initializer<double> init(defaultValue);
-        init.fill(predmean, predsd2, weights, KM, kM, mean_M, KKM, kkM, kagg, cagg, sd2_M);
+        init.fill(predmean, predsd2, weights, KMbyPair, kMbyGroup, mean_MbyGroup, KKM, kkM, kagg, cagg, sd2_M);
         init.fill(meanPOE, meanGPOE, meanGPOE_1N, meanBCM, meanRBCM, meanSPV);
         init.fill(sd2POE, sd2GPOE, sd2GPOE_1N, sd2BCM, sd2RBCM, sd2SPV);
       #endif
@@ -386,6 +468,42 @@ public:
     }
   }
 
+  //--- lazy transposes of the pair-major storage, for consumers by pred point
+  arma::mat KMofPoint(const Long m) const {
+    const Long N = kMbyGroup.n_cols;
+    arma::mat KM(N, N);
+    for(Long j=0; j<N; ++j)
+      for(Long i=0; i<=j; ++i) KM.at(i,j) = KM.at(j,i) = KMbyPair.at(m, PackedSymMatrix::index(i,j));
+    return KM;
+  }
+
+  arma::vec diagKMofPoint(const Long m) const {
+    const Long N = kMbyGroup.n_cols;
+    arma::vec diagKM(N);
+    for(Long i=0; i<N; ++i) diagKM[i] = KMbyPair.at(m, PackedSymMatrix::index(i,i));
+    return diagKM;
+  }
+
+  arma::vec kMofPoint(const Long m) const {
+    return kMbyGroup.row(m).t();
+  }
+
+  arma::vec mean_MofPoint(const Long m) const {
+    return mean_MbyGroup.row(m).t();
+  }
+
+  std::vector<arma::mat> allKMofPoints() const {
+    std::vector<arma::mat> KM(KMbyPair.n_rows);
+    for(Long m=0; m<KM.size(); ++m) KM[m] = KMofPoint(m);
+    return KM;
+  }
+
+  std::vector<arma::vec> allkMofPoints() const {
+    std::vector<arma::vec> kM(kMbyGroup.n_rows);
+    for(Long m=0; m<kM.size(); ++m) kM[m] = kMofPoint(m);
+    return kM;
+  }
+
   //copy constructor and affectation operators are used after, they are set to default's compiler ones
   Output (const Output &other) = default;
   Output& operator= (const Output &other) = default;
@@ -482,13 +600,36 @@ public:
         Rcpp::Named("sd2RBCM") = sd2RBCM,
         Rcpp::Named("sd2SPV") = sd2SPV
     );
+    if (show.alternatives() && (meanPITC.size()>0)) {
+      alternativesList.push_back(meanFITC, "meanFITC");
+      alternativesList.push_back(meanPITC, "meanPITC");
+      alternativesList.push_back(sd2FITC, "sd2FITC");
+      alternativesList.push_back(sd2PITC, "sd2PITC");
+    }
 
     //--- creation of version info, durations
     std::ostringstream versionInfos;
     versionInfos << VERSION_CODE  << " built " << BUILT_ID;
     Rcpp::DataFrame durationDetails = Rcpp::DataFrame::create(
       Named("stepName") = chronoReport.stepNames,
-      Named("duration") = chronoReport.durations);
+      Named("duration") = chronoReport.durations,
+      Named("gflopsBySecond") = chronoReport.gigaflopsBySecond(),
+      Named("kernelEvaluationsBySecond") = chronoReport.kernelEvaluationsBySecond(),
+      Named("gbytesBySecond") = chronoReport.gigabytesBySecond());
+    Rcpp::DataFrame counterDetails = Rcpp::DataFrame::create(
+      Named("counterName") = chronoReport.counterNames,
+      Named("value") = chronoReport.counterValues);
+    Rcpp::DataFrame hardwareCounters = Rcpp::DataFrame::create(
+      Named("stepName") = hardwareCounterReport.stepNames,
+      Named("thread") = hardwareCounterReport.threads,
+      Named("cycles") = hardwareCounterReport.cycles,
+      Named("instructions") = hardwareCounterReport.instructions,
+      Named("cacheMisses") = hardwareCounterReport.cacheMisses,
+      Named("branchMisses") = hardwareCounterReport.branchMisses);
+    Rcpp::DataFrame memoryPlanDetails = Rcpp::DataFrame::create(
+      Named("item") = memoryPlan.items,
+      Named("projectedBytes") = memoryPlan.projectedBytes,
+      Named("measuredResidentBytes") = memoryPlan.measuredResidentBytes);
 
     return Rcpp::List::create(
         Rcpp::Named("mean") = (show.nestedKrigingPredictions())?predmean:empty(predmean),
@@ -501,13 +642,17 @@ public:
 
         Rcpp::Named("duration") = chronoReport.totalDuration,
         Rcpp::Named("durationDetails") = durationDetails,
+        Rcpp::Named("counterDetails") = counterDetails,
+        Rcpp::Named("hardwareCounters") = hardwareCounters,
+        Rcpp::Named("memoryPlan") = memoryPlanDetails,
         Rcpp::Named("sourceCode") = versionInfos.str(),
+        Rcpp::Named("trace") = traced ? ChromeTrace::json(traceEvents, droppedTraceEvents) : std::string{},
 
         Rcpp::Named("weights") = (show.predictionBySubmodel())?weights:empty(weights),
-        Rcpp::Named("mean_M") = (show.predictionBySubmodel())?vecvecToMat(mean_M):empty(arma::mat{}),
+        Rcpp::Named("mean_M") = (show.predictionBySubmodel())?arma::mat(mean_MbyGroup.t()):empty(arma::mat{}),
         Rcpp::Named("sd2_M") = (show.predictionBySubmodel())?vecvecToMat(sd2_M):empty(arma::mat{}),
-        Rcpp::Named("K_M") = (show.covariancesBySubmodel())?KM:empty(KM),
-        Rcpp::Named("k_M") = (show.covariancesBySubmodel())?kM:empty(kM)
+        Rcpp::Named("K_M") = (show.covariancesBySubmodel())?allKMofPoints():std::vector<arma::mat>{},
+        Rcpp::Named("k_M") = (show.covariancesBySubmodel())?allkMofPoints():std::vector<arma::vec>{}
       );
   }
 };
@@ -532,13 +677,28 @@ class Algo {
 
   //built in construction:
   const CovarianceParameters covParam;
+  const NumaPlacement numaPlacement;
   const Submodels submodels;
   const Covariance kernel;
   const Long n, q, N;
+  const std::vector<GridStructure> groupGrids; // empty when the kernel or the design cannot use Kronecker products
+  const GridStructure predictionGrid;
+  const std::vector<std::vector<Long> > markovOrders; // sorted order of each group, empty when the kernel is not Markov
+  const NestedKrigingWorkload workload;
   Chrono chrono;
+  Tracer tracer;
+  HardwareCounters hardwareCounters;
+  MemoryPlan memoryPlan;
+  SpillStore spillStore; // before out, whose weights may live in the store
+  CheckpointSchedule checkpoint;
+  const std::uint64_t runFingerprint;
 
   //results of the algorithm
   Output out;
+  std::vector<char> groupDone{}; // progress saved in checkpoints: completed submodels, and
+  Long pairColumnsDone = 0;      // pairs (i,j), i<j, of the columns j < pairColumnsDone
+  IterativeSolverStatistics solverStatistics{};
+  CompressionStatistics partACompression{}, partBCompression{};
 
   template <int ShowProgress, bool computeCov>
   void runRequiredCalculations() {
@@ -546,38 +706,451 @@ class Algo {
     // use implementationChoice for testing new features, e.g. if (implementationChoice==...) ...launch alternative...
     RequiredByUser& required = out.requiredByUser;
 
+    const Long droppedMessagesBefore = Screen::droppedMessages();
     chrono.start();
-    if (looScheme.useLOO) //in all cases run partA, with or without LOO
-        partA_predictEachGroup<ChosenLOOKrigingPredictor, ShowProgress, computeCov>();
-    else
-      partA_predictEachGroup<ChosenPredictor, ShowProgress, computeCov>();
-    chrono.saveStep("partA");
+    hardwareCounters.start();
+    memoryPlan.startMeasures();
+    if (checkpoint.enabled()) restoreCheckpoint();
+    tracedPhase("partA", [&]() { partA_predictEachGroupWithSolverChoice<ShowProgress, computeCov>(); });
+    saveStep("partA", countedIf(denseSubmodelSolves(), workload.partA(computeCov)));
+    saveSolverStatistics();
+    saveCompressionStatistics("partA.hodlr", partACompression);
 
     if (required.nestedKrigingPredictions()) {
-      partB_interGroupCovariance<ShowProgress, computeCov>();
-      chrono.saveStep("partB");
-      partC_agregateFirstLayer<ShowProgress>();
-      chrono.saveStep("partC");
+      tracedPhase("partB", [&]() { partB_interGroupCovariance<ShowProgress, computeCov>(); });
+      saveStep("partB", partBWorkload(computeCov));
+      saveCompressionStatistics("partB.aca", partBCompression);
+      tracedPhase("partC", [&]() { partC_agregateFirstLayer<ShowProgress>(); });
+      saveStep("partC", countedIf(!useMixedPrecision(), workload.partC()));
     }
 
     if (computeCov) { //C++17 if constexpr, compile time test
-      partD_crossCovComputations<ShowProgress, computeCov>();
-      chrono.saveStep("partD");
+      tracedPhase("partD", [&]() { partD_crossCovComputations<ShowProgress, computeCov>(); });
+      saveStep("partD", workload.partD());
     }
 
     if (required.alternatives()) {
-      partE_Alternatives<ShowProgress>();
-      chrono.saveStep("partE");
+      tracedPhase("partE", [&]() { partE_Alternatives<ShowProgress>(); });
+      saveStep("partE", workload.partE());
+      if (useInducingPoints()) {
+        partF_InducingPoints();
+        saveStep("partF");
+      }
     }
+    saveNumaPlacement();
+    saveOutOfCoreStore();
+    saveCheckpoints();
+    saveDroppedMessages(droppedMessagesBefore);
+    saveTrace();
+    saveHardwareCounters();
+    out.memoryPlan = memoryPlan;
     out.chronoReport = chrono.report;
   }
 
+  void saveStep(const std::string& stepName, const Workload& stepWorkload = Workload{}) {
+    chrono.saveStep(stepName, stepWorkload);
+    hardwareCounters.saveStep(stepName);
+    memoryPlan.measure(stepName);
+  }
+
+  bool dryRun() const {
+    return options.getOptionValue(GlobalOptions::Option::dryRun)==1;
+  }
+
+  MemoryPlan checkedMemoryPlan() const {
+    // before any allocation of results
+    const RequiredByUser required(outputDetailLevel);
+    const MemoryPlan plan(groupSizes(), n, q, d, parallelism.getBoundedThreadsNumber<Parallelism::innerContext>(),
+                         required.alternatives(), required.covariances(), outOfCoreBudgetBytes());
+    plan.checkBudget(1048576.0*options.getOptionValue(GlobalOptions::Option::memoryBudget));
+    return plan;
+  }
+
+  double outOfCoreBudgetBytes() const {
+    return 1048576.0*options.getOptionValue(GlobalOptions::Option::outOfCore);
+  }
+
+  bool useOutOfCoreStore() const {
+    return (outOfCoreBudgetBytes()>0) && (!dryRun());
+  }
+
+  void saveOutOfCoreStore() {
+    // the weights are scratch data, not kept after the run (the store is unmapped with the Algo)
+    if (!spillStore.enabled()) return;
+    chrono.report.saveCounter("outOfCore.storeBytes", spillStore.storeBytes());
+    chrono.report.saveCounter("outOfCore.tiles", spillStore.numberOfTiles());
+    chrono.report.saveCounter("outOfCore.tileLoads", spillStore.tileLoads);
+    chrono.report.saveCounter("outOfCore.bytesPrefetched", spillStore.bytesPrefetched);
+    out.alpha = std::vector<arma::mat>(N);
+  }
+
+  bool useCheckpoints() const {
+    // partA and partB results only: without LOO errors nor cross-covariances, that are not saved
+    return (options.getOptionValue(GlobalOptions::Option::checkpoint)>0) && (!dryRun()) && (!looScheme.useLOO)
+           && (!RequiredByUser(outputDetailLevel).covariances());
+  }
+
+  std::uint64_t fingerprintOfRun(const arma::mat& X, const arma::vec& Y, const arma::mat& x, const arma::vec& param,
+                                 const std::string& covType, const NuggetVector& nugget) const {
+    // inputs and options that change the saved results, diagnostic options excepted
+    Fingerprint fingerprint;
+    fingerprint.add(std::string("nestedKriging")).add(X).add(Y).add(x).add(param).add(covType).add(nugget);
+    fingerprint.add(sd2).add(ordinaryKriging ? 1.0 : 0.0).add(groupSizes());
+    for(Long i=0; i<N; ++i) fingerprint.add(submodels.splittedY[i]);
+    for(const GlobalOptions::Option option: options.allOptions)
+      if (!GlobalOptions::isDiagnostic(option)) fingerprint.add(static_cast<double>(options.getOptionValue(option)));
+    return fingerprint.value();
+  }
+
+  void restoreCheckpoint() {
+    // results of a previous run with the same inputs, its completed submodels and pair columns are skipped
+    groupDone.assign(N, 0);
+    CheckpointRecords records;
+    if (!records.loadRun(checkpoint.path, runFingerprint)) return;
+    const std::vector<double>& done = records.get("groupDone");
+    if (done.size()!=N) throw std::runtime_error("checkpoint: " + checkpoint.path + " has another number of groups");
+    Long resumedGroups = 0;
+    for(Long i=0; i<N; ++i) if (done[i]>0) {
+      out.alpha[i] = records.getMatrix("alpha." + std::to_string(i), submodels.splittedX[i].size(), q);
+      spillStore.releaseGroup(i);
+      groupDone[i] = 1;
+      ++resumedGroups;
+    }
+    out.mean_MbyGroup = records.getMatrix("mean_MbyGroup", q, N);
+    out.kMbyGroup = records.getMatrix("kMbyGroup", q, N);
+    out.KMbyPair = records.getMatrix("KMbyPair", q, PackedSymMatrix::packedSize(N));
+    pairColumnsDone = static_cast<Long>(records.get("pairColumnsDone").at(0));
+    chrono.report.saveCounter("checkpoint.resumedGroups", resumedGroups);
+    chrono.report.saveCounter("checkpoint.resumedPairColumns", pairColumnsDone);
+  }
+
+  void writeCheckpoint() {
+    // results are written from their own memory, between two parallel loops
+    CheckpointRecords records;
+    records.set("kind", std::vector<double>{1.0});
+    records.set("groupDone", std::vector<double>(groupDone.begin(), groupDone.end()));
+    for(Long i=0; i<N; ++i) if (groupDone[i]) records.setView("alpha." + std::to_string(i), out.alpha[i]);
+    records.setView("mean_MbyGroup", out.mean_MbyGroup);
+    records.setView("kMbyGroup", out.kMbyGroup);
+    records.setView("KMbyPair", out.KMbyPair);
+    records.set("pairColumnsDone", std::vector<double>{static_cast<double>(pairColumnsDone)});
+    checkpoint.write(records, runFingerprint);
+  }
+
+  void saveDroppedMessages(const Long droppedMessagesBefore) {
+    // messages lost because the log queue was full during the run
+    const Long dropped = Screen::droppedMessages() - droppedMessagesBefore;
+    if (dropped>0) chrono.report.saveCounter("screen.droppedMessages", dropped);
+  }
+
+  void saveCheckpoints() {
+    if (!checkpoint.enabled()) return;
+    chrono.report.saveCounter("checkpoint.writes", checkpoint.writes);
+  }
+
+  bool useHardwareCounters() const {
+    // not in a task pool: counters are opened per thread of the inner context, whereas any thread of the pool
+    // may run the tasks of the zone
+    return (options.getOptionValue(GlobalOptions::Option::hardwareCounters)>0) && (!parallelism.inTaskPool());
+  }
+
+  void saveHardwareCounters() {
+    if (options.getOptionValue(GlobalOptions::Option::hardwareCounters)<=0) return;
+    chrono.report.saveCounter("hardwareCounters.available", hardwareCounters.available() ? 1 : 0);
+    if (parallelism.inTaskPool()) chrono.report.saveCounter("hardwareCounters.disabledInTaskPool", 1);
+    if (hardwareCounters.totalsOnly()) chrono.report.saveCounter("hardwareCounters.totalsOnly", 1);
+    out.hardwareCounterReport = hardwareCounters.report;
+  }
+
+  template <int ShowProgress, bool computeCov>
+  void partA_predictEachGroupWithSolverChoice() {
+    if (looScheme.useLOO) //in all cases run partA, with or without LOO
+        partA_predictEachGroup<ChosenLOOKrigingPredictor, ShowProgress, computeCov>();
+    else if (useCompactSupport())
+      partA_predictEachGroup<BandedKrigingPredictor, ShowProgress, computeCov>();
+    else if (useMarkovStructure())
+      partA_predictEachGroup<MarkovExpKrigingPredictor, ShowProgress, computeCov>();
+    else if (covParam.markovStateDimension()==2)
+      partA_predictEachGroup<StateSpaceKrigingPredictor<2>, ShowProgress, computeCov>();
+    else if (covParam.markovStateDimension()==3)
+      partA_predictEachGroup<StateSpaceKrigingPredictor<3>, ShowProgress, computeCov>();
+    else if (useKroneckerGrids())
+      partA_predictEachGroup<KroneckerKrigingPredictor, ShowProgress, computeCov>();
+    else if (useHierarchicalMatrices())
+      partA_predictEachGroup<HierarchicalKrigingPredictor, ShowProgress, computeCov>();
+    else if (useIterativeSolver())
+      partA_predictEachGroup<IterativeKrigingPredictor, ShowProgress, computeCov>();
+    else if (useMixedPrecision())
+      partA_predictEachGroup<MixedPrecisionKrigingPredictor, ShowProgress, computeCov>();
+    else if (usePackedStorage())
+      partA_predictEachGroup<PackedKrigingPredictor, ShowProgress, computeCov>();
+    else
+      partA_predictEachGroup<ChosenPredictor, ShowProgress, computeCov>();
+  }
+
+  std::vector<Long> groupSizes() const {
+    std::vector<Long> sizes(N);
+    for(Long i=0; i<N; ++i) sizes[i] = submodels.splittedX[i].size();
+    return sizes;
+  }
+
+  static Workload countedIf(const bool counted, const Workload& stepWorkload) {
+    // workload counts are those of the dense algorithm, no count (zero rates) for steps run by other solvers
+    return counted ? stepWorkload : Workload{};
+  }
+
+  bool denseSubmodelSolves() const {
+    // partA with Cholesky factorizations: LOO, packed storage, default solver
+    if (looScheme.useLOO) return true;
+    const bool stateSpace = (covParam.markovStateDimension()==2) || (covParam.markovStateDimension()==3);
+    return !(useCompactSupport() || useMarkovStructure() || stateSpace || useKroneckerGrids()
+             || useHierarchicalMatrices() || useIterativeSolver() || useMixedPrecision());
+  }
+
+  Workload partBWorkload(const bool computeCov) const {
+    if ((!computeCov) && useRandomFeatures())
+      return workload.partBRandomFeatures(options.getOptionValue(GlobalOptions::Option::randomFeatures));
+    const bool denseCrossCorrelations = !(useCompactSupport() || useMarkovStructure() || useKroneckerGrids()
+                                          || ((!computeCov) && useHierarchicalMatrices()));
+    return countedIf(denseCrossCorrelations, workload.partB(computeCov));
+  }
+
+  template <typename ItemFunction>
+  void forEachItem(const Long numberOfItems, ItemFunction item) {
+    // in a task pool, one task by item, run by any idle thread of the pool (e.g. one of another zone);
+    // otherwise a loop over the threads of the inner context. Returns when all items are done.
+    parallelism.switchToContext<Parallelism::innerContext>();
+    if (parallelism.inTaskPool()) {
+      #pragma omp taskloop grainsize(1)
+      for(Long w=0; w<numberOfItems; ++w) item(w);
+    }
+    else {
+      #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE)
+      for(Long w=0; w<numberOfItems; ++w) item(w);
+    }
+  }
+
+  template <typename GroupFunction>
+  void forEachGroup(GroupFunction group) {
+    // with checkpoints, the groups not done by chunks; with a NUMA placement, each group on the thread that
+    // first touched its data
+    if (checkpoint.enabled()) forEachRemainingGroup(group);
+    else if (numaPlacement.enabled()) numaPlacement.forEachGroup(N, group);
+    else forEachItem(N, group);
+  }
+
+  template <typename GroupFunction>
+  void forEachRemainingGroup(GroupFunction group) {
+    // chunks of a few groups by thread, a checkpoint is written after a chunk when due, and after the last one
+    std::vector<Long> remaining{};
+    for(Long i=0; i<N; ++i) if (!groupDone[i]) remaining.push_back(i);
+    const Long chunkSize = 4*static_cast<Long>(parallelism.getBoundedThreadsNumber<Parallelism::innerContext>()) + 1;
+    for(Long begin=0; begin<remaining.size(); begin+=chunkSize) {
+      const Long end = std::min<Long>(begin+chunkSize, remaining.size());
+      forEachItem(end-begin, [&](const Long k) { group(remaining[begin+k]); });
+      for(Long k=begin; k<end; ++k) groupDone[remaining[k]] = 1;
+      if (checkpoint.due() || (end==remaining.size())) writeCheckpoint();
+    }
+  }
+
+  template <typename PairFunction>
+  void forEachRemainingPairColumn(PairFunction pair) {
+    // ranges of columns j with about N pairs (i,j), i<j, a checkpoint is written after a range when due,
+    // and after the last one
+    for(Long jBegin=std::max<Long>(pairColumnsDone, 1); jBegin<N; ) {
+      std::vector<Long> pairs{};
+      Long jEnd = jBegin;
+      for(; (jEnd<N) && (pairs.size()<N); ++jEnd)
+        for(Long i=0; i<jEnd; ++i) pairs.push_back(i*N+jEnd);
+      forEachItem(pairs.size(), [&](const Long p) { pair(pairs[p]/N, pairs[p]%N); });
+      pairColumnsDone = jBegin = jEnd;
+      if (checkpoint.due() || (jEnd==N)) writeCheckpoint();
+    }
+  }
+
+  template <typename PairFunction>
+  void forEachPairOfGroups(PairFunction pair) {
+    // pairs i<j, with a NUMA placement first on the node of group j (Kij alpha_j reads X_j and alpha_j),
+    // with an out-of-core store tile pair by tile pair, the weights of the next tiles being prefetched,
+    // with checkpoints column by column, from the first column not done
+    if (checkpoint.enabled()) forEachRemainingPairColumn(pair);
+    else if (spillStore.enabled())
+      spillStore.forEachTilePair([&](const std::vector<Long>& pairs) {
+        forEachItem(pairs.size(), [&](const Long p) { pair(pairs[p]/N, pairs[p]%N); });
+      });
+    else if (numaPlacement.enabled()) numaPlacement.forEachPair(N, pair);
+    else forEachItem(N*N, [&](const Long w) { if (w/N < w%N) pair(w/N, w%N); });
+  }
+
+  bool useNumaPlacement() const {
+    // not in a task pool, where zones share the threads
+    return (options.getOptionValue(GlobalOptions::Option::numaPlacement)==1) && (!parallelism.inTaskPool());
+  }
+
+  void saveNumaPlacement() {
+    if (!numaPlacement.enabled()) return;
+    chrono.report.saveCounter("numa.nodes", numaPlacement.numberOfNodes());
+    chrono.report.saveCounter("numa.threadsBound", numaPlacement.threadsBound() ? 1 : 0);
+  }
+
+  template <typename Phase>
+  void tracedPhase(const char* name, Phase phase) {
+    // the phase event gives the end of the phase, threads idle before it appear as waits in the trace
+    TraceScope phaseScope(tracer, "phase", name);
+    phase();
+  }
+
+  Long traceCapacity() const {
+    const int capacity = options.getOptionValue(GlobalOptions::Option::trace);
+    return (capacity>0) ? static_cast<Long>(capacity) : 0;
+  }
+
+  int numThreadsForTrace() const {
+    // one ring buffer by thread number that may record: threads of the inner context loops,
+    // or of the enclosing zones loop for phases (AlgoZones)
+    int numThreads = parallelism.getThreadsNumber<Parallelism::innerContext>();
+    numThreads = std::max(numThreads, parallelism.getBoundedThreadsNumber<Parallelism::innerContext>());
+    #if defined(_OPENMP)
+      numThreads = std::max(numThreads, std::max(omp_get_max_threads(), omp_get_num_threads()));
+    #endif
+    return numThreads;
+  }
+
+  void saveTrace() {
+    if (!tracer.enabled()) return;
+    out.traced = true;
+    out.traceEvents = tracer.events();
+    out.droppedTraceEvents = tracer.droppedEvents();
+    chrono.report.saveCounter("trace.events", out.traceEvents.size());
+    chrono.report.saveCounter("trace.droppedEvents", out.droppedTraceEvents);
+  }
+
+  int numThreadsByGroupForFill() const {
+    // threads given to each Ki fill in partA, only when the groups loop leaves spare threads
+    // and when not already inside a parallel region (e.g. AlgoZones)
+    const Long numThreads = parallelism.getBoundedThreadsNumber<Parallelism::innerContext>();
+    #if defined(_OPENMP)
+      if ((N<numThreads) && (!omp_in_parallel())) return static_cast<int>(numThreads/N);
+    #endif
+    return 1;
+  }
+
+  bool useMixedPrecision() const {
+    return options.getOptionValue(GlobalOptions::Option::mixedPrecision)==1;
+  }
+
+  bool usePackedStorage() const {
+    return options.getOptionValue(GlobalOptions::Option::packedStorage)==1;
+  }
+
+  bool useCompactSupport() const {
+    // sparse Ki, always used when available (covType="wendland1", "wendland2", "*_tapered")
+    return covParam.hasCompactSupport();
+  }
+
+  bool crossCorrelationsVanish(const Long i, const Long j) const {
+    return useCompactSupport() && NeighbourSearch::farApart(submodels.splittedX[i], submodels.splittedX[j], kernel.supportRadius());
+  }
+
+  bool useMarkovStructure() const {
+    // exact O(ni) solves and O(ni+nj) cross products, always used when available (d=1, covType="exp")
+    return covParam.isOneDimensionalExponential();
+  }
+
+  std::vector<std::vector<Long> > sortedMarkovOrders() const {
+    // sorted once by group, instead of both groups at each pair of partB
+    std::vector<std::vector<Long> > orders{};
+    if (!useMarkovStructure()) return orders;
+    for(Long i=0; i<N; ++i) orders.push_back(MarkovExp::sortedOrder(submodels.splittedX[i]));
+    return orders;
+  }
+
+  std::vector<GridStructure> detectGroupGrids() const {
+    // gridded submodels (e.g. simulation outputs) with a separable kernel have Kronecker correlation matrices
+    std::vector<GridStructure> grids{};
+    if ((d<2) || (!covParam.isSeparable()) || looScheme.useLOO) return grids;
+    for(Long i=0; i<N; ++i) grids.emplace_back(submodels.splittedX[i]);
+    return grids;
+  }
+
+  bool useKroneckerGrids() const {
+    // exact, used when available, whatever the other solver options; non gridded groups fall back to Cholesky
+    for(const GridStructure& grid: groupGrids) if (grid.hasSeveralAxes()) return true;
+    return false;
+  }
+
+  bool useRandomFeatures() const {
+    return (options.getOptionValue(GlobalOptions::Option::randomFeatures)>0) && SpectralDensity(covParam).available();
+  }
+
+  bool useInducingPoints() const {
+    // not with LOO: inducing point predictions at X are not leave-one-out predictions
+    return (options.getOptionValue(GlobalOptions::Option::inducingPoints)>0) && (!looScheme.useLOO);
+  }
+
+  bool useHierarchicalMatrices() const {
+    return options.getOptionValue(GlobalOptions::Option::hierarchicalMatrices)>0;
+  }
+
+  double compressionTolerance() const {
+    return std::pow(10.0, -options.getOptionValue(GlobalOptions::Option::hierarchicalMatrices));
+  }
+
+  bool useIterativeSolver() const {
+    return options.getOptionValue(GlobalOptions::Option::iterativeSolver)==1;
+  }
+
+  template <typename CovMatrix>
+  void prepareCovMatrix(CovMatrix& Ki, const Long i, const int numThreadsFill) const {
+    kernel.fillAllocatedCorrMatrix(Ki, submodels.splittedX[i], submodels.splittedNuggets[i], numThreadsFill);
+  }
+
+  void prepareCovMatrix(KernelOperator& Ki, const Long i, const int numThreadsFill) const {
+    Ki.bind(kernel, submodels.splittedX[i], submodels.splittedNuggets[i], numThreadsFill);
+  }
+
+  void prepareCovMatrix(CompressibleKernelOperator& Ki, const Long i, const int numThreadsFill) const {
+    Ki.bind(kernel, submodels.splittedX[i], submodels.splittedNuggets[i], numThreadsFill);
+    Ki.tolerance = compressionTolerance();
+  }
+
+  template <typename CovMatrix>
+  void collectSolverStatistics(const CovMatrix&) {}
+
+  void collectSolverStatistics(const CompressibleKernelOperator& Ki) {
+    #pragma omp critical
+    partACompression.add(Ki.compression);
+  }
+
+  void collectSolverStatistics(const KernelOperator& Ki) {
+    #pragma omp critical
+    solverStatistics.add(Ki.statistics);
+  }
+
+  void saveSolverStatistics() {
+    if (solverStatistics.solves==0) return;
+    chrono.report.saveCounter("partA.cgSolves", solverStatistics.solves);
+    chrono.report.saveCounter("partA.cgTotalIterations", solverStatistics.totalIterations);
+    chrono.report.saveCounter("partA.cgMaxIterations", solverStatistics.maxIterations);
+    chrono.report.saveCounter("partA.cgMaxRelativeResidual", solverStatistics.maxRelativeResidual);
+    chrono.report.saveCounter("partA.cgTolerance", PreconditionedConjugateGradient::tolerance);
+  }
+
+  void saveCompressionStatistics(const std::string& prefix, const CompressionStatistics& statistics) {
+    if ((statistics.compressedBlocks==0) && (statistics.denseFallBacks==0)) return;
+    chrono.report.saveCounter(prefix + "CompressedBlocks", statistics.compressedBlocks);
+    chrono.report.saveCounter(prefix + "MaxRank", statistics.maxRank);
+    if (statistics.denseFallBacks>0) chrono.report.saveCounter(prefix + "DenseFallBacks", statistics.denseFallBacks);
+    chrono.report.saveCounter(prefix + "Tolerance", compressionTolerance());
+  }
+
   template <int ShowProgress>
   void run() {
 
     try{
       if (out.requiredByUser.covariances()) runRequiredCalculations<ShowProgress, true>();
       else runRequiredCalculations<ShowProgress, false>();
+      Screen::flush(); // messages queued by threads after the last print
     }
     catch(const std::exception& e) {
       Screen::error("in Algo.run", e);
@@ -592,13 +1165,27 @@ public:
       : parallelism(parallelism), d(X.n_cols), sd2(sd2), ordinaryKriging(ordinaryKriging), tag(tag),
       verboseLevel(verboseLevel), outputDetailLevel(outputDetailLevel), options(options), looScheme(looScheme),
       covParam(d, param, sd2, covType),
-      submodels(X, x, Y, covParam, splitter, nugget),
+      numaPlacement(useNumaPlacement(), parallelism.getBoundedThreadsNumber<Parallelism::innerContext>()),
+      submodels(X, x, Y, covParam, splitter, nugget, numaPlacement),
       kernel(covParam),
-      n(X.n_rows), q(x.n_rows), N(submodels.N), chrono(screen, tag),
-      out(N, q, outputDetailLevel)
+      n(X.n_rows), q(x.n_rows), N(submodels.N),
+      groupGrids(detectGroupGrids()), predictionGrid(groupGrids.empty()?GridStructure():GridStructure(submodels.predictionPoints)),
+      markovOrders(sortedMarkovOrders()),
+      workload(groupSizes(), q, d, ordinaryKriging),
+      chrono(screen, tag),
+      tracer(traceCapacity(), numThreadsForTrace()),
+      hardwareCounters(useHardwareCounters(), parallelism.getBoundedThreadsNumber<Parallelism::innerContext>(),
+                       numThreadsByGroupForFill()>1),
+      memoryPlan(checkedMemoryPlan()),
+      spillStore(useOutOfCoreStore(), groupSizes(), q, outOfCoreBudgetBytes()),
+      checkpoint(useCheckpoints() ? options.getOptionValue(GlobalOptions::Option::checkpoint) : 0),
+      runFingerprint(useCheckpoints() ? fingerprintOfRun(X, Y, x, param, covType, nugget) : 0),
+      out(dryRun() ? Output() : Output(N, q, outputDetailLevel))
   {
     constexpr int showProgress=1, noShowProgress=0;
-    if (verboseLevel>0) run<showProgress>();
+    if (spillStore.enabled()) out.alpha = spillStore.matrices(); // vector moved, matrices stay on the store
+    if (dryRun()) out.memoryPlan = memoryPlan;
+    else if (verboseLevel>0) run<showProgress>();
     else run<noShowProgress>();
   }
 
@@ -606,14 +1193,17 @@ template <typename PredictorType, int ShowProgress, bool computeCov>
 void partA_predictEachGroup() {
   chrono.print("Part A, first layer, prediction for each group: starting...");
   ProgressBar<ShowProgress> progressBar(chrono, N, verboseLevel);
-  parallelism.switchToContext<Parallelism::innerContext>();
-#pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE)// Main label (A)
-  for(Long i=0; i<N; ++i) {
+  // fewer groups than threads (few large submodels, full Kriging N=1): spare threads fill Ki, using nested parallelism
+  const int numThreadsFill = numThreadsByGroupForFill();
+  if (numThreadsFill>1) Parallelism::set_nested(1);
+  forEachGroup([&](const Long i) { // Main label (A)
+    TraceScope traceScope(tracer, "partA", "submodel", static_cast<long>(i));
     Long ni= submodels.splittedX[i].size(), q= submodels.predictionPoints.size();
 
-    arma::mat Ki(ni, ni), ki(ni,q);
-    kernel.fillAllocatedCorrMatrix(Ki, submodels.splittedX[i], submodels.splittedNuggets[i]);
-    kernel.fillAllocatedCrossCorrelations(ki, submodels.splittedX[i], submodels.predictionPoints);
+    typename PredictorType::CovMatrix Ki(ni, ni);
+    arma::mat ki(ni,q);
+    prepareCovMatrix(Ki, i, numThreadsFill);
+    fillCrossCorrelationsWithPredictionPoints(ki, i);
 
     LOOExclusions looExclusions(looScheme, i);
     PredictorType krigingPredictor(Ki, ki, submodels.splittedY[i], ordinaryKriging, looExclusions);
@@ -622,18 +1212,24 @@ void partA_predictEachGroup() {
     std::vector<double> cov_MY(q);
     std::vector<double> cov_MM(q);
     krigingPredictor.fillResults(out.alpha[i], mean_M, cov_MY, cov_MM);
+    collectSolverStatistics(Ki);
 
+    double* mean_Mi = out.mean_MbyGroup.colptr(i);
+    double* kMi = out.kMbyGroup.colptr(i);
+    double* KMii = out.KMbyPair.colptr(PackedSymMatrix::index(i,i));
     for(Long m=0;m<q;++m){
-      out.mean_M[m](i) = mean_M[m];
-      out.kM[m](i) = cov_MY[m];
-      out.KM[m](i,i) = cov_MM[m];
+      mean_Mi[m] = mean_M[m];
+      kMi[m] = cov_MY[m];
+      KMii[m] = cov_MM[m];
     }
     if (computeCov) { //C++17 if constexpr(computeCov), compile-time test
       arma::mat Zi = out.alpha[i].t() * ki; // q x q matrix
       for(Long m1=0;m1<q;++m1) for(Long m2=0;m2<q;++m2) out.kkM[m1][m2](i) = Zi(m1,m2);
     }
+    spillStore.releaseGroup(i);
     progressBar.next();
-  }
+  });
+  if (numThreadsFill>1) Parallelism::set_nested(0);
   chrono.print("Part A, first layer, prediction for each group: done.");
 }
 
@@ -643,22 +1239,21 @@ void partB_interGroupCovariance_WithCov() {
   // Still experimental, think about the cases m1<m2 and the case i=j
   // we have arma::diagvec(out.KKM[m1][m2])=out.kkM[m1][m1] in simpleKriging case only
   ProgressBar<ShowProgress> progressBar(chrono, N*(N+1)/2, verboseLevel);
-  parallelism.switchToContext<Parallelism::innerContext>();
-  #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE) collapse(2)
-    for(Long i=0; i<N; ++i)
-      for(Long j=0; j<N; ++j) {
-        if (i<=j) { //caution, j must start at 0 if modified into (i<=j)
-          arma::mat Kij(submodels.splittedX[i].size(), submodels.splittedX[j].size()); // ni x nj
-          kernel.fillAllocatedCrossCorrelations(Kij, submodels.splittedX[i], submodels.splittedX[j]);
-          arma::mat Zij {  Kij * out.alpha[j] }; // Zij has size ni x q
+  forEachItem(N*N, [&](const Long w) {
+        const Long i = w/N, j = w%N;
+        if (i<=j) {
+          TraceScope traceScope(tracer, "partB", "pair", static_cast<long>(i), static_cast<long>(j));
+          arma::mat Zij = crossCorrelationsTimes(i, j, out.alpha[j]); // Zij has size ni x q
           for(Long m1=0; m1<q; ++m1)
             for(Long m2=0; m2<q; ++m2)
               out.KKM[m1][m2].at(i,j) = out.KKM[m2][m1].at(j,i) = arma::dot(out.alpha[i].col(m1), Zij.col(m2));
               //caution, swap both m1, m2 and i,j as cov[Mi(x), Mj(x')]=cov[Mj(x'),Mi(x)]
           progressBar.next();
           }
-        }
-  for(Long m=0;m<q;++m) out.KM[m] = out.KKM[m][m]; //avoidable copy if selected use of KKM or KM
+        });
+  for(Long j=0; j<N; ++j) //avoidable copy if selected use of KKM or KMbyPair
+    for(Long i=0; i<=j; ++i)
+      for(Long m=0; m<q; ++m) out.KMbyPair.at(m, PackedSymMatrix::index(i,j)) = out.KKM[m][m].at(i,j);
   chrono.print("Part B with cross-cov, inter-groups covariances: done.");
 }
 
@@ -667,27 +1262,71 @@ void partB_interGroupCovariance_WithoutCov() {
   // Warning: part of critical importance for the performance of the Algo
   chrono.print("Part B inter-groups covariances: starting...");
   ProgressBar<ShowProgress> progressBar(chrono, N*(N-1)/2, verboseLevel);
-  parallelism.switchToContext<Parallelism::innerContext>();
-    #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE) collapse(2)
-    for(Long i=0; i<N; ++i)
-      for(Long j=1; j<N; ++j) {
-        if (i<j) {
-          arma::mat Kij(submodels.splittedX[i].size(), submodels.splittedX[j].size()); // ni x nj
-          kernel.fillAllocatedCrossCorrelations(Kij, submodels.splittedX[i], submodels.splittedX[j]);
-          arma::mat Zij {  Kij * out.alpha[j] }; // Zij has size ni x q
-          for(Long m=0;m<q;++m)
-              out.KM[m].at(i,j) = out.KM[m].at(j,i) = arma::dot(out.alpha[i].col(m), Zij.col(m));
+    forEachPairOfGroups([&](const Long i, const Long j) {
+          TraceScope traceScope(tracer, "partB", "pair", static_cast<long>(i), static_cast<long>(j));
+          double* KMij = out.KMbyPair.colptr(PackedSymMatrix::index(i,j)); // all pred points of pair (i,j) are contiguous
+          if (crossCorrelationsVanish(i, j)) { // compact support, groups far apart: Kij = 0
+            for(Long m=0;m<q;++m) KMij[m] = 0.0;
+          }
+          else {
+            arma::mat Zij; // Zij has size ni x q
+            if (!(useHierarchicalMatrices() && compressedCrossCorrelationsTimes(i, j, out.alpha[j], Zij)))
+              Zij = crossCorrelationsTimes(i, j, out.alpha[j]);
+            for(Long m=0;m<q;++m)
+                KMij[m] = arma::dot(out.alpha[i].col(m), Zij.col(m));
+          }
           progressBar.next();
-        }
-    }
+    });
   chrono.print("Part B inter-groups covariances: done.");
 }
 
+bool compressedCrossCorrelationsTimes(const Long i, const Long j, const arma::mat& weights, arma::mat& result) {
+  // ACA of the ni x nj block when both groups are large, false when it is not of low rank (dense fallback)
+  const Points& pointsA = submodels.splittedX[i];
+  const Points& pointsB = submodels.splittedX[j];
+  const Long smallest = (pointsA.size()<pointsB.size()) ? pointsA.size() : pointsB.size();
+  if (smallest<HierarchicalMatrix::leafSize) return false;
+  const AdaptiveCrossApproximation aca(pointsA.size(), pointsB.size(),
+          [&](Long a, Long b) { return kernel.crossCorrelation(pointsA, a, pointsB, b); }, compressionTolerance(), smallest/4);
+  if (!aca.converged) return false;
+  result = aca.U * (aca.V.t() * weights);
+  #pragma omp critical
+  partBCompression.add(aca.rank());
+  return true;
+}
+
+void fillCrossCorrelationsWithPredictionPoints(arma::mat& ki, const Long i) const {
+  if ((!groupGrids.empty()) && groupGrids[i].valid() && predictionGrid.valid())
+    KroneckerGrid::fillAllocatedCrossCorrelations(ki, kernel, groupGrids[i], predictionGrid);
+  else
+    kernel.fillAllocatedCrossCorrelations(ki, submodels.splittedX[i], submodels.predictionPoints);
+}
+
+bool onGrids(const Long i, const Long j) const {
+  return (!groupGrids.empty()) && groupGrids[i].valid() && groupGrids[j].valid();
+}
+
+arma::mat crossCorrelationsTimes(const Long i, const Long j, const arma::mat& weights) const {
+  // k(X_i, X_j) * weights, without storing the ni x nj cross-correlations when the kernel is Markov, compact or on grids
+  if (useCompactSupport()) return NeighbourSearch::crossCorrelationsTimes(kernel, submodels.splittedX[i], submodels.splittedX[j], weights);
+  if (useMarkovStructure())
+    return MarkovExp::crossProduct(submodels.splittedX[i], markovOrders[i], submodels.splittedX[j], markovOrders[j], weights);
+  if (onGrids(i, j))
+    return KroneckerGrid::crossCorrelationsTimes(kernel, groupGrids[i], groupGrids[j], weights);
+  arma::mat Kij(submodels.splittedX[i].size(), submodels.splittedX[j].size()); // ni x nj
+  kernel.fillAllocatedCrossCorrelations(Kij, submodels.splittedX[i], submodels.splittedX[j]);
+  return Kij * weights;
+}
+
 template <int ShowProgress, bool ComputeCov>
   void partB_interGroupCovariance() {
     if (ComputeCov) {
       partB_interGroupCovariance_WithCov<ShowProgress>();
     } else {
+      if (useRandomFeatures()) {
+        partB_interGroupCovariance_RandomFeatures<ShowProgress>();
+        return;
+      }
       long implementationChoice = options.getOptionValue(GlobalOptions::Option::implAlgoB);
       switch (implementationChoice)  {
       case 1:
@@ -699,21 +1338,91 @@ template <int ShowProgress, bool ComputeCov>
     }
   }
 
+template <int ShowProgress>
+void partB_interGroupCovariance_RandomFeatures() {
+  // approximate KM(x) off-diagonal items, diagonal items come exactly from partA
+  chrono.print("Part B inter-groups covariances, random features: starting...");
+  const RandomFourierFeatures features(covParam, d, options.getOptionValue(GlobalOptions::Option::randomFeatures));
+  const Long D = features.numberOfFeatures();
+  std::vector<arma::mat> projections(N); // D x q by group
+  parallelism.switchToContext<Parallelism::innerContext>();
+  #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE)
+  for(Long i=0; i<N; ++i) {
+    TraceScope traceScope(tracer, "partB", "projection", static_cast<long>(i));
+    projections[i] = features.projection(submodels.splittedX[i], out.alpha[i]);
+  }
+  ProgressBar<ShowProgress> progressBar(chrono, q, verboseLevel);
+  #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE)
+  for(Long m=0; m<q; ++m) {
+    TraceScope traceScope(tracer, "partB", "gram", static_cast<long>(m));
+    arma::mat projectionsOfPoint(D, N);
+    for(Long i=0; i<N; ++i) projectionsOfPoint.col(i) = projections[i].col(m);
+    const arma::mat gram = projectionsOfPoint.t()*projectionsOfPoint;
+    for(Long j=1; j<N; ++j)
+      for(Long i=0; i<j; ++i) out.KMbyPair.at(m, PackedSymMatrix::index(i,j)) = gram.at(i,j);
+    progressBar.next();
+  }
+  saveRandomFeaturesDiagnostics(D);
+  chrono.print("Part B inter-groups covariances, random features: done.");
+}
+
+void saveRandomFeaturesDiagnostics(const Long D) {
+  // exact alpha_i^T K_ij alpha_j on a sample of pairs, errors relative to sqrt(KM_ii KM_jj)
+  constexpr Long maxSampledPairs = 32;
+  const Long numberOfPairs = N*(N-1)/2;
+  const Long sampledPairs = (numberOfPairs<maxSampledPairs) ? numberOfPairs : maxSampledPairs;
+  double maxAbsoluteError = 0.0, maxRelativeError = 0.0;
+  Long pair = 0, sample = 0;
+  for(Long j=1; (j<N) && (sample<sampledPairs); ++j)
+    for(Long i=0; (i<j) && (sample<sampledPairs); ++i, ++pair) {
+      if ((pair*sampledPairs)/numberOfPairs != sample) continue; // evenly spread pairs
+      ++sample;
+      const arma::mat Zij = crossCorrelationsTimes(i, j, out.alpha[j]);
+      const double* KMii = out.KMbyPair.colptr(PackedSymMatrix::index(i,i));
+      const double* KMjj = out.KMbyPair.colptr(PackedSymMatrix::index(j,j));
+      const double* KMij = out.KMbyPair.colptr(PackedSymMatrix::index(i,j));
+      for(Long m=0; m<q; ++m) {
+        const double error = std::fabs(KMij[m] - arma::dot(out.alpha[i].col(m), Zij.col(m)));
+        const double scale = std::sqrt(KMii[m]*KMjj[m]);
+        maxAbsoluteError = std::max(maxAbsoluteError, error);
+        if (scale>0) maxRelativeError = std::max(maxRelativeError, error/scale);
+      }
+    }
+  chrono.report.saveCounter("partB.rffFeatures", D);
+  chrono.report.saveCounter("partB.rffSampledPairs", sample);
+  chrono.report.saveCounter("partB.rffMaxAbsoluteError", maxAbsoluteError);
+  chrono.report.saveCounter("partB.rffMaxRelativeError", maxRelativeError);
+}
+
+const arma::mat& withoutVanishingSubmodels(arma::mat& regularizedKM) const {
+  // compact support: a group without any point in the support of x gives M_i(x) = 0, with a zero row in KM(x)
+  // its variance is replaced by 1 so that KM(x) stays invertible, the weight of M_i(x) is then kM_i(x) = 0
+  regularizedKM = out.KMbyPair;
+  for(Long i=0; i<N; ++i) {
+    double* KMii = regularizedKM.colptr(PackedSymMatrix::index(i,i));
+    for(Long m=0; m<q; ++m) if (KMii[m]==0.0) KMii[m] = 1.0;
+  }
+  return regularizedKM;
+}
+
 template <int ShowProgress>
 void partC_agregateFirstLayer() {
-  const bool storeWeights = out.requiredByUser.predictionBySubmodel();
   chrono.print("Part C, aggregation first layer: starting...");
-  //parallelism.switchToContext<Parallelism::innerContext>();
-  //#pragma omp parallel for schedule(static, 1) if (q>50) //avoid dynamic for Loo repeated calls
+  // the q systems are solved as one batch, spread across threads, weights are always kept (used by partD)
+  // pair-major KM is transposed lazily, block of pred points by block, inside the batched solver
+  const int numThreadsBatch = parallelism.getThreadsNumber<Parallelism::innerContext>();
+  const arma::mat kMbyPoint = out.kMbyGroup.t(), mean_MbyPoint = out.mean_MbyGroup.t(); // N x q
+  arma::mat regularizedKM{};
+  const arma::mat& KMbyPair = useCompactSupport() ? withoutVanishingSubmodels(regularizedKM) : out.KMbyPair;
+  if (useMixedPrecision()) MixedPrecisionBatchedSolver::findWeights(KMbyPair, kMbyPoint, out.weights, numThreadsBatch, tracer);
+  else if (usePackedStorage()) PackedBatchedSolver::findWeights(KMbyPair, kMbyPoint, out.weights, numThreadsBatch, tracer);
+  else ChosenBatchedSolver::findWeights(KMbyPair, kMbyPoint, out.weights, numThreadsBatch, tracer);
   for(Long m = 0; m < q; ++m) {
-    arma::mat weightsColm(N,1);
-    ChosenSolver::findWeights(out.KM[m], out.kM[m], weightsColm);
-    if (storeWeights) out.weights.col(m) = weightsColm;
-    out.predmean(m) = arma::dot( weightsColm, out.mean_M[m] );
-    out.predsd2(m) = std::max(0.0 , sd2* (1 - arma::dot(weightsColm, out.kM[m])));
+    out.predmean(m) = arma::dot( out.weights.col(m), mean_MbyPoint.col(m) );
+    out.predsd2(m) = std::max(0.0 , sd2* (1 - arma::dot(out.weights.col(m), kMbyPoint.col(m))));
   }
   if (out.requiredByUser.predictionBySubmodel()) {
-    for(Long m = 0; m < q; ++m) out.sd2_M[m] = sd2* (1 - arma::diagvec(out.KM[m]));
+    for(Long m = 0; m < q; ++m) out.sd2_M[m] = sd2* (1 - out.diagKMofPoint(m));
   }
   chrono.print("Part C, aggregation first layer: done.");
 }
@@ -724,7 +1433,7 @@ void partD_crossCovComputations() {
       chrono.print("Part D, cross-cov computations: starting...");
       arma::mat kxx(q, q);
       NuggetVector noNugget{};
-      kernel.fillAllocatedCorrMatrix(kxx, submodels.predictionPoints, noNugget);
+      kernel.fillAllocatedCorrMatrix(kxx, submodels.predictionPoints, noNugget, parallelism.getBoundedThreadsNumber<Parallelism::innerContext>());
       parallelism.switchToContext<Parallelism::innerContext>();
       #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE) collapse(2)
       for(Long m1 = 0; m1 < q; ++m1)
@@ -749,12 +1458,13 @@ void partD_crossCovComputations() {
   void partE_Alternatives() {
     chrono.print("Part E, computing alternatives: starting...");
       ProgressBar<ShowProgress> progressBar(chrono, q, verboseLevel);
-      for(Long m = 0; m < q; ++m) out.sd2_M[m] = sd2*(1.0-arma::diagvec(out.KM[m])); //q elt of size N
+      for(Long m = 0; m < q; ++m) out.sd2_M[m] = sd2*(1.0-out.diagKMofPoint(m)); //q elt of size N
+      const arma::mat mean_MbyPoint = out.mean_MbyGroup.t(); // N x q
       parallelism.switchToContext<Parallelism::innerContext>();
       #pragma omp parallel for schedule(CHOSEN_SCHEDULE, CHOSEN_CHUNKSIZE)
       for(Long m = 0; m < q; ++m) {
         Long indexSPV = indexOfmin(out.sd2_M[m]);
-        out.meanSPV[m]  = out.mean_M[m].at(indexSPV);
+        out.meanSPV[m]  = mean_MbyPoint.at(indexSPV, m);
         out.sd2SPV[m] = out.sd2_M[m].at(indexSPV);
         arma::vec precision_m = arma::ones<arma::vec>(N) / out.sd2_M[m];
         // beta_m can be computed using log1p when available
@@ -770,11 +1480,11 @@ void partD_crossCovComputations() {
         out.sd2BCM[m]  = 1 / ( precisionSum_m - precPrior * (N-1) );
         out.sd2RBCM[m] = 1 / ( betaPrecSum_m  - precPrior * (betaSum_m-1) );
 
-        double sumWithoutBeta = arma::accu( precision_m % out.mean_M[m] );
+        double sumWithoutBeta = arma::accu( precision_m % mean_MbyPoint.col(m) );
         out.meanPOE[m]  = out.sd2POE[m]  * sumWithoutBeta;
         out.meanBCM[m]  = out.sd2BCM[m]  * sumWithoutBeta;
 
-        double sumWithBeta   = arma::accu( betaPrec_m  % out.mean_M[m] );
+        double sumWithBeta   = arma::accu( betaPrec_m  % mean_MbyPoint.col(m) );
         out.meanRBCM[m] = out.sd2RBCM[m] * sumWithBeta;
 
         // GPOE is normalized, as if using coeffs gamma_i = beta_i / sum(beta_i) instead of beta_i
@@ -790,6 +1500,16 @@ void partD_crossCovComputations() {
       chrono.print("computing alternatives: done.");
   }
 
+  void partF_InducingPoints() {
+    chrono.print("Part F, inducing points alternatives (FITC, PITC): starting...");
+    const InducingPointsEngine engine(kernel, submodels.splittedX, submodels.splittedY, submodels.splittedNuggets, ordinaryKriging,
+                                      options.getOptionValue(GlobalOptions::Option::inducingPoints));
+    const int numThreads = parallelism.getBoundedThreadsNumber<Parallelism::innerContext>();
+    engine.predict(submodels.predictionPoints, sd2, numThreads, out.meanFITC, out.sd2FITC, out.meanPITC, out.sd2PITC);
+    chrono.report.saveCounter("partF.inducingPoints", engine.numberOfInducingPoints());
+    chrono.print("Part F, inducing points alternatives: done.");
+  }
+
   Output output() const {
     return out; //returns a (movable) copy, used in AlgoZone
   }
@@ -848,29 +1568,61 @@ class AlgoZones {
     chrono.print("merge outputs: starting...");
     mergedOutput.setDetailLevel (splittedOutput[0].requiredByUser.getOutputLevel());
     std::vector<arma::vec> splittedpredmean(NbZones), splittedpredsd2(NbZones);
-    std::vector<std::vector<arma::vec> > splittedkM(NbZones), splittedmean_M(NbZones), splittedsd2_M(NbZones);
-    std::vector<std::vector<arma::mat> > splittedKM(NbZones);
+    std::vector<std::vector<arma::vec> > splittedsd2_M(NbZones);
+    std::vector<arma::mat> splittedkM(NbZones), splittedmean_M(NbZones), splittedKM(NbZones); // one row by pred point
     bool showPred_M = mergedOutput.requiredByUser.predictionBySubmodel();
     bool showCov_M  = mergedOutput.requiredByUser.covariancesBySubmodel();
     for(Long i=0; i<NbZones; ++i) {
       splittedpredmean[i] = splittedOutput[i].predmean;
       splittedpredsd2[i] = splittedOutput[i].predsd2;
-      if (showPred_M) splittedmean_M[i]= splittedOutput[i].mean_M;
+      if (showPred_M) splittedmean_M[i]= splittedOutput[i].mean_MbyGroup;
       if (showPred_M) splittedsd2_M[i]= splittedOutput[i].sd2_M;
-      if (showCov_M) splittedkM[i] = splittedOutput[i].kM;
-      if (showCov_M) splittedKM[i] = splittedOutput[i].KM;
+      if (showCov_M) splittedkM[i] = splittedOutput[i].kMbyGroup;
+      if (showCov_M) splittedKM[i] = splittedOutput[i].KMbyPair;
     }
     splitterZone.merge<arma::vec>(splittedpredmean, mergedOutput.predmean);
     splitterZone.merge<arma::vec>(splittedpredsd2, mergedOutput.predsd2);
-    if (showPred_M) splitterZone.merge<std::vector<arma::vec> >(splittedmean_M, mergedOutput.mean_M);
-    if (showPred_M) splitterZone.merge<std::vector<arma::vec> >(splittedmean_M, mergedOutput.mean_M);
+    if (showPred_M) splitterZone.merge<arma::mat>(splittedmean_M, mergedOutput.mean_MbyGroup);
     if (showPred_M) splitterZone.merge<std::vector<arma::vec> >(splittedsd2_M, mergedOutput.sd2_M);
-    if (showCov_M) splitterZone.merge<std::vector<arma::vec> >(splittedkM, mergedOutput.kM);
-    if (showCov_M) splitterZone.merge<std::vector<arma::mat> >(splittedKM, mergedOutput.KM);
+    if (showCov_M) splitterZone.merge<arma::mat>(splittedkM, mergedOutput.kMbyGroup);
+    if (showCov_M) splitterZone.merge<arma::mat>(splittedKM, mergedOutput.KMbyPair);
+    mergeTraces();
+    for(Long z=0; z<NbZones; ++z) mergedOutput.hardwareCounterReport.append(splittedOutput[z].hardwareCounterReport);
+    std::vector<MemoryPlan> zonePlans(NbZones);
+    for(Long z=0; z<NbZones; ++z) zonePlans[z] = splittedOutput[z].memoryPlan;
+    mergedOutput.memoryPlan.fuseParallelPlans(zonePlans);
 
     chrono.print("merge outputs: done.");
   }
 
+  void mergeTraces() {
+    // one trace process by zone
+    for(Long z=0; z<NbZones; ++z) {
+      const Output& zoneOutput = splittedOutput[z];
+      mergedOutput.traced = mergedOutput.traced || zoneOutput.traced;
+      mergedOutput.droppedTraceEvents += zoneOutput.droppedTraceEvents;
+      for(TraceEvent event: zoneOutput.traceEvents) {
+        event.process = static_cast<int>(z);
+        mergedOutput.traceEvents.push_back(event);
+      }
+    }
+  }
+
+  bool checkMemoryPlan() {
+    // zones run concurrently: the budget applies to the sum of their plans, true for a dry run
+    std::vector<MemoryPlan> zonePlans{};
+    const RequiredByUser required(outputLevel);
+    for(Long z=0; z<NbZones; ++z)
+      zonePlans.emplace_back(splitter.get_groupSizes(), n, splittedx[z].n_rows, d, parallelism.getBoundedThreadsNumber<Parallelism::innerContext>(),
+                             required.alternatives(), required.covariances());
+    MemoryPlan plan;
+    plan.fuseParallelPlans(zonePlans);
+    plan.checkBudget(1048576.0*options.getOptionValue(GlobalOptions::Option::memoryBudget));
+    if (options.getOptionValue(GlobalOptions::Option::dryRun)!=1) return false;
+    mergedOutput.memoryPlan = plan;
+    return true;
+  }
+
   template <typename T>
   T copy(T& object) { return object;}
 
@@ -890,6 +1642,8 @@ AlgoZones(const Parallelism& parallelism, const Long NbZones, const arma::mat& X
       RequiredByUser requiredByUser(outputLevel);
       if (requiredByUser.alternatives()) throw(std::runtime_error("outputLevel problem, no implemented alternatives when numThreadsZones>1"));
       if (requiredByUser.covariances()) throw(std::runtime_error("outputLevel problem, no implemented cross-cov when numThreadsZones>1"));
+      if (options.getOptionValue(GlobalOptions::Option::checkpoint)>0)
+        throw(std::runtime_error("option problem, no implemented checkpoints when numThreadsZones>1"));
 
       chrono.start();
       splitterZone.setModuloSplitScheme(q, NbZones);
@@ -899,19 +1653,36 @@ AlgoZones(const Parallelism& parallelism, const Long NbZones, const arma::mat& X
       // preallocation of splittedoutput content useless, done with further affectations splittedOutput[z] =...?
       //for(Long z=0; z<NbZones; ++z) splittedOutput[z].reserveMatrices(splitter.get_N(),splittedx[z].size());
 
-      parallelism.switchToContext<Parallelism::outerContext>();
-      std::vector<LOOScheme> splittedLOOSchemes = looScheme.splittedSchemes(splitterZone);
+      if (checkMemoryPlan()) {
+        chrono.print("dry run: finished.");
+        return;
+      }
 
+      std::vector<LOOScheme> splittedLOOSchemes = looScheme.splittedSchemes(splitterZone);
 
-      #pragma omp parallel for schedule(static, CHOSEN_CHUNKSIZE)
+      // one task pool, without nested parallel regions: each zone is a task, the submodels and pairs of
+      // all zones are tasks of the same team, so that threads of a finished zone help the other ones
+      Parallelism poolParallelism = parallelism;
+      poolParallelism.enableTaskPool();
+      std::vector<std::exception_ptr> zoneErrors(NbZones);
+      #pragma omp parallel num_threads(poolParallelism.getTaskPoolThreadsNumber())
+      #pragma omp single
       for(Long z=0; z<NbZones; ++z) {
-          std::string tag = tagAlgo + " zone=" + std::to_string(z);
-          LOOScheme localScheme = splittedLOOSchemes[z];
-          Algo* algo=new Algo(parallelism, X, Y, splitter, splittedx[z], param, sd2, ordinaryKriging, covType,
-                              tag, verboseLevel, outputLevel, copy(nugget), screen, options, localScheme);
-          splittedOutput[z] = algo->output(); //move assignement
-          delete algo;
+          #pragma omp task firstprivate(z) shared(splittedLOOSchemes, zoneErrors, poolParallelism)
+          {
+            try {
+              std::string tag = tagAlgo + " zone=" + std::to_string(z);
+              LOOScheme localScheme = splittedLOOSchemes[z];
+              Algo algo(poolParallelism, X, Y, splitter, splittedx[z], param, sd2, ordinaryKriging, covType,
+                        tag, verboseLevel, outputLevel, copy(nugget), screen, options, localScheme);
+              splittedOutput[z] = algo.output(); //move assignement
+            }
+            catch(...) {
+              zoneErrors[z] = std::current_exception(); // exceptions must not leave a task
+            }
           }
+      }
+      for(const std::exception_ptr& error: zoneErrors) if (error) std::rethrow_exception(error);
       mergeOutputs(splitterZone);
       updateDurations();
       chrono.print("finished.");
@@ -970,9 +1741,25 @@ const Long optimLevel = 0
 
   Parallelism parallelism;
   screen.print(parallelism.informationString(), tagAlgo);
+  Long q=xSelected.n_rows;
+
+  if (numThreadsZones<1) {
+    // split of numThreads between zones and groups chosen by the planner, for these clusters
+    const RequiredByUser required(outputDetailLevel);
+    const int threads = static_cast<int>((numThreads>0) ? numThreads : Planner::availableCores());
+    const Planner planner(X.n_rows, X.n_cols, q, MachineCalibration::measure(covType, X.n_cols), threads,
+                          1048576.0*options.getOptionValue(GlobalOptions::Option::memoryBudget), ordinaryKriging,
+                          required.alternatives(), required.covariances());
+    const PlanCandidate plan = planner.bestThreadSplit(splitter.get_groupSizes());
+    numThreadsZones = plan.zones;
+    numThreads = plan.threads;
+    std::ostringstream oss;
+    oss << "planner: numThreadsZones=" << plan.zones << ", numThreads=" << plan.threads
+        << ", predicted duration " << plan.predictedSeconds << " s";
+    screen.print(oss.str(), tagAlgo);
+  }
 
   parallelism.setThreadsNumber<Parallelism::outerContext>(numThreadsZones);
-  Long q=xSelected.n_rows;
   parallelism.boundThreadsNumber<Parallelism::outerContext>(q);
   Long threadsZone=static_cast<Long>(numThreadsZones);
 
@@ -992,7 +1779,7 @@ const Long optimLevel = 0
   #endif
 
   if (NbZones>1) {
-      Parallelism::set_nested(1);
+      Parallelism::set_nested(0);
       if (threadsZone>q) screen.warning("as numThreadsZones>q, algorithm Zone will not use all available threads");
 
       AlgoZones algoZ(parallelism, NbZones, X, Y, splitter, xSelected, param, sd2, ordinaryKriging, covType,
@@ -1020,7 +1807,7 @@ const Long optimLevel = 0
 // sd2: variance
 // OrdinaryKriging: boolean, true= use Simple Kriging, false=use Ordinary Kriging
 // tagAlgo: string displayed with messages, to identify algorithm run
-// numThreadsZones: number of Threads among prediction points (should be <q, recommended= 1)
+// numThreadsZones: number of Threads among prediction points (should be <q, recommended= 1, 0= chosen by the planner)
 // numThreads: number of Threads among groups (shoud be <N)
 
 // deduced parameters:
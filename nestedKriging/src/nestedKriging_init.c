@@ -11,6 +11,10 @@
 /* .Call calls */
 extern SEXP _nestedKriging_nestedKrigingDirect(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP _nestedKriging_estimParam(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _nestedKriging_vecchiaKrigingDirect(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _nestedKriging_nestedKrigingPlanner(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _nestedKriging_nestedKrigingSharded(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _nestedKriging_checkpointInfo(SEXP);
 extern SEXP _nestedKriging_looErrors(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP _nestedKriging_looErrorsDirect(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP _nestedKriging_tests_getCaseStudy(SEXP, SEXP);
@@ -20,6 +24,10 @@ extern SEXP _nestedKriging_versionInfo(SEXP);
 
 static const R_CallMethodDef CallEntries[] = {
   {"_nestedKriging_nestedKrigingDirect", (DL_FUNC) &_nestedKriging_nestedKrigingDirect, 15},
+  {"_nestedKriging_vecchiaKrigingDirect", (DL_FUNC) &_nestedKriging_vecchiaKrigingDirect, 16},
+  {"_nestedKriging_nestedKrigingPlanner", (DL_FUNC) &_nestedKriging_nestedKrigingPlanner, 8},
+  {"_nestedKriging_nestedKrigingSharded", (DL_FUNC) &_nestedKriging_nestedKrigingSharded, 13},
+  {"_nestedKriging_checkpointInfo", (DL_FUNC) &_nestedKriging_checkpointInfo, 1},
   {"_nestedKriging_looErrors", (DL_FUNC) &_nestedKriging_looErrors, 16},
   {"_nestedKriging_estimParam", (DL_FUNC) &_nestedKriging_estimParam, 24},
   {"_nestedKriging_looErrorsDirect", (DL_FUNC) &_nestedKriging_looErrorsDirect, 16},
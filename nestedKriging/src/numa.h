@@ -0,0 +1,217 @@
+
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+//===============================================================================
+// unit containing an optional NUMA-aware placement for multi-socket machines: threads of the inner context are
+// bound to cpus spread over the machine, each group is owned by one thread (i modulo the number of threads) that
+// allocates and initializes its data (first touch places pages on the node of this thread), then runs its
+// submodel; pairs (i,j) go to the node of group j, shared by the threads of this node, idle nodes steal pairs.
+// Binding uses sched_setaffinity (Linux), the OMP_PROC_BIND places being often undefined from R; the previous
+// affinity of each thread is restored at destruction. Elsewhere, or when disabled, loops are plain loops.
+//
+// classes:
+// NumaTopology, NumaPlacement
+//===============================================================================
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== NumaTopology
+// cpus allowed to the calling thread, node of the calling thread, binding of the calling thread
+
+struct NumaTopology {
+  static std::vector<int> allowedCpus() {
+    std::vector<int> cpus{};
+    #if defined(__linux__)
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      if (sched_getaffinity(0, sizeof(mask), &mask)==0)
+        for(int cpu=0; cpu<CPU_SETSIZE; ++cpu) if (CPU_ISSET(cpu, &mask)) cpus.push_back(cpu);
+    #endif
+    return cpus;
+  }
+
+  static int nodeOfCurrentThread() {
+    #if defined(__linux__) && defined(SYS_getcpu)
+      unsigned cpu = 0, node = 0;
+      if (syscall(SYS_getcpu, &cpu, &node, nullptr)==0) return static_cast<int>(node);
+    #endif
+    return 0;
+  }
+
+  static bool bindCurrentThread(const int cpu) {
+    #if defined(__linux__)
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      CPU_SET(cpu, &mask);
+      return sched_setaffinity(0, sizeof(mask), &mask)==0;
+    #else
+      return false;
+    #endif
+  }
+
+  static void bindCurrentThread(const std::vector<int>& cpus) {
+    #if defined(__linux__)
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      for(const int cpu: cpus) CPU_SET(cpu, &mask);
+      sched_setaffinity(0, sizeof(mask), &mask);
+    #endif
+  }
+};
+
+//=================================================== NumaPlacement
+// threads 0..numThreads-1 of the following parallel regions (same team size), the thread numbers of a team
+// being mapped to the same OS threads from one region to the next
+
+class NumaPlacement {
+  int numThreads = 1;
+  bool bound = false;
+  std::vector<int> processCpus{};
+  std::vector<std::vector<int> > previousCpusOfThread{}; // affinity of each thread before binding, restored at destruction
+  std::vector<int> nodeIndexOfThread{}; // nodes renumbered 0..numberOfNodes-1
+  Long nodes = 1;
+
+  static int threadNumber() {
+    #if defined(_OPENMP)
+      return omp_get_thread_num();
+    #else
+      return 0;
+    #endif
+  }
+
+  static int teamSize() {
+    #if defined(_OPENMP)
+      return omp_get_num_threads();
+    #else
+      return 1;
+    #endif
+  }
+
+  void bindThreads() {
+    // spread: thread t on the cpu t*cpus/numThreads, cpus being usually numbered socket by socket
+    processCpus = NumaTopology::allowedCpus();
+    if (processCpus.empty()) return;
+    std::vector<int> nodeOfThread(numThreads, 0), boundThreads(numThreads, 0);
+    previousCpusOfThread.assign(numThreads, std::vector<int>{});
+    const Long cpus = processCpus.size();
+    #pragma omp parallel num_threads(numThreads)
+    {
+      const int t = threadNumber();
+      if (t<numThreads) {
+        previousCpusOfThread[t] = NumaTopology::allowedCpus(); // own mask, e.g. set by OMP_PROC_BIND / OMP_PLACES
+        boundThreads[t] = NumaTopology::bindCurrentThread(processCpus[(t*cpus/numThreads) % cpus]) ? 1 : 0;
+        nodeOfThread[t] = NumaTopology::nodeOfCurrentThread();
+      }
+    }
+    bound = std::all_of(boundThreads.begin(), boundThreads.end(), [](const int b) { return b==1; });
+    std::vector<int> distinctNodes = nodeOfThread;
+    std::sort(distinctNodes.begin(), distinctNodes.end());
+    distinctNodes.erase(std::unique(distinctNodes.begin(), distinctNodes.end()), distinctNodes.end());
+    nodes = distinctNodes.size();
+    nodeIndexOfThread.resize(numThreads);
+    for(int t=0; t<numThreads; ++t)
+      nodeIndexOfThread[t] = static_cast<int>(std::lower_bound(distinctNodes.begin(), distinctNodes.end(), nodeOfThread[t]) - distinctNodes.begin());
+  }
+
+public:
+  NumaPlacement() = default;
+
+  NumaPlacement(const bool enabled, const int numThreads) : numThreads(std::max(numThreads, 1)) {
+    if (enabled) bindThreads();
+  }
+
+  NumaPlacement(const NumaPlacement&) = delete;
+  NumaPlacement& operator=(const NumaPlacement&) = delete;
+
+  ~NumaPlacement() {
+    // leaves the threads of the R session as they were, each one with its own previous mask
+    if (processCpus.empty()) return;
+    #pragma omp parallel num_threads(numThreads)
+    {
+      const int t = threadNumber();
+      if ((t<numThreads) && (!previousCpusOfThread[t].empty())) NumaTopology::bindCurrentThread(previousCpusOfThread[t]);
+    }
+  }
+
+  static const NumaPlacement& off() {
+    static const NumaPlacement disabled;
+    return disabled;
+  }
+
+  bool enabled() const {
+    return !nodeIndexOfThread.empty();
+  }
+
+  bool threadsBound() const {
+    return bound;
+  }
+
+  Long numberOfNodes() const {
+    return nodes;
+  }
+
+  int ownerOfGroup(const Long i) const {
+    return static_cast<int>(i % numThreads);
+  }
+
+  int nodeOfGroup(const Long i) const {
+    return enabled() ? nodeIndexOfThread[ownerOfGroup(i)] : 0;
+  }
+
+  template <typename GroupFunction>
+  void forEachGroup(const Long numberOfGroups, GroupFunction group) const {
+    // each group on its owner thread (or on thread i modulo the team size when the runtime gives fewer threads)
+    if (!enabled()) {
+      for(Long i=0; i<numberOfGroups; ++i) group(i);
+      return;
+    }
+    #pragma omp parallel num_threads(numThreads)
+    {
+      const Long t = threadNumber(), threads = teamSize();
+      for(Long i=t; i<numberOfGroups; i+=threads) group(i);
+    }
+  }
+
+  template <typename PairFunction>
+  void forEachPair(const Long numberOfGroups, PairFunction pair) const {
+    // pairs i<j, first by the threads of the node of group j, then by any idle thread
+    const Long N = numberOfGroups;
+    std::vector<std::vector<Long> > pairsByNode(nodes);
+    for(Long j=1; j<N; ++j)
+      for(Long i=0; i<j; ++i) pairsByNode[nodeOfGroup(j)].push_back(i*N+j);
+    std::vector<std::atomic<Long> > nextPair(nodes);
+    for(std::atomic<Long>& next: nextPair) next.store(0);
+    #pragma omp parallel num_threads(numThreads)
+    {
+      const int t = threadNumber();
+      const Long home = enabled() ? nodeIndexOfThread[t % numThreads] : 0;
+      for(Long k=0; k<nodes; ++k) {
+        const Long node = (home+k) % nodes;
+        for(Long position = nextPair[node].fetch_add(1); position<pairsByNode[node].size(); position = nextPair[node].fetch_add(1)) {
+          const Long w = pairsByNode[node][position];
+          pair(w/N, w%N);
+        }
+      }
+    }
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* NUMA_HPP */
@@ -0,0 +1,210 @@
+
+#ifndef OUTOFCORE_HPP
+#define OUTOFCORE_HPP
+
+//===============================================================================
+// unit containing an optional out-of-core store for the weights alpha[i] (ni x q each, n x q in all), the largest
+// result kept from partA to partB. The store is a scratch file mapped in memory (mmap), in the directory given by the
+// environment variable NESTEDKRIGING_SCRATCH (else TMPDIR, else /tmp), removed as soon as it is created so that
+// nothing is left behind. Each alpha[i] is an Armadillo matrix on its own page-aligned region of the file: partA
+// writes it, then releases its pages; partB runs the pairs tile by tile, a tile being consecutive groups of at most
+// a third of the budget, so that two tiles in use and the next one being prefetched (asynchronous readahead of
+// the kernel) stay within the budget. Factorizations only live during the solve of their group and are not stored.
+//
+// classes:
+// SpillStore
+//===============================================================================
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#define NESTEDKRIGING_MMAP_AVAILABLE 1
+#endif
+
+#include "common.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== SpillStore
+// tiles are ranges [tileBegin[t], tileBegin[t+1]) of groups
+
+class SpillStore {
+  enum : int { closed = -1 };
+  static constexpr double bytesByDouble = 8.0;
+  int descriptor = closed;
+  char* mapping = nullptr;
+  std::size_t mappedBytes = 0;
+  Long q = 0;
+  std::vector<Long> groupSizes{};
+  std::vector<std::size_t> offsets{}, regionBytes{};
+  std::vector<Long> tileBegin{};
+
+  static std::size_t pageSize() {
+    #if defined(NESTEDKRIGING_MMAP_AVAILABLE)
+      const long size = sysconf(_SC_PAGESIZE);
+      return (size>0) ? static_cast<std::size_t>(size) : 4096;
+    #else
+      return 4096;
+    #endif
+  }
+
+  static std::runtime_error systemError(const std::string& message) {
+    #if defined(NESTEDKRIGING_MMAP_AVAILABLE)
+      return std::runtime_error("out-of-core store: " + message + " (" + std::strerror(errno) + ")");
+    #else
+      return std::runtime_error("out-of-core store: " + message);
+    #endif
+  }
+
+  void createTiles(const double budgetBytes) {
+    // consecutive groups, at most a third of the budget by tile (at least one group)
+    const double tileBytes = budgetBytes/3.0;
+    double bytesInTile = 0.0;
+    for(Long i=0; i<groupSizes.size(); ++i) {
+      if ((i==0) || (bytesInTile + regionBytes[i] > tileBytes)) { tileBegin.push_back(i); bytesInTile = 0.0; }
+      bytesInTile += regionBytes[i];
+    }
+    tileBegin.push_back(groupSizes.size());
+  }
+
+  void createFile(const std::string& directory) {
+    #if defined(NESTEDKRIGING_MMAP_AVAILABLE)
+      std::string path = directory + "/nestedKriging-alpha-XXXXXX";
+      std::vector<char> writablePath(path.begin(), path.end());
+      writablePath.push_back('\0');
+      descriptor = mkstemp(writablePath.data());
+      if (descriptor==closed) throw systemError("cannot create a scratch file in " + directory);
+      unlink(writablePath.data()); // the space is given back when the descriptor is closed
+      void* address = MAP_FAILED;
+      if (ftruncate(descriptor, static_cast<off_t>(mappedBytes))==0)
+        address = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+      if (address==MAP_FAILED) {
+        const std::runtime_error error = systemError("cannot size or map a scratch file of " + std::to_string(mappedBytes) + " bytes");
+        close(descriptor); // the destructor is not run when the constructor throws
+        throw error;
+      }
+      mapping = static_cast<char*>(address);
+    #else
+      (void) directory;
+      throw std::runtime_error("out-of-core store: memory mapped files are not available on this platform");
+    #endif
+  }
+
+  void advise(const Long firstGroup, const Long endGroup, const bool willNeed) const {
+    #if defined(NESTEDKRIGING_MMAP_AVAILABLE)
+      if ((mapping==nullptr) || (firstGroup>=endGroup)) return;
+      const std::size_t begin = offsets[firstGroup], end = offsets[endGroup-1] + regionBytes[endGroup-1];
+      madvise(mapping + begin, end - begin, willNeed ? MADV_WILLNEED : MADV_DONTNEED);
+    #else
+      (void) firstGroup; (void) endGroup; (void) willNeed;
+    #endif
+  }
+
+  void prefetchTile(const Long t) {
+    advise(tileBegin[t], tileBegin[t+1], true);
+    ++tileLoads;
+    for(Long i=tileBegin[t]; i<tileBegin[t+1]; ++i) bytesPrefetched += static_cast<double>(regionBytes[i]);
+  }
+
+  void releaseTile(const Long t) const {
+    advise(tileBegin[t], tileBegin[t+1], false);
+  }
+
+public:
+  Long tileLoads = 0;
+  double bytesPrefetched = 0.0;
+
+  SpillStore() = default;
+
+  SpillStore(const bool enabled, const std::vector<Long>& groupSizes, const Long q, const double budgetBytes)
+    : q(q), groupSizes(groupSizes) {
+    if ((!enabled) || (q==0) || groupSizes.empty()) return;
+    const std::size_t page = pageSize();
+    for(const Long ni: groupSizes) {
+      const std::size_t bytes = static_cast<std::size_t>(bytesByDouble*ni*q);
+      offsets.push_back(mappedBytes);
+      regionBytes.push_back(bytes);
+      mappedBytes += ((bytes + page - 1)/page)*page;
+    }
+    createTiles(budgetBytes);
+    createFile(scratchDirectory());
+  }
+
+  SpillStore(const SpillStore&) = delete;
+  SpillStore& operator=(const SpillStore&) = delete;
+
+  ~SpillStore() {
+    #if defined(NESTEDKRIGING_MMAP_AVAILABLE)
+      if (mapping!=nullptr) munmap(mapping, mappedBytes);
+      if (descriptor!=closed) close(descriptor);
+    #endif
+  }
+
+  static std::string scratchDirectory() {
+    const char* chosen = std::getenv("NESTEDKRIGING_SCRATCH");
+    if ((chosen==nullptr) || (*chosen=='\0')) chosen = std::getenv("TMPDIR");
+    if ((chosen==nullptr) || (*chosen=='\0')) chosen = "/tmp";
+    return chosen;
+  }
+
+  bool enabled() const {
+    return mapping!=nullptr;
+  }
+
+  double storeBytes() const {
+    return static_cast<double>(mappedBytes);
+  }
+
+  Long numberOfTiles() const {
+    return tileBegin.empty() ? 0 : tileBegin.size()-1;
+  }
+
+  std::vector<arma::mat> matrices() const {
+    // one ni x q matrix by group on the file, strict: never reallocated elsewhere
+    std::vector<arma::mat> alpha{};
+    alpha.reserve(groupSizes.size());
+    for(Long i=0; i<groupSizes.size(); ++i)
+      alpha.emplace_back(reinterpret_cast<double*>(mapping + offsets[i]), groupSizes[i], q, false, true);
+    return alpha;
+  }
+
+  void releaseGroup(const Long i) const {
+    // pages written by partA go back to the file (thread-safe, regions are disjoint)
+    advise(i, i+1, false);
+  }
+
+  template <typename PairsFunction>
+  void forEachTilePair(PairsFunction runPairs) {
+    // tile pairs (I,J), I<=J, J-major: tile J stays while I goes 0..J, the tile(s) of the next tile pair are
+    // prefetched before the run of (I,J). runPairs gets the pairs w = i*N+j, i<j, of the tile pair
+    const Long T = numberOfTiles(), N = groupSizes.size();
+    if (T==0) return;
+    prefetchTile(0);
+    for(Long J=0; J<T; ++J) {
+      for(Long I=0; I<=J; ++I) {
+        if (I+1<J) prefetchTile(I+1);
+        if ((I==J) && (J+1<T)) { // next: (0, J+1)
+          if (J>0) prefetchTile(0);
+          prefetchTile(J+1);
+        }
+        std::vector<Long> pairs{};
+        for(Long j=tileBegin[J]; j<tileBegin[J+1]; ++j)
+          for(Long i=tileBegin[I]; i<std::min(j, tileBegin[I+1]); ++i) pairs.push_back(i*N+j);
+        runPairs(pairs);
+        if (I<J) releaseTile(I);
+      }
+      if (J>0) releaseTile(J); // tile 0 is also the first tile of the next tile pair
+    }
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* OUTOFCORE_HPP */
@@ -0,0 +1,121 @@
+
+#ifndef PACKEDMATRIX_HPP
+#define PACKEDMATRIX_HPP
+
+//===============================================================================
+// unit containing a packed storage for symmetric matrices, with LAPACK packed Cholesky
+// LAPACK convention uplo='U': only the upper triangle is stored, column by column,
+// the item (i,j), i<=j, is at position i + j(j+1)/2, which requires n(n+1)/2 doubles instead of n^2
+// also contains the LAPACK band storage, for symmetric matrices with a small bandwidth kd:
+// the item (i,j), j-kd<=i<=j, is at row kd+i-j of column j of a (kd+1) x n matrix
+//
+// classes:
+// PackedSymMatrix, PackedCholesky, BandedCholesky
+//===============================================================================
+
+#include "common.h"
+#include <R_ext/Lapack.h>
+
+#ifndef FCONE
+  #define FCONE
+#endif
+
+namespace nestedKrig {
+
+//=================================================== PackedSymMatrix
+// at(i,j) and at(j,i) refer to the same stored value
+
+class PackedSymMatrix {
+  Long dimension = 0;
+  arma::vec values{};
+
+public:
+  static inline Long packedSize(const Long n) {
+    return n*(n+1)/2;
+  }
+
+  static inline Long index(const Long i, const Long j) {
+    return (i<=j) ? i + j*(j+1)/2 : j + i*(i+1)/2;
+  }
+
+  PackedSymMatrix() {}
+
+  PackedSymMatrix(const Long nrows, const Long ncols) {
+    if (nrows!=ncols) throw std::runtime_error("packed symmetric matrix must be square");
+    set_size(nrows);
+  }
+
+  explicit PackedSymMatrix(const arma::mat& denseMatrix) {
+    set_size(denseMatrix.n_rows);
+    for(Long j=0; j<dimension; ++j)
+      for(Long i=0; i<=j; ++i) values[index(i,j)] = denseMatrix.at(i,j);
+  }
+
+  void set_size(const Long n) {
+    dimension = n;
+    values.set_size(packedSize(n));
+  }
+
+  inline Long n_rows() const { return dimension; }
+  inline Long n_elem() const { return values.n_elem; }
+
+  inline double& at(const Long i, const Long j) { return values[index(i,j)]; }
+  inline double at(const Long i, const Long j) const { return values[index(i,j)]; }
+
+  inline double* memptr() { return values.memptr(); }
+  inline const double* memptr() const { return values.memptr(); }
+
+  arma::mat toDense() const {
+    arma::mat denseMatrix(dimension, dimension);
+    for(Long j=0; j<dimension; ++j)
+      for(Long i=0; i<=j; ++i) denseMatrix.at(i,j) = denseMatrix.at(j,i) = values[index(i,j)];
+    return denseMatrix;
+  }
+};
+
+//=================================================== PackedCholesky
+// K = U^T U computed in place by dpptrf, then K * X = B solved in place by dpptrs
+
+struct PackedCholesky {
+  static void factorize(PackedSymMatrix& K) {
+    const char uplo = 'U';
+    const int n = static_cast<int>(K.n_rows());
+    int info = 0;
+    F77_CALL(dpptrf)(&uplo, &n, K.memptr(), &info FCONE);
+    if (info!=0) throw std::runtime_error("packed Cholesky: matrix is not positive definite (dpptrf info=" + std::to_string(info) + ")");
+  }
+
+  static void solveFactorized(const PackedSymMatrix& U, arma::mat& rhsThenSolution) {
+    const char uplo = 'U';
+    const int n = static_cast<int>(U.n_rows()), nrhs = static_cast<int>(rhsThenSolution.n_cols);
+    int info = 0;
+    F77_CALL(dpptrs)(&uplo, &n, &nrhs, U.memptr(), rhsThenSolution.memptr(), &n, &info FCONE);
+    if (info!=0) throw std::runtime_error("packed Cholesky: solve failed (dpptrs info=" + std::to_string(info) + ")");
+  }
+};
+
+//=================================================== BandedCholesky
+// K = U^T U computed in place by dpbtrf on the band storage, then K * X = B solved in place by dpbtrs
+
+struct BandedCholesky {
+  static void factorize(arma::mat& bands) {
+    const char uplo = 'U';
+    const int n = static_cast<int>(bands.n_cols), kd = static_cast<int>(bands.n_rows)-1, ldab = kd+1;
+    int info = 0;
+    F77_CALL(dpbtrf)(&uplo, &n, &kd, bands.memptr(), &ldab, &info FCONE);
+    if (info!=0) throw std::runtime_error("banded Cholesky: matrix is not positive definite (dpbtrf info=" + std::to_string(info) + ")");
+  }
+
+  static void solveFactorized(const arma::mat& bands, arma::mat& rhsThenSolution) {
+    const char uplo = 'U';
+    const int n = static_cast<int>(bands.n_cols), kd = static_cast<int>(bands.n_rows)-1, ldab = kd+1;
+    const int nrhs = static_cast<int>(rhsThenSolution.n_cols);
+    int info = 0;
+    F77_CALL(dpbtrs)(&uplo, &n, &kd, &nrhs, bands.memptr(), &ldab, rhsThenSolution.memptr(), &n, &info FCONE);
+    if (info!=0) throw std::runtime_error("banded Cholesky: solve failed (dpbtrs info=" + std::to_string(info) + ")");
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* PACKEDMATRIX_HPP */
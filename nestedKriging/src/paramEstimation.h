@@ -43,6 +43,22 @@ public:
   }
 };
 
+//------------------------------------------ estimationFingerprint
+// inputs of a parameter estimation, diagnostic options excepted, a checkpoint is only resumed by a run with the same inputs
+
+inline std::uint64_t estimationFingerprint(const arma::mat& X, const arma::vec& Y, const std::vector<signed long>& clusters,
+    const Long q, const std::string& covType, const Long niter, const arma::vec& paramStart, const arma::vec& paramLower,
+    const arma::vec& paramUpper, const double sd2, const std::string& krigingType, const Long seed, const std::vector<double>& gains,
+    const arma::vec& nugget, const std::string& defaultLOOmethod, const GlobalOptions& options) {
+  Fingerprint fingerprint;
+  fingerprint.add(std::string("estimParam")).add(X).add(Y).add(clusters).add(static_cast<double>(q)).add(covType);
+  fingerprint.add(static_cast<double>(niter)).add(paramStart).add(paramLower).add(paramUpper).add(sd2).add(krigingType);
+  fingerprint.add(static_cast<double>(seed)).add(gains).add(nugget).add(defaultLOOmethod);
+  for(const GlobalOptions::Option option: options.allOptions)
+    if (!GlobalOptions::isDiagnostic(option)) fingerprint.add(static_cast<double>(options.getOptionValue(option)));
+  return fingerprint.value();
+}
+
 template <int ShowProgress>
 Rcpp::List estimParamCpp(
     const arma::mat& X,
@@ -135,7 +151,47 @@ Rcpp::List estimParamCpp(
   double LOOMSEminus = std::numeric_limits<double>::signaling_NaN();
   BestParamSoFar<Parameter> bestParameterSoFar{};
 
-  for(Long i=1; i <=niter; ++i) {
+  // checkpoints of the iterations (the Algos of an iteration are short and not checkpointed), a run with the same
+  // inputs resumes after the last saved iteration, with the same generator state and the same results
+  CheckpointSchedule checkpoint(options.getOptionValue(GlobalOptions::Option::checkpoint));
+  const GlobalOptions algoOptions = options.withOptionValue(GlobalOptions::Option::checkpoint, 0);
+  const std::uint64_t fingerprint = checkpoint.enabled() ? estimationFingerprint(X, Y, clusters, q, covType, niter, paramStart,
+      paramLower, paramUpper, sd2, krigingType, seed, std::vector<double>{alpha, gamma, a, A, c}, nugget, defaultLOOmethod, options) : 0;
+  Long firstIteration = 1;
+  CheckpointRecords restored;
+  if (checkpoint.enabled() && restored.loadRun(checkpoint.path, fingerprint)) {
+    firstIteration = static_cast<Long>(restored.get("iteration").at(0)) + 1;
+    CheckpointRecords::restoreGenerator(generator, restored.get("generator"));
+    const std::vector<double>& savedIndices = restored.get("indices");
+    indices.assign(savedIndices.begin(), savedIndices.end());
+    paramCurrent = restored.getMatrix("paramCurrent", d, 1);
+    allParams = restored.getMatrix("allParams", niter, d);
+    allLooErrors = restored.get("allLooErrors");
+    paramPlus = restored.getMatrix("paramPlus", d, 1);
+    paramMinus = restored.getMatrix("paramMinus", d, 1);
+    LOOMSEplus = restored.get("errors").at(0);
+    LOOMSEminus = restored.get("errors").at(1);
+    bestParameterSoFar.observedParameter(restored.getMatrix("bestParam", d, 1), restored.get("errors").at(2));
+    for(Long i=1; i<firstIteration; ++i) progressBar.next();
+    screen.print(" resumed from " + checkpoint.path + " after iteration " + std::to_string(firstIteration-1), tagAlgo);
+  }
+  auto writeCheckpoint = [&](const Long iteration) {
+    CheckpointRecords records;
+    records.set("kind", std::vector<double>{2.0});
+    records.set("iteration", std::vector<double>{static_cast<double>(iteration)});
+    records.set("generator", CheckpointRecords::generatorState(generator));
+    records.set("indices", std::vector<double>(indices.begin(), indices.end()));
+    records.setView("paramCurrent", paramCurrent);
+    records.setView("allParams", allParams);
+    records.set("allLooErrors", std::vector<double>(allLooErrors));
+    records.setView("paramPlus", paramPlus);
+    records.setView("paramMinus", paramMinus);
+    records.setView("bestParam", bestParameterSoFar.bestParam);
+    records.set("errors", std::vector<double>{LOOMSEplus, LOOMSEminus, bestParameterSoFar.bestError});
+    checkpoint.write(records, fingerprint);
+  };
+
+  for(Long i=firstIteration; i <=niter; ++i) {
     //See, book Bhatnagar et al. chapter 5
     double ai = a/(std::pow(A+i+1,alpha));
     double deltai = c/(std::pow(i+1,gamma));
@@ -152,14 +208,14 @@ Rcpp::List estimParamCpp(
     // computation of the LOO errors and extracts the LOO-MSE
     paramPlus = exp( log(paramCurrent) + deltaiDeltai) ;
     Algo algoPlus(parallelism, X, Y, splitter, xSelected, paramPlus, sd2, ordinaryKriging, covType, tagAlgo, noVerbose,
-                  outputLevel, nugget, screenWithin, options, looScheme);
+                  outputLevel, nugget, screenWithin, algoOptions, looScheme);
     LOOMSEplus = algoPlus.output().getDefaultLOOError(looScheme);
     bestParameterSoFar.observedParameter(paramPlus, LOOMSEplus);
 
     // computation of the LOO errors and extracts the LOO-MSE
     paramMinus = exp( log(paramCurrent) - deltaiDeltai) ;
     Algo algoMinus(parallelism, X, Y, splitter, xSelected, paramMinus, sd2, ordinaryKriging, covType, tagAlgo, noVerbose,
-                   outputLevel, nugget, screenWithin, options, looScheme);
+                   outputLevel, nugget, screenWithin, algoOptions, looScheme);
     LOOMSEminus = algoMinus.output().getDefaultLOOError(looScheme);
     bestParameterSoFar.observedParameter(paramMinus, LOOMSEminus);
 
@@ -179,6 +235,7 @@ Rcpp::List estimParamCpp(
       screen.printContainer(paramCurrent, "   current estimation = ");
       screen.printContainer(std::vector<double> {LOOMSEplus, LOOMSEminus}, "   loo MSE vector = ");
       }
+    if (checkpoint.due() || (checkpoint.enabled() && (i==niter))) writeCheckpoint(i);
 
   }
   // The final estimate is the last proposal in allParams
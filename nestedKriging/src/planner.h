@@ -0,0 +1,248 @@
+
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+//===============================================================================
+// unit containing a planner choosing the number of groups N and the split of threads between the zone context
+// (prediction points) and the group context, from n, d, q, the covariance, the required outputs, the memory budget
+// and the throughput of the machine, measured by a short calibration (about 10 ms).
+// The predicted duration of a part is its workload (dense reference algorithm, cf. workload.h) at the calibrated
+// rates, divided by the threads that the part can use, and never shorter than its largest group or pair. Zones run
+// concurrently, each one repeating part A for its own prediction points. The planner only minimizes the duration:
+// the accuracy of the nested predictor slowly decreases when N grows.
+//
+// classes:
+// MachineCalibration, PlanCandidate, Planner
+//===============================================================================
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include "covariance.h"
+#include "workload.h"
+#include "memoryPlan.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== MachineCalibration
+// rates of one thread: kernel evaluations (for the chosen covariance and dimension) and dense linear algebra
+
+struct MachineCalibration {
+  double kernelEvaluationsBySecond = 1e8, flopsBySecond = 1e9;
+
+  MachineCalibration() = default;
+
+  MachineCalibration(const double kernelEvaluationsBySecond, const double flopsBySecond)
+    : kernelEvaluationsBySecond(kernelEvaluationsBySecond), flopsBySecond(flopsBySecond) {}
+
+  static MachineCalibration measure(const std::string& covType, const Long d, const Long size=192, const int repetitions=3) {
+    // best of a few repetitions: cross-correlations of size points, then Cholesky factor and solve of this matrix
+    using Clock = std::chrono::steady_clock;
+    arma::mat X(size, d);
+    for(Long obs=0; obs<size; ++obs)
+      for(Long k=0; k<d; ++k) X(obs, k) = std::fmod(0.5 + (obs+1)*(0.6180339887 + 0.4142135624*k), 1.0);
+    const CovarianceParameters covParams(d, arma::vec(2*d, arma::fill::ones), 1.0, covType);
+    const Covariance kernel(covParams);
+    const Points points(X, covParams);
+    arma::mat K(size, size), rhs(size, size, arma::fill::ones);
+    double kernelSeconds = std::numeric_limits<double>::infinity(), denseSeconds = kernelSeconds;
+    for(int repetition=0; repetition<repetitions; ++repetition) {
+      const Clock::time_point start = Clock::now();
+      kernel.fillAllocatedCrossCorrelations(K, points, points);
+      const Clock::time_point kernelEnd = Clock::now();
+      for(Long i=0; i<size; ++i) K(i, i) += static_cast<double>(size); // diagonally dominant, whatever the covariance
+      arma::mat R = arma::chol(K);
+      arma::mat z = arma::solve(arma::trimatl(R.t()), rhs, arma::solve_opts::fast);
+      z = arma::solve(arma::trimatu(R), z, arma::solve_opts::fast);
+      const Clock::time_point denseEnd = Clock::now();
+      kernelSeconds = std::min(kernelSeconds, std::chrono::duration<double>(kernelEnd-start).count());
+      denseSeconds = std::min(denseSeconds, std::chrono::duration<double>(denseEnd-kernelEnd).count());
+    }
+    const double sized = static_cast<double>(size), tiny = 1e-9;
+    const Workload dense = WorkloadModel::cholesky(sized) + WorkloadModel::choleskySolve(sized, sized);
+    return MachineCalibration(sized*sized/std::max(kernelSeconds, tiny), dense.flops/std::max(denseSeconds, tiny));
+  }
+};
+
+//=================================================== PlanCandidate
+// one configuration: N groups, zones running concurrently with threads each
+
+struct PlanCandidate {
+  Long groups = 1;
+  int zones = 1, threads = 1;
+  double predictedSeconds = 0.0, projectedPeakBytes = 0.0;
+  bool withinBudget = true;
+};
+
+//=================================================== Planner
+
+class Planner {
+  static constexpr Long minGroupSize = 8;
+  const double pointsByBlock = 8.0; // part C gathers prediction points by blocks
+  const Long n, d, q;
+  const MachineCalibration calibration;
+  const int availableThreads;
+  const double budgetBytes;
+  const bool ordinaryKriging, alternatives, covariances;
+
+  double seconds(const Workload& workload) const {
+    return workload.kernelEvaluations/calibration.kernelEvaluationsBySecond + workload.flops/calibration.flopsBySecond;
+  }
+
+  double partSeconds(const Workload& total, const Workload& largestUnit, const double units, const int threads) const {
+    // balanced over the usable threads, never shorter than the largest unit
+    if (units<=0) return 0.0;
+    const double usableThreads = std::max(1.0, std::min(static_cast<double>(threads), units));
+    return std::max(seconds(total)/usableThreads, seconds(largestUnit));
+  }
+
+public:
+  Planner(const Long n, const Long d, const Long q, const MachineCalibration& calibration, const int availableThreads,
+          const double budgetBytes, const bool ordinaryKriging, const bool alternatives, const bool covariances)
+    : n(n), d(d), q(std::max(q, static_cast<Long>(1))), calibration(calibration), availableThreads(std::max(availableThreads, 1)),
+      budgetBytes(budgetBytes), ordinaryKriging(ordinaryKriging), alternatives(alternatives), covariances(covariances) {}
+
+  static int availableCores() {
+    #if defined(_OPENMP)
+      return omp_get_num_procs();
+    #else
+      return 1;
+    #endif
+  }
+
+  static std::vector<Long> equalGroupSizes(const Long n, const Long N) {
+    std::vector<Long> sizes(N, n/N);
+    for(Long i=0; i<n%N; ++i) ++sizes[i];
+    return sizes;
+  }
+
+  std::vector<Long> groupCounts() const {
+    // geometric sequence from 1 to n/minGroupSize
+    const Long maxGroups = std::max(n/minGroupSize, static_cast<Long>(1));
+    std::vector<Long> counts{};
+    for(Long N=1; N<=maxGroups; N = std::max(N+1, static_cast<Long>(std::lround(1.25*N)))) counts.push_back(N);
+    return counts;
+  }
+
+  std::vector<int> zoneCounts() const {
+    // powers of 2 and all available threads; AlgoZones implements neither alternatives nor cross-covariances
+    std::vector<int> counts{1};
+    if (alternatives || covariances) return counts;
+    const int maxZones = static_cast<int>(std::min(static_cast<Long>(availableThreads), q));
+    for(int zones=2; zones<maxZones; zones*=2) counts.push_back(zones);
+    if (maxZones>1) counts.push_back(maxZones);
+    return counts;
+  }
+
+  PlanCandidate evaluate(const std::vector<Long>& groupSizes, const int zones, const int threads) const {
+    const Long zoneQ = (q+zones-1)/zones, N = groupSizes.size();
+    const double Nd = static_cast<double>(N), zoneQd = static_cast<double>(zoneQ);
+    const Long averageSize = (n+N-1)/N, largestSize = *std::max_element(groupSizes.begin(), groupSizes.end());
+    const NestedKrigingWorkload groups(std::vector<Long>(N, averageSize), zoneQ, d, ordinaryKriging);
+    const NestedKrigingWorkload average(std::vector<Long>(1, averageSize), zoneQ, d, ordinaryKriging);
+    const NestedKrigingWorkload largest(std::vector<Long>(1, largestSize), zoneQ, d, ordinaryKriging);
+    const double pairs = covariances ? Nd*(Nd+1)/2 : Nd*(Nd-1)/2;
+    const double blocks = std::ceil(zoneQd/pointsByBlock);
+
+    double predicted = partSeconds(average.partA(covariances)*Nd, largest.partA(covariances), Nd, threads);
+    const double size = static_cast<double>(averageSize), largeSize = static_cast<double>(largestSize);
+    predicted += partSeconds(groups.pairOfGroups(size, size, covariances)*pairs, groups.pairOfGroups(largeSize, largeSize, covariances), pairs, threads);
+    predicted += partSeconds(groups.partC(), groups.partC()*(std::min(pointsByBlock, zoneQd)/zoneQd), blocks, threads);
+    if (covariances) predicted += partSeconds(groups.partD(), Workload{}, zoneQd, threads);
+    if (alternatives) predicted += partSeconds(groups.partE(), Workload{}, zoneQd, threads);
+
+    PlanCandidate candidate;
+    candidate.groups = N; candidate.zones = zones; candidate.threads = threads;
+    candidate.predictedSeconds = predicted;
+    const MemoryPlan zonePlan(groupSizes, n, zoneQ, d, threads, alternatives, covariances);
+    candidate.projectedPeakBytes = zones*zonePlan.projectedPeakBytes();
+    candidate.withinBudget = (budgetBytes<=0) || (candidate.projectedPeakBytes<=budgetBytes);
+    return candidate;
+  }
+
+  std::vector<PlanCandidate> threadSplits(const std::vector<Long>& groupSizes) const {
+    std::vector<PlanCandidate> candidates{};
+    for(const int zones: zoneCounts()) candidates.push_back(evaluate(groupSizes, zones, std::max(availableThreads/zones, 1)));
+    return candidates;
+  }
+
+  std::vector<PlanCandidate> candidates() const {
+    std::vector<PlanCandidate> result{};
+    for(const Long N: groupCounts()) {
+      const std::vector<PlanCandidate> splits = threadSplits(equalGroupSizes(n, N));
+      result.insert(result.end(), splits.begin(), splits.end());
+    }
+    return result;
+  }
+
+  PlanCandidate fastest(const std::vector<PlanCandidate>& candidates) const {
+    const PlanCandidate* best = nullptr;
+    for(const PlanCandidate& candidate: candidates)
+      if (candidate.withinBudget && ((best==nullptr) || (candidate.predictedSeconds<best->predictedSeconds))) best = &candidate;
+    if (best!=nullptr) return *best;
+    std::ostringstream oss;
+    oss << "planner: no configuration fits the memory budget of " << budgetBytes/1048576 << " MiB";
+    throw std::runtime_error(oss.str());
+  }
+
+  PlanCandidate best() const {
+    return fastest(candidates());
+  }
+
+  PlanCandidate bestThreadSplit(const std::vector<Long>& groupSizes) const {
+    // for given clusters
+    return fastest(threadSplits(groupSizes));
+  }
+};
+
+//=================================================== plan_nested_kriging
+// recommended clusters number and threads, predicted duration and peak memory, with all evaluated candidates
+
+inline Rcpp::List plan_nested_kriging(const Long n, const Long d, const Long q, const std::string& covType, const long numThreads,
+                                      const double memoryBudget, const bool ordinaryKriging, const bool alternatives, const bool covariances) {
+  if ((n<1) || (d<1)) throw std::runtime_error("planner: n and d must be positive");
+  const MachineCalibration calibration = MachineCalibration::measure(covType, d);
+  const int threads = static_cast<int>((numThreads>0) ? numThreads : Planner::availableCores());
+  const Planner planner(n, d, q, calibration, threads, 1048576.0*memoryBudget, ordinaryKriging, alternatives, covariances);
+  const std::vector<PlanCandidate> candidates = planner.candidates();
+  const PlanCandidate best = planner.fastest(candidates);
+
+  std::vector<double> groups{}, predictedSeconds{}, projectedBytes{};
+  std::vector<int> zones{}, threadsByZone{};
+  std::vector<bool> withinBudget{};
+  for(const PlanCandidate& candidate: candidates) {
+    groups.push_back(static_cast<double>(candidate.groups)); zones.push_back(candidate.zones);
+    threadsByZone.push_back(candidate.threads); predictedSeconds.push_back(candidate.predictedSeconds);
+    projectedBytes.push_back(candidate.projectedPeakBytes); withinBudget.push_back(candidate.withinBudget);
+  }
+  return Rcpp::List::create(
+    Rcpp::Named("clusters") = static_cast<double>(best.groups),
+    Rcpp::Named("numThreadsZones") = best.zones,
+    Rcpp::Named("numThreads") = best.threads,
+    Rcpp::Named("predictedDuration") = best.predictedSeconds,
+    Rcpp::Named("projectedPeakBytes") = best.projectedPeakBytes,
+    Rcpp::Named("calibration") = Rcpp::List::create(
+      Rcpp::Named("kernelEvaluationsBySecond") = calibration.kernelEvaluationsBySecond,
+      Rcpp::Named("gflopsBySecond") = calibration.flopsBySecond/1e9),
+    Rcpp::Named("candidates") = Rcpp::DataFrame::create(
+      Rcpp::Named("clusters") = groups,
+      Rcpp::Named("numThreadsZones") = zones,
+      Rcpp::Named("numThreads") = threadsByZone,
+      Rcpp::Named("predictedDuration") = predictedSeconds,
+      Rcpp::Named("projectedPeakBytes") = projectedBytes,
+      Rcpp::Named("withinBudget") = withinBudget)
+  );
+}
+
+} //end namespace nestedKrig
+
+#endif /* PLANNER_HPP */
@@ -0,0 +1,104 @@
+
+#ifndef RANDOMFEATURES_HPP
+#define RANDOMFEATURES_HPP
+
+//===============================================================================
+// unit containing a random Fourier feature approximation of inter-group covariances (partB)
+// a stationary correlation is k(x,y) = E[cos(w'(x-y))] for w drawn from its spectral density, so that with
+// D features phi(x) = [cos(w_f'x), sin(w_f'x)]_f / sqrt(D/2), k(X_i, X_j) ~ Phi_i Phi_j^T and
+// alpha_i^T K_ij alpha_j ~ (Phi_i^T alpha_i)^T (Phi_j^T alpha_j): one D x q projection by group,
+// then N x N Gram products, O(n D q + N^2 D q) instead of O(sum ni nj q). The error decreases as 1/sqrt(D).
+//
+// classes:
+// SpectralDensity, RandomFourierFeatures
+//===============================================================================
+
+#include "common.h"
+#include "covariance.h"
+#include <random>
+#include <cmath>
+
+namespace nestedKrig {
+
+//=================================================== SpectralDensity
+// one-dimensional spectral densities of the rescaled kernels, tensor product kernels have independent coordinates
+// gauss exp(-t^2): w ~ N(0,2); Matern nu=k/2 on rescaled t: w = Z / sqrt(chi2_k) (Student), k=1,3,5 for exp, matern3_2, matern5_2
+
+class SpectralDensity {
+  bool gaussian = false;
+  int studentDegrees = 0;
+
+public:
+  explicit SpectralDensity(const CovarianceParameters& covParam) {
+    const CorrelationFunction* corrFunction = covParam.corrFunction;
+    if (dynamic_cast<const CorrGauss*>(corrFunction)!=nullptr) gaussian = true;
+    else if (dynamic_cast<const Correxp*>(corrFunction)!=nullptr) studentDegrees = 1;
+    else if (dynamic_cast<const CorrMatern32*>(corrFunction)!=nullptr) studentDegrees = 3;
+    else if (dynamic_cast<const CorrMatern52*>(corrFunction)!=nullptr) studentDegrees = 5;
+  }
+
+  bool available() const {
+    return gaussian || (studentDegrees>0);
+  }
+
+  template <typename Generator>
+  double sample(Generator& generator) const {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    const double z = normal(generator);
+    if (gaussian) return std::sqrt(2.0)*z;
+    double chi2 = 0.0;
+    for(int l=0; l<studentDegrees; ++l) { const double t = normal(generator); chi2 += t*t; }
+    return z/std::sqrt(chi2);
+  }
+};
+
+//=================================================== RandomFourierFeatures
+// frequencies are drawn once from a fixed seed: results are reproducible and identical for all groups
+
+class RandomFourierFeatures {
+  arma::mat frequencies{}; // d x (D/2)
+
+public:
+  static constexpr unsigned long defaultSeed = 0;
+
+  RandomFourierFeatures(const CovarianceParameters& covParam, const PointDimension d, const Long numberOfFeatures,
+                        const unsigned long seed = defaultSeed) {
+    const SpectralDensity density(covParam);
+    if (!density.available()) throw std::runtime_error("random features are only available for gauss, exp, matern3_2, matern5_2 kernels");
+    const Long numberOfFrequencies = (numberOfFeatures+1)/2;
+    std::mt19937_64 generator(seed);
+    frequencies.set_size(d, numberOfFrequencies);
+    for(Long f=0; f<numberOfFrequencies; ++f)
+      for(PointDimension k=0; k<d; ++k) frequencies.at(k, f) = density.sample(generator);
+  }
+
+  Long numberOfFeatures() const {
+    return 2*frequencies.n_cols;
+  }
+
+  arma::mat features(const Points& points) const {
+    // n x D matrix Phi, such that Phi Phi^T approximates the correlation matrix of points
+    const Long n = points.size(), F = frequencies.n_cols;
+    arma::mat coordinates(n, frequencies.n_rows);
+    for(PointDimension k=0; k<frequencies.n_rows; ++k)
+      for(Long i=0; i<n; ++i) coordinates.at(i,k) = points[i][k];
+    const arma::mat phases = coordinates*frequencies;
+    const double normalization = 1.0/std::sqrt(static_cast<double>(F));
+    arma::mat phi(n, 2*F);
+    for(Long f=0; f<F; ++f)
+      for(Long i=0; i<n; ++i) {
+        phi.at(i, f) = normalization*std::cos(phases.at(i,f));
+        phi.at(i, F+f) = normalization*std::sin(phases.at(i,f));
+      }
+    return phi;
+  }
+
+  arma::mat projection(const Points& points, const arma::mat& weights) const {
+    // Phi^T weights, D x q
+    return features(points).t()*weights;
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* RANDOMFEATURES_HPP */
@@ -10,7 +10,7 @@
 // can also split personal types, if these types are added in the class WithInterface below
 // or by using splitAs<personal_type, splittable_type>
 
-// Classes: Ranks, WithInterface, Splitter
+// Classes: Ranks, WithInterface, SequentialGroups, Splitter
 //===============================================================================
 //
 // e.g. typical use, splittedMat[0] will contain rows 1, 3, 4 and splittedMat[1] rows 2, 5
@@ -239,6 +239,16 @@ struct WithInterface<const Points> {
   inline static Long ncols(const T& object)  { return object.d; }
 };
 
+//========================================================== SequentialGroups
+// default group loop of Splitter::splitAs: all groups allocated and filled by the calling thread
+
+struct SequentialGroups {
+  template <typename GroupFunction>
+  void forEachGroup(const Long numberOfGroups, GroupFunction group) const {
+    for(Long i=0; i<numberOfGroups; ++i) group(i);
+  }
+};
+
 //========================================================== Splitter
 // Tool for splitting a container into a vector of smaller containers (and remerging back)
 
@@ -314,22 +324,26 @@ public:
     return N;
   }
 
+  const std::vector<Long>& get_groupSizes() const {
+    return groupSize;
+  }
+
   Long get_maxGroupSize() const {
     return *std::max_element(groupSize.begin(),groupSize.end());
   }
 
-  template <typename T, typename Interface>
-  void splitAs(const T& source, std::vector<T>& splittedOutput) const {
+  template <typename T, typename Interface, typename Groups = SequentialGroups>
+  void splitAs(const T& source, std::vector<T>& splittedOutput, const Groups& groups = Groups()) const {
     //split an object of type T thas has the same interface as a splittable object of type Interface
+    //groups.forEachGroup gives the thread that allocates and fills each group (e.g. NumaPlacement)
     try{
       splittedOutput.resize(N);
       const Long ncols = WithInterface<Interface>::template ncols<T>(source);
-      for(Long i=0; i<N; ++i)
+      groups.forEachGroup(N, [&](const Long i) {
         WithInterface<Interface>::template reserve<T>(splittedOutput[i], groupSize[i], ncols);
-      for(Long i=0; i<N; ++i) {
         for(Long r=0; r<groupSize[i]; ++r)
           WithInterface<Interface>::template identify<T>(splittedOutput[i], r, source, obsByGroup[i][r]);
-      }
+      });
     }
     catch(const std::exception& e) {
       throw std::runtime_error("error when splitting objects (splitter::splitAs)");
@@ -356,6 +370,11 @@ public:
     splitAs<T, T>(source, splittedOutput);
   }
 
+  template <typename T, typename Groups>
+  inline void split(const T& source, std::vector<T>& splittedOutput, const Groups& groups) const {
+    splitAs<T, T, Groups>(source, splittedOutput, groups);
+  }
+
   template <typename T>
   inline std::vector<T> split(const T& source) const {
     std::vector<T> splittedOutput;
@@ -5,8 +5,12 @@
 #include "covariance.h"
 #include "nestedKriging.h"
 #include "leaveOneOut.h"
+#include "vecchia.h"
+#include "distributed.h"
+#include "paramEstimation.h"
 #include <chrono>
 #include <thread>
+#include <numeric>
 
 // [[Rcpp::plugins(openmp, cpp11)]]
 using namespace Rcpp;
@@ -335,7 +339,7 @@ double getLOOerror(CaseStudy& cas, Long numThreadsZ=1, Long numThreadsG=1) {
   return value;
 }
 
-Output getDetailedOutput(CaseStudy& cas, int outputLevel) {
+Output getDetailedOutput(CaseStudy& cas, int outputLevel, const Rcpp::IntegerVector& globalOptions = Rcpp::IntegerVector {0}) {
   Parallelism parallelism;
   parallelism.setThreadsNumber<Parallelism::outerContext>(1);
   parallelism.setThreadsNumber<Parallelism::innerContext>(4);
@@ -344,7 +348,7 @@ Output getDetailedOutput(CaseStudy& cas, int outputLevel) {
   int outputDetailLevel=outputLevel;
   NuggetVector noNugget {0.0};
   Screen screen(verboseLevel);
-  GlobalOptions options(Rcpp::IntegerVector {0});
+  GlobalOptions options(globalOptions);
   std::string tag="";
   LOOScheme looScheme{};
   Algo algo(parallelism, cas.X, cas.Y, splitter, cas.x, cas.param, cas.sd2, cas.ordinaryKriging, cas.covType, tag,
@@ -352,6 +356,41 @@ Output getDetailedOutput(CaseStudy& cas, int outputLevel) {
   return algo.output();
 }
 
+//------------------------------------------------------------------- Same Algo results as a reference
+// the Algo on cas with the given options against the Algo on reference with default options, for simple and
+// ordinary Kriging: predmean and predsd2 close within the precision of the test (tolerance=0), or within
+// tolerance*(1+norm) when the solver is approximate, then solver-specific checks on both outputs
+
+template <typename SpecificChecks>
+void assertSameAsReference(Test& test, CaseStudy cas, CaseStudy reference, const Rcpp::IntegerVector& options,
+                           const double tolerance, const std::string& label, SpecificChecks specificChecks) {
+  for(bool ordinaryKriging : {false, true}) {
+    const std::string tag = (label.empty() ? "" : " " + label) + (ordinaryKriging ? " OK" : " SK");
+    cas.ordinaryKriging = reference.ordinaryKriging = ordinaryKriging;
+    const Output out = getDetailedOutput(cas, 2, options);
+    const Output expected = getDetailedOutput(reference, 2);
+    if (tolerance>0) {
+      test.assertTrue(arma::norm(out.predmean-expected.predmean) <= tolerance*(1+arma::norm(expected.predmean)), "Algo predmean" + tag);
+      test.assertTrue(arma::norm(out.predsd2-expected.predsd2) <= tolerance*(1+arma::norm(expected.predsd2)), "Algo predsd2" + tag);
+    }
+    else {
+      test.assertCloseValues(out.predmean, expected.predmean, "Algo predmean" + tag);
+      test.assertCloseValues(out.predsd2, expected.predsd2, "Algo predsd2" + tag);
+    }
+    specificChecks(out, expected, tag);
+  }
+}
+
+void assertSameAsReference(Test& test, const CaseStudy& cas, const CaseStudy& reference, const std::string& label) {
+  assertSameAsReference(test, cas, reference, Rcpp::IntegerVector {0}, 0.0, label, [](const Output&, const Output&, const std::string&) {});
+}
+
+template <typename SpecificChecks>
+void assertSameAsDense(Test& test, const CaseStudy& cas, const Rcpp::IntegerVector& options, const double tolerance,
+                       const std::string& label, SpecificChecks specificChecks) {
+  assertSameAsReference(test, cas, cas, options, tolerance, label, specificChecks);
+}
+
 //------------------------------------------------------------------- Given Cases
 // extract our a vector of Algo results for different cases and pickx
 
@@ -490,6 +529,47 @@ Test testProgressBar() {
   }
   return test;
 }
+//---------------------------------------------------- test LogQueue
+Test testLogQueue() {
+  Test test("I_ Lock-free message queue and progress counter (messages.h)");
+  constexpr int numThreads = 8;
+  constexpr Long messagesByThread = 200;
+  LogQueue queue(4096);
+  #pragma omp parallel for num_threads(numThreads) schedule(static, 1)
+  for(int t=0; t<numThreads; ++t)
+    for(Long k=0; k<messagesByThread; ++k) queue.push(std::to_string(t) + " " + std::to_string(k));
+  std::vector<Long> nextOfThread(numThreads, 0);
+  bool ordered = true;
+  Long received = 0;
+  queue.tryDrain([&](const LogQueue::Entry& entry) {
+    std::istringstream iss(entry.text);
+    int t; Long k;
+    iss >> t >> k;
+    ordered = ordered && (k==nextOfThread[t]);
+    nextOfThread[t] = k+1;
+    ++received;
+  });
+  test.assertClose(received, numThreads*messagesByThread, "all messages received");
+  test.assertTrue(ordered, "messages of each thread in order");
+  test.assertClose(queue.droppedMessages(), 0, "no dropped message");
+
+  LogQueue small(4);
+  for(Long k=0; k<6; ++k) small.push("message");
+  test.assertClose(small.droppedMessages(), 2, "full queue drops messages");
+  Long drained = 0;
+  small.tryDrain([&](const LogQueue::Entry&) { ++drained; });
+  test.assertClose(drained, 4, "slots reused after drain");
+  test.assertTrue(small.push("again"), "push after drain");
+
+  const Screen screen(Screen::verboseLevels::errorsAndWarningsOnly);
+  Chrono chrono(screen, "test progressBar");
+  ProgressBar<2> progressBar(chrono, 1000, 10);
+  #pragma omp parallel for num_threads(numThreads)
+  for(Long k=0; k<1000; ++k) progressBar.next();
+  test.assertClose(progressBar.get_done(), 1000, "atomic progress counter");
+  return test;
+}
+
 //---------------------------------------------------- test Kernel
 
 Test testPoints() {
@@ -657,6 +737,28 @@ Test testCorrWithEquivalentNuggets() {
   return test;
 }
 
+Test testTiledCorrMatrixFill() {
+  Test test("I_ tiled and threaded fill of the correlation matrix (covariance.h)");
+  for(long factor : {1, 3, 6}) {
+    CaseStudy myCase(factor, "matern5_2", factor);
+    const std::string tag = " n=" + std::to_string(myCase.n);
+    CovarianceParameters covParams(myCase.d, myCase.param, myCase.sd2, myCase.covType);
+    Covariance kernel(covParams);
+    Points pointsX(myCase.X, covParams);
+    NuggetVector nugget{0.1, 0.2, 0.3};
+    arma::mat K, KtiledOneThread(myCase.n, myCase.n), KtiledFourThreads(myCase.n, myCase.n);
+    kernel.fillCorrMatrix(K, pointsX, nugget);
+    kernel.fillAllocatedCorrMatrix(KtiledOneThread, pointsX, nugget, 1);
+    kernel.fillAllocatedCorrMatrix(KtiledFourThreads, pointsX, nugget, 4);
+    test.assertCloseValues(KtiledOneThread, K, "tiled fill, one thread"+tag);
+    test.assertCloseValues(KtiledFourThreads, K, "tiled fill, four threads"+tag);
+    PackedSymMatrix Kpacked(myCase.n, myCase.n);
+    kernel.fillAllocatedCorrMatrix(Kpacked, pointsX, nugget, 4);
+    test.assertCloseValues(Kpacked.toDense(), K, "packed fill, four threads"+tag);
+  }
+  return test;
+}
+
 Test testKernelIdenticalNicolas() {
     Test test("I_ Kernel, corr as Nicolas Python code (covariance.h)");
     test.createSection("gauss");
@@ -978,27 +1080,27 @@ Test testCovariances_kM_and_KM_Basic() {
     if (detailLevel==2) {
       tag=" sans calculs cross-cov";
       test.assertTrue(!out.requiredByUser.covariances(), "basic calculations when outputLevel=2");
-      kM2 = out.kM[0];
-      KM2 = out.KM[0];
+      kM2 = out.kMofPoint(0);
+      KM2 = out.KMofPoint(0);
     } else {
       tag=" avec calculs cross-cov";
       test.assertTrue(out.requiredByUser.covariances(), "should compute all cross-corr when outputLevel=12");
-      kM12 = out.kM[0];
-      KM12 = out.KM[0];
+      kM12 = out.kMofPoint(0);
+      KM12 = out.KMofPoint(0);
     }
     for(Long m=0; m<cas.q; ++m) {
-      test.assertTrue(out.kM[m].n_elem==cas.N, "nbElem kM"+tag);
-      test.assertTrue(out.KM[m].n_rows==cas.N, "nbRows KM"+tag);
-      test.assertTrue(out.KM[m].n_cols==cas.N, "nbCols KM"+tag);
+      test.assertTrue(out.kMofPoint(m).n_elem==cas.N, "nbElem kM"+tag);
+      test.assertTrue(out.KMofPoint(m).n_rows==cas.N, "nbRows KM"+tag);
+      test.assertTrue(out.KMofPoint(m).n_cols==cas.N, "nbCols KM"+tag);
     }
     double epsilon = 1024 * std::numeric_limits<double>::epsilon();
-    test.assertTrue(out.kM[0].max()-out.kM[0].min()<1e10, "kM reasonable values"+tag);
-    test.assertTrue(out.kM[0].max() <= +1+epsilon, "kM <1"+tag);
-    test.assertTrue(out.kM[0].min() >= -1, "kM >-1"+tag);
-    test.assertTrue(out.KM[0].max()-out.KM[0].min()<1e10, "KM reasonable values"+tag);
-    test.assertTrue(out.KM[0].max() <= +1+epsilon, "KM <1"+tag);
-    test.assertTrue(out.KM[0].min() >= -1, "KM >-1"+tag);
-    test.assertCloseValues(out.KM[0], out.KM[0].t(), "KM symmetric"+tag);
+    test.assertTrue(out.kMofPoint(0).max()-out.kMofPoint(0).min()<1e10, "kM reasonable values"+tag);
+    test.assertTrue(out.kMofPoint(0).max() <= +1+epsilon, "kM <1"+tag);
+    test.assertTrue(out.kMofPoint(0).min() >= -1, "kM >-1"+tag);
+    test.assertTrue(out.KMofPoint(0).max()-out.KMofPoint(0).min()<1e10, "KM reasonable values"+tag);
+    test.assertTrue(out.KMofPoint(0).max() <= +1+epsilon, "KM <1"+tag);
+    test.assertTrue(out.KMofPoint(0).min() >= -1, "KM >-1"+tag);
+    test.assertCloseValues(out.KMofPoint(0), out.KMofPoint(0).t(), "KM symmetric"+tag);
   } //end detailLevel
   test.assertCloseValues(kM2, kM12, "kM unchanged when computing cross-cov");
   test.assertCloseValues(KM2, KM12, "KM unchanged when computing cross-cov");
@@ -1017,11 +1119,11 @@ Test testCovariances_kM_and_KM_LinkWhenSK() {
       Output out = getDetailedOutput(cas, detailLevel);
       std::string tag=(detailLevel<10)?" sans calculs cross-cov":" avec calculs cross-cov";
       test.assertTrue(out.requiredByUser.covariances()==(detailLevel>=10), "bool compute all cross-corr when outputLevel>10");
-      test.assertClose(out.KM[0](0,0), out.kM[0](0), "first item diag(KM)=kM "+tag);
+      test.assertClose(out.KMofPoint(0)(0,0), out.kMofPoint(0)(0), "first item diag(KM)=kM "+tag);
       Long q= cas.x.n_rows;
       for(Long m=0; m<q; ++m) {
-        test.assertCloseValues(arma::diagvec(out.KM[m]), out.kM[m], "diag(KM)=kM "+tag);
-        test.assertCloseValues(arma::diagvec(out.KM[m]), 1-out.sd2_M[m]/cas.sd2, "diag(KM)=1-sd2_M/sd2 "+tag);
+        test.assertCloseValues(arma::diagvec(out.KMofPoint(m)), out.kMofPoint(m), "diag(KM)=kM "+tag);
+        test.assertCloseValues(arma::diagvec(out.KMofPoint(m)), 1-out.sd2_M[m]/cas.sd2, "diag(KM)=1-sd2_M/sd2 "+tag);
       }
   }
   return test;
@@ -1037,10 +1139,10 @@ Test testOutputCovariances_kkM_and_KKM() {
     test.assertTrue(out.kkM[m][m].n_elem==cas.N, "nbElem kkM");
     test.assertTrue(out.KKM[m][m].n_rows==cas.N, "nbRows KKM");
     test.assertTrue(out.KKM[m][m].n_cols==cas.N, "nbCols KKM");
-    test.assertCloseValues(out.kkM[m][m], out.kM[m], "kkM[x][x']=cov(M_i(x),Y(x'))=cov(M_i(x),Y(x))=kM[x] when x=x'");
-    test.assertCloseValues(out.KKM[m][m], out.KM[m], "KKM[x][x']=cov(M_i(x),M_j(x'))=cov(M_i(x),M_j(x))=KM[x] when x=x'");
+    test.assertCloseValues(out.kkM[m][m], out.kMofPoint(m), "kkM[x][x']=cov(M_i(x),Y(x'))=cov(M_i(x),Y(x))=kM[x] when x=x'");
+    test.assertCloseValues(out.KKM[m][m], out.KMofPoint(m), "KKM[x][x']=cov(M_i(x),M_j(x'))=cov(M_i(x),M_j(x))=KM[x] when x=x'");
   }
-  test.assertCloseValues(arma::diagvec(out.KM[0]), out.kM[0], "diag(KM)=kM");
+  test.assertCloseValues(arma::diagvec(out.KMofPoint(0)), out.kMofPoint(0), "diag(KM)=kM");
   test.assertCloseValues(arma::diagvec(out.KKM[0][0]), out.kkM[0][0], "diag(KKM)=kkM when x=x'");
   test.assertCloseValues(arma::diagvec(out.KKM[0][1]), out.kkM[0][1], "diag(KKM)=kkM when x, x' distinct (i)");
   test.assertCloseValues(arma::diagvec(out.KKM[1][0]), out.kkM[1][0], "diag(KKM)=kkM when x, x' distinct (ii)");
@@ -1114,7 +1216,7 @@ Test test_cagg_kaggAsCalculatedWhenNisOne() {
 
   cas.setGroupsN_equals_n();
   Output out2 = getDetailedOutput(cas, detailLevel);
-  test.assertClose(out2.kM[0].size(), cas.n, "check case has changed to N=n");
+  test.assertClose(out2.kMofPoint(0).size(), cas.n, "check case has changed to N=n");
   test.assertCloseValues(out2.kagg, out.kagg, "when N=1 or N=n, covPrior unchanged");
   test.assertCloseValues(out2.cagg, out.cagg, "when N=1 or N=n, cov unchanged");
 
@@ -1128,9 +1230,9 @@ Test testOutputCovariancesAsPreviousRun() {
   cas.setSimpleKriging();
   int outputLevel = 12;
   Output out = getDetailedOutput(cas, outputLevel);
-  test.assertClose(4.16709833934e-005,out.kM[0](0), "kM[0](0)");
-  test.assertClose(6.66250741482e-005,out.KM[0](0,1), "KM[0](0,1)");
-  test.assertClose(6.66250741482e-005,out.KM[0](1,0), "KM[0](1,0)");
+  test.assertClose(4.16709833934e-005,out.kMofPoint(0)(0), "kM[0](0)");
+  test.assertClose(6.66250741482e-005,out.KMofPoint(0)(0,1), "KM[0](0,1)");
+  test.assertClose(6.66250741482e-005,out.KMofPoint(0)(1,0), "KM[0](1,0)");
   test.assertClose(3.54560512899e-007,out.kkM[0][1](0), "kkM[0][1](0,1)");
   test.assertClose(7.57698118841e-007,out.KKM[0][1](0,1), "kkM[0][1](0,1)");
   test.assertClose(5.6510974386e-007,out.KKM[0][1](1,0), "KKM[0][1](1,0)");
@@ -1139,9 +1241,9 @@ Test testOutputCovariancesAsPreviousRun() {
   casBis.increaseLengthScalesBy(0.5);
   Output outBis = getDetailedOutput(casBis, outputLevel);
   test.assertTrue(casBis.ordinaryKriging, "test also ordinaryKriging");
-  test.assertClose(0.000758795972717,outBis.kM[0](0), "Bis_kM[0](0)");
-  test.assertClose(0.0596581479612,outBis.KM[0](0,1), "Bis_KM[0](0,1)");
-  test.assertClose(0.0596581479612,outBis.KM[0](1,0), "Bis_KM[0](1,0)");
+  test.assertClose(0.000758795972717,outBis.kMofPoint(0)(0), "Bis_kM[0](0)");
+  test.assertClose(0.0596581479612,outBis.KMofPoint(0)(0,1), "Bis_KM[0](0,1)");
+  test.assertClose(0.0596581479612,outBis.KMofPoint(0)(1,0), "Bis_KM[0](1,0)");
   test.assertClose(0.00420812203399,outBis.kkM[0][1](0), "Bis_kkM[0][1](0,1)");
   test.assertClose(0.0376569454574,outBis.KKM[0][1](0,1), "Bis_kkM[0][1](0,1)");
   test.assertClose(0.0625215403418,outBis.KKM[0][1](1,0), "Bis_KKM[0][1](1,0)");
@@ -1315,6 +1417,1183 @@ Test testWeightsSolveSystem() {
   return test;
 }
 
+Test testBatchedSolver() {
+  Test test("II_ Batched solver gives the same weights as separate solves (kriging.h)");
+  CaseStudy cas(2, "matern5_2");
+  Output out = getDetailedOutput(cas, 2);
+  const Long N = cas.N, qBatch = 3*ChosenBatchedSolver::minBatchSizeForThreads+1;
+  arma::mat KMBatch(qBatch, out.KMbyPair.n_cols); // pair-major, as Output::KMbyPair
+  arma::mat kMBatch(N, qBatch);
+  for(Long m=0; m<qBatch; ++m) {
+    KMBatch.row(m) = out.KMbyPair.row(m%cas.q);
+    kMBatch.col(m) = out.kMofPoint(m%cas.q);
+  }
+  arma::mat weightsOneThread, weightsFourThreads;
+  ChosenBatchedSolver::findWeights(KMBatch, kMBatch, weightsOneThread, 1);
+  ChosenBatchedSolver::findWeights(KMBatch, kMBatch, weightsFourThreads, 4);
+  test.assertCloseValues(weightsOneThread, weightsFourThreads, "no thread impact on batched weights");
+  for(Long m=0; m<qBatch; ++m) {
+    arma::mat weightsColm(N,1);
+    ChosenSolver::findWeights(out.KMofPoint(m%cas.q), out.kMofPoint(m%cas.q), weightsColm);
+    test.assertCloseValues(weightsFourThreads.col(m), weightsColm, "batched weights = separate solve, m=" + std::to_string(m));
+  }
+  test.assertCloseValues(out.weights.col(0), weightsOneThread.col(0), "weights stored by Algo");
+  arma::mat weightsPacked;
+  PackedBatchedSolver::findWeights(KMBatch, kMBatch, weightsPacked, 4);
+  test.assertCloseValues(weightsPacked, weightsOneThread, "packed batched weights = dense batched weights");
+  return test;
+}
+
+Test testPackedStorage() {
+  Test test("II_ Packed symmetric storage gives the same results as dense storage (packedMatrix.h)");
+  CaseStudy cas(2, "matern3_2");
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  NuggetVector nugget {0.01, 0.02};
+  arma::mat K, k;
+  kernel.fillCorrMatrix(K, pointsX, nugget);
+  kernel.fillCrossCorrelations(k, pointsX, pointsx);
+  PackedSymMatrix Kpacked(K.n_rows, K.n_cols);
+  kernel.fillAllocatedCorrMatrix(Kpacked, pointsX, nugget);
+  test.assertTrue(Kpacked.n_elem()==K.n_rows*(K.n_rows+1)/2, "packed size n(n+1)/2");
+  test.assertCloseValues(Kpacked.toDense(), K, "packed fill = dense fill");
+  test.assertCloseValues(PackedSymMatrix(K).toDense(), K, "dense -> packed -> dense");
+  arma::mat weightsDense, weightsPacked;
+  ChosenSolver::findWeights(K, k, weightsDense);
+  LinearSolver<SolverChoice::PackedCholesky>::findWeights(K, k, weightsPacked);
+  test.assertCloseValues(weightsPacked, weightsDense, "packed Cholesky weights");
+
+  type_Y Y = cas.Y.t();
+  LOOScheme noLOO{};
+  LOOExclusions noExclusions(noLOO, 0);
+  const Long q = k.n_cols;
+  for(bool ordinaryKriging : {false, true}) {
+    std::string tag = ordinaryKriging?" OK":" SK";
+    arma::mat weightsA, weightsB;
+    arma::rowvec meanA(q), meanB(q);
+    std::vector<double> covMY_A(q), covMM_A(q), covMY_B(q), covMM_B(q);
+    ChosenPredictor(K, k, Y, ordinaryKriging).fillResults(weightsA, meanA, covMY_A, covMM_A);
+    PackedSymMatrix KpackedCopy(K);
+    PackedKrigingPredictor(KpackedCopy, k, Y, ordinaryKriging, noExclusions).fillResults(weightsB, meanB, covMY_B, covMM_B);
+    test.assertCloseValues(weightsB, weightsA, "predictor weights"+tag);
+    test.assertCloseValues(meanB, meanA, "predictor mean_M"+tag);
+    test.assertCloseValues(arma::vec(covMY_B), arma::vec(covMY_A), "predictor cov_MY"+tag);
+    test.assertCloseValues(arma::vec(covMM_B), arma::vec(covMM_A), "predictor cov_MM"+tag);
+  }
+
+  assertSameAsDense(test, cas, Rcpp::IntegerVector {0, 1, 1, 1}, 0.0, "", [&](const Output& outPacked, const Output& outDense, const std::string& tag) {
+    test.assertCloseValues(outPacked.KMofPoint(0), outDense.KMofPoint(0), "Algo KM"+tag);
+  });
+  return test;
+}
+
+Test testMixedPrecision() {
+  Test test("II_ Mixed precision factorizations with double refinement (kriging.h)");
+  test.setPrecision(1e-6);
+  CaseStudy cas(3, "matern5_2");
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  NuggetVector nugget {0.05};
+  arma::mat K, k;
+  kernel.fillCorrMatrix(K, pointsX, nugget);
+  kernel.fillCrossCorrelations(k, pointsX, pointsx);
+  arma::mat weightsDouble, weightsMixed;
+  ChosenSolver::findWeights(K, k, weightsDouble);
+  LinearSolver<SolverChoice::MixedPrecision>::findWeights(K, k, weightsMixed);
+  test.assertCloseValues(weightsMixed, weightsDouble, "refined weights");
+
+  arma::mat nearlySingular("1 0.999999999; 0.999999999 1");
+  arma::mat rhs("1; 2");
+  MixedPrecisionCholesky factorization(nearlySingular);
+  arma::mat solution = rhs;
+  factorization.solve(solution);
+  test.assertTrue(factorization.usesDoubleFallBack(), "float Cholesky fails, double fall back");
+  test.assertCloseValues(nearlySingular*solution, rhs, "fall back solution");
+
+  assertSameAsDense(test, cas, Rcpp::IntegerVector {0, 1, 1, 0, 1}, 0.0, "", [&](const Output& outMixed, const Output& outDouble, const std::string& tag) {
+    test.assertCloseValues(outMixed.weights, outDouble.weights, "Algo weights"+tag);
+  });
+  return test;
+}
+
+Test testIterativeSolver() {
+  Test test("II_ Matrix-free conjugate gradients give the same results as factorizations (iterativeSolver.h)");
+  test.setPrecision(1e-6);
+  CaseStudy cas(3, "matern5_2");
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  NuggetVector nugget {0.05};
+  arma::mat K, k;
+  kernel.fillCorrMatrix(K, pointsX, nugget);
+  kernel.fillCrossCorrelations(k, pointsX, pointsx);
+  for(int numThreads : {1, 4}) {
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, pointsX, nugget, numThreads);
+    test.assertCloseValues(Kop.multiply(k), K*k, "matrix-free product, threads=" + std::to_string(numThreads));
+  }
+  arma::mat weightsDense;
+  ChosenSolver::findWeights(K, k, weightsDense);
+  for(Long blockSize : {Long(1), Long(8), Long(1000)}) {
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, pointsX, nugget, 1);
+    arma::mat weightsCG = k;
+    PreconditionedConjugateGradient(Kop, blockSize).solve(weightsCG);
+    const std::string tag = ", preconditioner blocks of " + std::to_string(blockSize);
+    // small weights are only accurate up to the residual: compare whole matrices, not items
+    test.assertTrue(arma::norm(weightsCG-weightsDense) <= 1e-6*arma::norm(weightsDense), "conjugate gradient weights" + tag);
+    test.assertTrue(arma::norm(K*weightsCG-k) <= 1e-8*arma::norm(k), "conjugate gradient residual" + tag);
+    test.assertTrue(Kop.statistics.maxRelativeResidual <= PreconditionedConjugateGradient::tolerance, "converged" + tag);
+  }
+
+  assertSameAsDense(test, cas, Rcpp::IntegerVector {0, 1, 1, 0, 0, 1}, 0.0, "", [&](const Output& outIterative, const Output& outDense, const std::string& tag) {
+    const std::vector<std::string>& names = outIterative.chronoReport.counterNames;
+    const Long position = std::find(names.begin(), names.end(), "partA.cgSolves") - names.begin();
+    test.assertTrue(position<names.size(), "counters reported"+tag);
+    if (position<names.size()) test.assertClose(outIterative.chronoReport.counterValues[position], cas.N, "one solve per group"+tag);
+    test.assertTrue(outDense.chronoReport.counterNames.empty(), "no counters without iterative solver"+tag);
+  });
+  return test;
+}
+
+Test testMarkovExp() {
+  Test test("II_ Exact O(n) solver for the one-dimensional exponential kernel (markovSolver.h)");
+  CaseStudy cas(4, "exp", 3);
+  cas.d = 1;
+  cas.X = arma::mat(cas.X.col(0)); cas.x = arma::mat(cas.x.col(0)); cas.param = arma::vec(cas.param.head(1));
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  test.assertTrue(covParams.isOneDimensionalExponential(), "d=1, exp kernel detected");
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  arma::vec nuggetValues = arma::linspace<arma::vec>(0.0, 0.1, cas.n);
+  NuggetVector noNugget{}, nugget = nuggetValues;
+  for(const NuggetVector& nuggetCase : {noNugget, nugget}) {
+    const std::string tag = (nuggetCase.size()==0)?" no nugget":" nugget";
+    arma::mat K, k;
+    kernel.fillCorrMatrix(K, pointsX, nuggetCase);
+    kernel.fillCrossCorrelations(k, pointsX, pointsx);
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, pointsX, nuggetCase, 1);
+    arma::mat weightsDense, weightsMarkov = k;
+    ChosenSolver::findWeights(K, k, weightsDense);
+    MarkovExpFactorization factorization(Kop);
+    factorization.solve(weightsMarkov);
+    test.assertTrue(!factorization.usesDenseFallBack(), "tridiagonal precision used" + tag);
+    test.assertTrue(arma::norm(weightsMarkov-weightsDense) <= 1e-8*arma::norm(weightsDense), "weights" + tag);
+    test.assertTrue(arma::norm(K*weightsMarkov-k) <= 1e-10*arma::norm(k), "residual" + tag);
+  }
+  arma::mat W(cas.n, 3);
+  W.imbue(Rng(1));
+  arma::mat kxX;
+  kernel.fillCrossCorrelations(kxX, pointsx, pointsX);
+  test.assertCloseValues(MarkovExp::crossProduct(pointsx, pointsX, W), kxX*W, "sweeps cross product");
+
+  CaseStudy duplicated = cas;
+  duplicated.X.row(1) = duplicated.X.row(0);
+  Points pointsDuplicated(duplicated.X, covParams);
+  KernelOperator KopDuplicated(cas.n, cas.n);
+  KopDuplicated.bind(kernel, pointsDuplicated, nugget, 1);
+  test.assertTrue(MarkovExpFactorization(KopDuplicated).usesDenseFallBack(), "duplicated points, dense fall back");
+
+  // same kernel with a second, constant coordinate: generic algorithm
+  CaseStudy twoDimensions = cas;
+  twoDimensions.d = 2;
+  twoDimensions.X = arma::join_rows(cas.X, arma::zeros<arma::vec>(cas.n));
+  twoDimensions.x = arma::join_rows(cas.x, arma::zeros<arma::vec>(cas.q));
+  twoDimensions.param = arma::vec("1 1"); twoDimensions.param(0) = cas.param(0);
+  assertSameAsReference(test, cas, twoDimensions, Rcpp::IntegerVector {0}, 0.0, "", [&](const Output& outMarkov, const Output& outGeneric, const std::string& tag) {
+    test.assertCloseValues(outMarkov.KMofPoint(0), outGeneric.KMofPoint(0), "Algo KM"+tag);
+  });
+  return test;
+}
+
+template <int StateDimension>
+void checkStateSpaceMatern(Test& test, const std::string& covType) {
+  CaseStudy cas(5, covType);
+  cas.d = 1;
+  cas.X = arma::mat(cas.X.col(0)); cas.x = arma::mat(cas.x.col(0));
+  cas.param = arma::vec(cas.param.head(1))*0.3; // smooth kernels on dense 1-D designs are ill-conditioned
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  test.assertTrue(covParams.markovStateDimension()==StateDimension, covType + " state dimension");
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  arma::vec nuggetValues = arma::linspace<arma::vec>(0.0, 0.1, cas.n);
+  NuggetVector noNugget{}, nugget = nuggetValues;
+  for(const NuggetVector& nuggetCase : {noNugget, nugget}) {
+    const std::string tag = covType + ((nuggetCase.size()==0)?" no nugget":" nugget");
+    arma::mat K, k;
+    kernel.fillCorrMatrix(K, pointsX, nuggetCase);
+    kernel.fillCrossCorrelations(k, pointsX, pointsx);
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, pointsX, nuggetCase, 1);
+    arma::mat weightsDense, weightsKalman = k;
+    ChosenSolver::findWeights(K, k, weightsDense);
+    StateSpaceMaternFactorization<StateDimension> factorization(Kop);
+    factorization.solve(weightsKalman);
+    test.assertTrue(!factorization.usesDenseFallBack(), "Kalman filter used " + tag);
+    test.assertTrue(arma::norm(weightsKalman-weightsDense) <= 1e-6*arma::norm(weightsDense), "weights " + tag);
+    test.assertTrue(arma::norm(K*weightsKalman-k) <= 1e-12*arma::norm(k), "residual " + tag);
+  }
+  CaseStudy duplicated = cas;
+  duplicated.X.row(1) = duplicated.X.row(0);
+  Points pointsDuplicated(duplicated.X, covParams);
+  arma::mat KDuplicated, kDuplicated;
+  kernel.fillCorrMatrix(KDuplicated, pointsDuplicated, nugget);
+  kernel.fillCrossCorrelations(kDuplicated, pointsDuplicated, pointsx);
+  KernelOperator KopDuplicated(cas.n, cas.n);
+  KopDuplicated.bind(kernel, pointsDuplicated, nugget, 1);
+  StateSpaceMaternFactorization<StateDimension> duplicatedFactorization(KopDuplicated);
+  arma::mat weightsDuplicated = kDuplicated;
+  duplicatedFactorization.solve(weightsDuplicated);
+  test.assertTrue(duplicatedFactorization.usesDenseFallBack(), covType + " duplicated points, dense fall back");
+  test.assertTrue(arma::norm(KDuplicated*weightsDuplicated-kDuplicated) <= 1e-10*arma::norm(kDuplicated), covType + " duplicated points residual");
+  // same kernel with a second, constant coordinate: generic algorithm
+  CaseStudy twoDimensions = cas;
+  twoDimensions.d = 2;
+  twoDimensions.X = arma::join_rows(cas.X, arma::zeros<arma::vec>(cas.n));
+  twoDimensions.x = arma::join_rows(cas.x, arma::zeros<arma::vec>(cas.q));
+  twoDimensions.param = arma::vec("1 1"); twoDimensions.param(0) = cas.param(0);
+  assertSameAsReference(test, cas, twoDimensions, covType);
+}
+
+Test testStateSpaceMatern() {
+  Test test("II_ Kalman filter solver for one-dimensional Matern kernels (markovSolver.h)");
+  test.setPrecision(1e-6);
+  checkStateSpaceMatern<2>(test, "matern3_2");
+  checkStateSpaceMatern<3>(test, "matern5_2");
+  return test;
+}
+
+CaseStudy griddedCase(const std::string& covType) {
+  // group 0: 6 x 5 grid, group 1: 4 x 4 grid, group 2: scattered points, prediction points: 3 x 3 grid
+  CaseStudy cas(6, covType);
+  std::vector<arma::vec> axes0 {arma::vec("0 0.7 1.5 2.1 3.0 3.3"), arma::vec("0 1 2 3 4")};
+  std::vector<arma::vec> axes1 {arma::vec("5 5.5 6.5 7"), arma::vec("0.5 1.5 2.5 3.5")};
+  std::vector<arma::vec> axesx {arma::vec("1 4 6"), arma::vec("0.2 1.7 3.1")};
+  auto gridPoints = [](const std::vector<arma::vec>& axes) {
+    arma::mat points(axes[0].n_elem*axes[1].n_elem, 2);
+    Long row = 0;
+    for(Long j=0; j<axes[1].n_elem; ++j)
+      for(Long i=0; i<axes[0].n_elem; ++i) { points(row,0) = axes[0][i]; points(row,1) = axes[1][j]; ++row; }
+    return points;
+  };
+  arma::mat scattered("0.3 4.6; 2.7 5.1; 4.2 0.9; 5.9 4.4; 7.7 2.2; 1.1 5.8");
+  cas.X = arma::join_cols(arma::join_cols(gridPoints(axes0), gridPoints(axes1)), scattered);
+  cas.X = arma::shift(cas.X, 7, 0); // points are not given in grid order
+  cas.x = gridPoints(axesx);
+  cas.d = 2; cas.n = cas.X.n_rows; cas.q = cas.x.n_rows; cas.N = 3; cas.pickx = 0;
+  cas.param = arma::vec("1.2 0.9"); cas.sd2 = 2.0;
+  cas.Y = arma::sin(cas.X.col(0)) + arma::cos(cas.X.col(1));
+  cas.gp.resize(cas.n);
+  for(Long obs=0; obs<cas.n; ++obs) {
+    const Long originalRow = (obs + cas.n - 7)%cas.n;
+    cas.gp[obs] = (originalRow<30)?0:((originalRow<46)?1:2);
+  }
+  return cas;
+}
+
+Test testKroneckerGrid() {
+  Test test("II_ Kronecker products for gridded designs (kroneckerGrid.h)");
+  test.setPrecision(1e-7);
+  for(std::string covType : {"exp", "matern5_2", "gauss"}) {
+    CaseStudy cas = griddedCase(covType);
+    CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+    Covariance kernel(covParams);
+    Splitter splitter(cas.gp);
+    std::vector<arma::mat> splittedX;
+    splitter.split<arma::mat>(cas.X, splittedX);
+    Points points0(splittedX[0], covParams), points1(splittedX[1], covParams), points2(splittedX[2], covParams);
+    Points pointsx(cas.x, covParams);
+    GridStructure grid0(points0), grid1(points1), grid2(points2), gridx(pointsx);
+    test.assertTrue(grid0.valid() && grid0.hasSeveralAxes() && grid1.valid() && gridx.valid(), covType + " grids detected");
+    test.assertTrue(!grid2.valid(), covType + " scattered points are not a grid");
+
+    NuggetVector nugget {0.01};
+    arma::mat K, k, k01, kdirect(points0.size(), pointsx.size());
+    kernel.fillCorrMatrix(K, points0, nugget);
+    kernel.fillCrossCorrelations(k, points0, pointsx);
+    kernel.fillCrossCorrelations(k01, points0, points1);
+    KroneckerGrid::fillAllocatedCrossCorrelations(kdirect, kernel, grid0, gridx);
+    test.assertCloseValues(kdirect, k, covType + " Kronecker cross-correlations");
+    arma::mat W(points1.size(), 3);
+    W.imbue(Rng(2));
+    test.assertCloseValues(KroneckerGrid::crossCorrelationsTimes(kernel, grid0, grid1, W), k01*W, covType + " Kronecker products");
+
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, points0, nugget, 1);
+    arma::mat weightsDense, weightsKronecker = k;
+    ChosenSolver::findWeights(K, k, weightsDense);
+    KroneckerFactorization factorization(Kop);
+    factorization.solve(weightsKronecker);
+    test.assertTrue(!factorization.usesDenseFallBack(), covType + " eigendecompositions used");
+    test.assertTrue(arma::norm(K*weightsKronecker-k) <= 1e-10*arma::norm(k), covType + " residual");
+
+    // reference: same design, with one point moved by 1e-12 in each grid so that no grid is detected
+    CaseStudy perturbed = cas;
+    for(Long obs=0; obs<cas.n; ++obs) if ((cas.gp[obs]<2) && (obs%9==0)) perturbed.X(obs,0) += 1e-12;
+    perturbed.x(0,0) += 1e-12;
+    assertSameAsReference(test, cas, perturbed, covType);
+  }
+  return test;
+}
+
+Test testCompactSupport() {
+  Test test("II_ Sparse banded factorization for compactly supported kernels (compactSupport.h)");
+  test.setPrecision(1e-7);
+  for(std::string covType : {"wendland1", "wendland2", "exp_tapered", "matern5_2_tapered"}) {
+    CaseStudy cas(7, covType, 3);
+    cas.param = cas.param*0.3;
+    for(Long m=0; m<cas.q; ++m) cas.x.row(m) = cas.X.row((5*m)%cas.n) + 0.02;
+    cas.x.row(cas.q-1) += 100.0; // far from all observations: vanishing submodels
+    // groups are slabs along the first coordinate, so that far away groups have zero cross-correlations
+    const arma::uvec sorted = arma::sort_index(cas.X.col(0));
+    for(Long rank=0; rank<cas.n; ++rank) cas.gp[sorted[rank]] = 1 + (rank*cas.N)/cas.n;
+    CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+    test.assertTrue(covParams.hasCompactSupport(), covType + " compact support detected");
+    Covariance kernel(covParams);
+    Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+    NuggetVector nugget {0.01};
+    arma::mat K, k;
+    kernel.fillCorrMatrix(K, pointsX, nugget);
+    kernel.fillCrossCorrelations(k, pointsX, pointsx);
+
+    arma::mat visited(cas.n, cas.n, arma::fill::zeros);
+    NeighbourSearch::forEachPairWithinRadius(pointsX, pointsX, kernel.supportRadius(), [&](Long a, Long b) { visited(a,b) += 1; });
+    bool allNonZerosVisited = true, visitedOnce = true;
+    for(Long j=0; j<cas.n; ++j)
+      for(Long i=0; i<cas.n; ++i) {
+        if ((K(i,j)!=0.0) && (visited(i,j)==0)) allNonZerosVisited = false;
+        if (visited(i,j)>1) visitedOnce = false;
+      }
+    test.assertTrue(allNonZerosVisited && visitedOnce, covType + " neighbour search finds all nonzero correlations");
+    test.assertTrue(arma::accu(visited) < cas.n*cas.n, covType + " correlation matrix is sparse");
+
+    KernelOperator Kop(K.n_rows, K.n_cols);
+    Kop.bind(kernel, pointsX, nugget, 1);
+    arma::mat weightsDense, weightsBanded = k;
+    ChosenSolver::findWeights(K, k, weightsDense);
+    BandedCholeskyFactorization factorization(Kop);
+    factorization.solve(weightsBanded);
+    test.assertTrue(factorization.bandwidth() < cas.n-1, covType + " band narrower than the matrix");
+    test.assertTrue(arma::norm(weightsBanded-weightsDense) <= 1e-8*arma::norm(weightsDense), covType + " weights");
+    test.assertTrue(arma::norm(K*weightsBanded-k) <= 1e-10*arma::norm(k), covType + " residual");
+
+    Splitter splitter(cas.gp);
+    std::vector<arma::mat> splittedX;
+    splitter.split<arma::mat>(cas.X, splittedX);
+    Points pointsFirst(splittedX.front(), covParams), pointsLast(splittedX.back(), covParams);
+    arma::mat W(pointsLast.size(), 3), kFirstLast;
+    W.imbue(Rng(3));
+    kernel.fillCrossCorrelations(kFirstLast, pointsFirst, pointsLast);
+    test.assertCloseValues(NeighbourSearch::crossCorrelationsTimes(kernel, pointsFirst, pointsLast, W), kFirstLast*W, covType + " sparse cross products");
+    arma::mat shiftedX = splittedX.back();
+    shiftedX.col(0) += 100.0*cas.param(0);
+    Points pointsShifted(shiftedX, covParams);
+    test.assertTrue(NeighbourSearch::farApart(pointsFirst, pointsShifted, kernel.supportRadius()), covType + " far apart groups detected");
+    test.assertTrue(arma::norm(NeighbourSearch::crossCorrelationsTimes(kernel, pointsFirst, pointsShifted, W))==0.0, covType + " far apart groups, zero products");
+
+    // Algo: KM from the submodel weights alpha, some pairs of groups are skipped in partB
+    for(bool ordinaryKriging : {false, true}) {
+      std::string tag = covType + (ordinaryKriging?" OK":" SK");
+      cas.ordinaryKriging = ordinaryKriging;
+      Output out = getDetailedOutput(cas, 2);
+      arma::mat expectedKM(cas.N, cas.N);
+      const Long m = cas.pickx;
+      for(Long i=0; i<cas.N; ++i)
+        for(Long j=0; j<cas.N; ++j) {
+          arma::mat Kij;
+          kernel.fillCrossCorrelations(Kij, Points(splittedX[i], covParams), Points(splittedX[j], covParams));
+          expectedKM(i,j) = (i==j) ? out.KMofPoint(m)(i,i) : arma::as_scalar(out.alpha[i].col(m).t() * Kij * out.alpha[j].col(m));
+        }
+      test.assertCloseValues(out.KMofPoint(m), expectedKM, "Algo KM "+tag);
+    }
+    CaseStudy oneGroup = cas;
+    oneGroup.N = 1;
+    for(Long obs=0; obs<oneGroup.n; ++obs) oneGroup.gp[obs] = 1;
+    oneGroup.ordinaryKriging = false;
+    Output out = getDetailedOutput(oneGroup, 2);
+    arma::mat K0, weights0;
+    kernel.fillCorrMatrix(K0, pointsX, NuggetVector{0.0});
+    ChosenSolver::findWeights(K0, k, weights0);
+    test.assertCloseValues(out.predmean, arma::vec(weights0.t()*cas.Y), "Algo one group, simple Kriging mean " + covType);
+    test.assertCloseValues(out.predsd2, arma::vec(cas.sd2*(1-arma::sum(weights0 % k).t())), "Algo one group, simple Kriging variance " + covType);
+  }
+  return test;
+}
+
+double counterValue(const Output& out, const std::string& name) {
+  const std::vector<std::string>& names = out.chronoReport.counterNames;
+  const Long position = std::find(names.begin(), names.end(), name) - names.begin();
+  return (position<names.size()) ? out.chronoReport.counterValues[position] : std::numeric_limits<double>::quiet_NaN();
+}
+
+Test testRandomFeatures() {
+  Test test("II_ Random Fourier features approximate inter-group covariances (randomFeatures.h)");
+  for(std::string covType : {"gauss", "exp", "matern3_2", "matern5_2"}) {
+    CaseStudy cas(2, covType);
+    CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+    test.assertTrue(SpectralDensity(covParams).available(), covType + " spectral density available");
+    Covariance kernel(covParams);
+    Points pointsX(cas.X, covParams);
+    arma::mat K;
+    kernel.fillCorrMatrix(K, pointsX, NuggetVector{});
+    double previousError = 1.0;
+    for(Long D : {Long(50), Long(20000)}) {
+      const arma::mat phi = RandomFourierFeatures(covParams, cas.d, D).features(pointsX);
+      const double error = arma::abs(phi*phi.t() - K).max();
+      test.assertTrue(error<previousError, covType + " error decreases with D=" + std::to_string(D));
+      previousError = error;
+    }
+    test.assertTrue(previousError<0.05, covType + " correlations approximated with 20000 features");
+
+    Output outExact = getDetailedOutput(cas, 2);
+    Output outFeatures = getDetailedOutput(cas, 2, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 20000});
+    const double scale = arma::abs(outExact.KMofPoint(0)).max();
+    test.assertTrue(arma::abs(outFeatures.KMofPoint(0) - outExact.KMofPoint(0)).max() < 0.05*scale, covType + " Algo KM approximated");
+    test.assertTrue(arma::norm(arma::diagvec(outFeatures.KMofPoint(0) - outExact.KMofPoint(0)))==0.0, covType + " Algo KM diagonal is exact");
+    test.assertClose(counterValue(outFeatures, "partB.rffFeatures"), 20000, covType + " features reported");
+    test.assertTrue(counterValue(outFeatures, "partB.rffSampledPairs")==std::min<Long>(32, cas.N*(cas.N-1)/2), covType + " sampled pairs reported");
+    test.assertTrue(counterValue(outFeatures, "partB.rffMaxRelativeError")<0.05, covType + " sampled errors reported");
+  }
+  CaseStudy powexpCase(2, "powexp");
+  powexpCase.param = arma::join_cols(powexpCase.param, arma::ones<arma::vec>(powexpCase.d)*1.5);
+  Output outExact = getDetailedOutput(powexpCase, 2);
+  Output outFeatures = getDetailedOutput(powexpCase, 2, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 100});
+  test.assertCloseValues(outFeatures.predmean, outExact.predmean, "powexp, no spectral density: exact partB");
+  test.assertTrue(std::isnan(counterValue(outFeatures, "partB.rffFeatures")), "powexp, no random features counter");
+  return test;
+}
+
+void krigingReference(const CaseStudy& cas, arma::vec& mean, arma::vec& sd2) {
+  // simple or ordinary Kriging with all observations, dense
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams), pointsx(cas.x, covParams);
+  arma::mat K, k;
+  kernel.fillCorrMatrix(K, pointsX, NuggetVector{});
+  kernel.fillCrossCorrelations(k, pointsX, pointsx);
+  const arma::vec ones = arma::ones<arma::vec>(cas.n);
+  const arma::mat Kinvk = arma::solve(K, k), KinvY = arma::solve(K, cas.Y), KinvOne = arma::solve(K, ones);
+  const double beta = cas.ordinaryKriging ? arma::dot(ones, KinvY)/arma::dot(ones, KinvOne) : 0.0;
+  mean = beta + Kinvk.t()*(cas.Y - beta*ones);
+  sd2 = cas.sd2*(1 - arma::sum(Kinvk % k).t());
+  if (cas.ordinaryKriging) {
+    const arma::vec t = 1 - Kinvk.t()*ones;
+    sd2 += cas.sd2*(t % t)/arma::dot(ones, KinvOne);
+  }
+}
+
+Test testInducingPoints() {
+  Test test("II_ FITC and PITC inducing points alternatives (inducingPoints.h)");
+  const Rcpp::IntegerVector oneByGroup {0, 1, 1, 0, 0, 0, 0, 1}, allPoints {0, 1, 1, 0, 0, 0, 0, 100000};
+  auto closeTo = [](const arma::vec& value, const arma::vec& reference) {
+    return arma::norm(value-reference) <= 1e-5*(1+arma::norm(reference));
+  };
+  for(std::string covType : {"exp", "matern5_2"}) {
+    CaseStudy cas(3, covType);
+    for(Long m=0; m<cas.q; ++m) cas.x.row(m) = cas.X.row((3*m)%cas.n) + 0.1;
+    for(bool ordinaryKriging : {false, true}) {
+      std::string tag = covType + (ordinaryKriging?" OK":" SK");
+      cas.ordinaryKriging = ordinaryKriging;
+      arma::vec meanKriging, sd2Kriging;
+      krigingReference(cas, meanKriging, sd2Kriging);
+      test.assertTrue(getDetailedOutput(cas, -3).meanPITC.size()==0, "no inducing points by default " + tag);
+
+      // all observations as inducing points: Q = K, FITC and PITC are Kriging
+      const Output outAll = getDetailedOutput(cas, -3, allPoints);
+      test.assertClose(counterValue(outAll, "partF.inducingPoints"), cas.n, "inducing points reported " + tag);
+      test.assertTrue(closeTo(outAll.meanFITC, meanKriging), "all points, FITC mean " + tag);
+      test.assertTrue(closeTo(outAll.meanPITC, meanKriging), "all points, PITC mean " + tag);
+      test.assertTrue(closeTo(outAll.sd2FITC, sd2Kriging), "all points, FITC sd2 " + tag);
+      test.assertTrue(closeTo(outAll.sd2PITC, sd2Kriging), "all points, PITC sd2 " + tag);
+
+      const Output outCentroids = getDetailedOutput(cas, -3, oneByGroup);
+      test.assertClose(counterValue(outCentroids, "partF.inducingPoints"), cas.N, "one centroid by group " + tag);
+      test.assertTrue(outCentroids.sd2FITC.min()>=0.0 && outCentroids.sd2PITC.min()>=0.0, "centroids, nonnegative variances " + tag);
+      test.assertTrue(outCentroids.meanFITC.is_finite() && outCentroids.meanPITC.is_finite(), "centroids, finite means " + tag);
+      test.assertCloseValues(outCentroids.predmean, outAll.predmean, "nested Kriging unchanged " + tag);
+    }
+  }
+  return test;
+}
+
+Test testVecchia() {
+  Test test("II_ Vecchia nearest neighbour engine (vecchia.h)");
+  auto closeTo = [](const arma::vec& value, const arma::vec& reference) {
+    return arma::norm(value-reference) <= 1e-6*(1+arma::norm(reference));
+  };
+  CaseStudy cas(3, "matern5_2", 3);
+  CovarianceParameters covParams(cas.d, cas.param, cas.sd2, cas.covType);
+  Covariance kernel(covParams);
+  Points pointsX(cas.X, covParams);
+
+  // k-d tree, restricted to previous ranks, against brute force
+  std::vector<Long> rank(cas.n);
+  for(Long i=0; i<cas.n; ++i) rank[i] = (7*i)%cas.n;
+  KdTree tree(pointsX, rank);
+  bool sameNeighbours = true;
+  for(Long i=0; i<cas.n; ++i) {
+    std::vector<std::pair<double, Long> > brute{};
+    for(Long j=0; j<cas.n; ++j) if (rank[j]<rank[i]) {
+      double distance2 = 0.0;
+      for(PointDimension k=0; k<cas.d; ++k) distance2 += (pointsX[i][k]-pointsX[j][k])*(pointsX[i][k]-pointsX[j][k]);
+      brute.push_back(std::make_pair(distance2, j));
+    }
+    std::sort(brute.begin(), brute.end());
+    const std::vector<Long> found = tree.nearest(pointsX[i], 5, rank[i]);
+    sameNeighbours = sameNeighbours && (found.size()==std::min<Long>(5, brute.size()));
+    for(Long r=0; r<found.size() && sameNeighbours; ++r) sameNeighbours = (found[r]==brute[r].second);
+  }
+  test.assertTrue(sameNeighbours, "k-d tree nearest previous neighbours");
+
+  for(bool ordinaryKriging : {false, true}) {
+    const std::string tag = ordinaryKriging?" OK":" SK";
+    cas.ordinaryKriging = ordinaryKriging;
+    arma::vec meanKriging, sd2Kriging;
+    krigingReference(cas, meanKriging, sd2Kriging);
+    // exact Gaussian log-likelihood, at the GLS mean for ordinary Kriging
+    arma::mat K;
+    kernel.fillCorrMatrix(K, pointsX, NuggetVector{});
+    const arma::vec ones = arma::ones<arma::vec>(cas.n);
+    const double beta = ordinaryKriging ? arma::dot(ones, arma::solve(K, cas.Y))/arma::dot(ones, arma::solve(K, ones)) : 0.0;
+    const arma::vec residual = cas.Y - beta*ones;
+    const arma::mat R = arma::chol(K);
+    double logDetK = 0.0;
+    for(Long i=0; i<cas.n; ++i) logDetK += 2*std::log(R.at(i,i));
+    const double pi = 3.141592653589793;
+    const double logLikelihood = -0.5*(cas.n*std::log(2*pi*cas.sd2) + logDetK + arma::dot(residual, arma::solve(K, residual))/cas.sd2);
+
+    // all previous points as neighbours: exact Kriging and exact likelihood
+    const arma::vec noNugget = Rcpp::NumericVector::create(0.0);
+    Rcpp::List outExact = vecchia_kriging(cas.X, cas.Y, cas.x, cas.covType, cas.param, cas.sd2, ordinaryKriging, "", 2, 0, noNugget, cas.n);
+    const arma::vec meanExact = outExact["mean"], sd2Exact = outExact["sd2"];
+    const double logLikelihoodExact = outExact["logLikelihood"];
+    test.assertTrue(closeTo(meanExact, meanKriging), "all neighbours, Kriging mean" + tag);
+    test.assertTrue(closeTo(sd2Exact, sd2Kriging), "all neighbours, Kriging sd2" + tag);
+    test.assertClose(logLikelihoodExact, logLikelihood, "all neighbours, exact log-likelihood" + tag);
+
+    Rcpp::List outFew = vecchia_kriging(cas.X, cas.Y, cas.x, cas.covType, cas.param, cas.sd2, ordinaryKriging, "", 2, 0, noNugget, 5);
+    const arma::vec meanFew = outFew["mean"], sd2Few = outFew["sd2"];
+    const double logLikelihoodFew = outFew["logLikelihood"];
+    test.assertTrue(meanFew.is_finite() && std::isfinite(logLikelihoodFew), "few neighbours, finite results" + tag);
+    test.assertTrue(sd2Few.min()>=0.0, "few neighbours, nonnegative variances" + tag);
+    // simple Kriging on a subset of the observations cannot have a lower variance
+    if (!ordinaryKriging) test.assertTrue((sd2Few - sd2Kriging).min()>=-1e-10, "few neighbours, variances not below Kriging" + tag);
+  }
+  return test;
+}
+
+Test testHierarchicalMatrices() {
+  Test test("II_ HODLR submodels and low-rank partB blocks (hierarchicalMatrix.h)");
+  const arma::vec param = arma::ones<arma::vec>(2)*0.4;
+  CovarianceParameters covParams(2, param, 1.0, "matern5_2");
+  Covariance kernel(covParams);
+  const Long n = 400;
+  arma::mat X(n, 2);
+  // points along a curve: adjacent halves of a node are well separated
+  for(Long i=0; i<n; ++i) { X(i,0) = std::fmod(i*0.6180339887, 1.0)*3; X(i,1) = 0.3*std::sin(3*X(i,0)) + 0.02*std::fmod(i*0.4142135624, 1.0); }
+  Points pointsX(X, covParams);
+  NuggetVector nugget {0.01};
+  arma::mat K;
+  kernel.fillCorrMatrix(K, pointsX, nugget);
+  const arma::mat rhs = K.cols(0, 2);
+  for(double tolerance : {1e-4, 1e-10}) {
+    const std::string tag = ", tolerance " + std::to_string(tolerance);
+    CompressibleKernelOperator Kop(n, n);
+    Kop.bind(kernel, pointsX, nugget, 1);
+    HierarchicalMatrix hodlr(Kop, tolerance);
+    arma::mat solution = rhs;
+    hodlr.solve(solution);
+    test.assertTrue(arma::norm(K*solution-rhs, "fro") <= tolerance*1e3*arma::norm(rhs, "fro"), "HODLR solve residual" + tag);
+    test.assertTrue(hodlr.statistics().compressedBlocks>=6, "HODLR blocks" + tag);
+    test.assertTrue(hodlr.statistics().maxRank<n/4, "HODLR ranks capped" + tag);
+  }
+  {
+    CompressibleKernelOperator Kop(n, n);
+    Kop.bind(kernel, pointsX, nugget, 1);
+    HierarchicalMatrix hodlr(Kop, 1e-4);
+    test.assertTrue((hodlr.statistics().denseFallBacks==0) && (hodlr.statistics().maxRank<n/8), "HODLR low ranks, no dense fall back");
+  }
+
+  // points filling a square: adjacent halves share a long boundary, blocks are not of low rank near the leaves
+  arma::mat Xsquare(n, 2);
+  for(Long i=0; i<n; ++i) { Xsquare(i,0) = std::fmod(i*0.6180339887, 1.0)*3; Xsquare(i,1) = std::fmod(i*0.4142135624, 1.0)*3; }
+  Points pointsSquare(Xsquare, covParams);
+  arma::mat Ksquare;
+  kernel.fillCorrMatrix(Ksquare, pointsSquare, nugget);
+  for(double tolerance : {1e-4, 1e-10}) {
+    const std::string tag = ", tolerance " + std::to_string(tolerance);
+    CompressibleKernelOperator Kop(n, n);
+    Kop.bind(kernel, pointsSquare, nugget, 1);
+    HierarchicalMatrix hodlr(Kop, tolerance);
+    arma::mat solution = Ksquare.cols(0, 2);
+    hodlr.solve(solution);
+    test.assertTrue(arma::norm(Ksquare*solution-Ksquare.cols(0, 2), "fro") <= tolerance*1e3*arma::norm(Ksquare.cols(0, 2), "fro"), "HODLR fall back residual" + tag);
+    test.assertTrue(hodlr.statistics().denseFallBacks>0, "dense fall backs counted" + tag);
+  }
+
+  // sets separated along all coordinates: low rank cross-correlations
+  arma::mat Xfar = X.rows(0, 299) + 6;
+  Points pointsFar(Xfar, covParams);
+  arma::mat Kfar;
+  kernel.fillCrossCorrelations(Kfar, pointsX, pointsFar);
+  const AdaptiveCrossApproximation aca(n, 300, [&](Long a, Long b) { return kernel.crossCorrelation(pointsX, a, pointsFar, b); }, 1e-10, 100);
+  test.assertTrue(aca.converged && (aca.rank()<100), "ACA converged with low rank");
+  test.assertTrue(arma::norm(aca.U*aca.V.t()-Kfar, "fro") <= 1e-8*arma::norm(Kfar, "fro"), "ACA accuracy");
+  const AdaptiveCrossApproximation acaCapped(n, 300, [&](Long a, Long b) { return kernel.crossCorrelation(pointsX, a, pointsFar, b); }, 1e-10, 2);
+  test.assertTrue((!acaCapped.converged) && (acaCapped.rank()==2), "ACA stops at maxRank");
+
+  // Algo, two groups separated along both coordinates (tensor product kernel: low rank Kij), without nugget:
+  // predictions within 1e-5 of the dense ones, the conditioning of Ki amplifies the tolerance 1e-9 of the solver
+  CaseStudy cas(3, "matern5_2");
+  cas.X = X; cas.n = n; cas.d = 2; cas.param = param;
+  cas.gp.resize(n);
+  for(Long i=0; i<n; ++i) {
+    cas.gp[i] = (i<n/2) ? 1 : 2;
+    if (i>=n/2) cas.X.row(i) += 3.4;
+  }
+  cas.Y = arma::sin(cas.X.col(0)) + cas.X.col(1);
+  cas.x = cas.X.rows(n/2-5, n/2+4) + 0.05;
+  assertSameAsDense(test, cas, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 9}, 1e-5, "", [&](const Output& outHierarchical, const Output& outDense, const std::string& tag) {
+    test.assertTrue(counterValue(outHierarchical, "partA.hodlrCompressedBlocks")>=2, "partA compressed blocks reported" + tag);
+    test.assertClose(counterValue(outHierarchical, "partB.acaCompressedBlocks"), 1, "partB compressed block reported" + tag);
+    test.assertTrue(std::isnan(counterValue(outDense, "partA.hodlrCompressedBlocks")), "no compression by default" + tag);
+    test.assertTrue(!(counterValue(outHierarchical, "partA.hodlrDenseFallBacks")>0), "no dense fall back on curves" + tag);
+  });
+  return test;
+}
+
+Test testTrace() {
+  Test test("II_ Execution trace of submodels, pairs and solves (trace.h)");
+  CaseStudy cas(2, "gauss");
+  const Long N = cas.N, q = cas.x.n_rows;
+  Output outDefault = getDetailedOutput(cas, 0);
+  test.assertTrue((!outDefault.traced) && outDefault.traceEvents.empty(), "no trace by default");
+  test.assertTrue(std::isnan(counterValue(outDefault, "trace.events")), "no trace counter by default");
+
+  Output outTraced = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 100000});
+  test.assertCloseValues(outTraced.predmean, outDefault.predmean, "tracing does not change predictions");
+  Long submodels = 0, pairs = 0, solves = 0, phases = 0;
+  for(const TraceEvent& event: outTraced.traceEvents) {
+    const std::string name = event.name;
+    submodels += (name=="submodel"); pairs += (name=="pair"); solves += (name=="solve"); phases += (name=="partA");
+    if (name=="pair") test.assertTrue(event.item1<event.item2, "pairs i<j");
+  }
+  test.assertClose(submodels, N, "one event by submodel");
+  test.assertClose(pairs, N*(N-1)/2, "one event by pair");
+  test.assertClose(solves, q, "one event by solve");
+  test.assertClose(phases, 1, "one partA phase");
+  test.assertClose(counterValue(outTraced, "trace.events"), outTraced.traceEvents.size(), "events counter");
+  test.assertClose(counterValue(outTraced, "trace.droppedEvents"), 0, "no dropped event");
+  const std::string json = ChromeTrace::json(outTraced.traceEvents, outTraced.droppedTraceEvents);
+  test.assertTrue(json.find("\"traceEvents\":[")!=std::string::npos, "Chrome trace format");
+  test.assertTrue(json.find("\"name\":\"pair\"")!=std::string::npos, "pairs exported");
+
+  // ring buffer: the last events are kept
+  Tracer tracer(4, 1);
+  for(long i=0; i<10; ++i) TraceScope scope(tracer, "partA", "submodel", i);
+  const std::vector<TraceEvent> kept = tracer.events();
+  test.assertClose(kept.size(), 4, "ring buffer capacity");
+  test.assertClose(tracer.droppedEvents(), 6, "overwritten events counted");
+  test.assertClose(kept.front().item1, 6, "oldest kept event");
+  test.assertTrue(!Tracer::off().enabled(), "disabled tracer");
+
+  // threads idle at the end of a phase get a wait event
+  std::vector<TraceEvent> events(2);
+  events[0].category = "phase"; events[0].name = "partA"; events[0].start = 0; events[0].duration = 10;
+  events[1].category = "partA"; events[1].name = "submodel"; events[1].start = 1; events[1].duration = 4; events[1].thread = 1;
+  const std::vector<TraceEvent> withWaits = ChromeTrace::withWaits(events);
+  test.assertClose(withWaits.size(), 3, "one wait event");
+  test.assertClose(withWaits.back().start, 5, "wait start");
+  test.assertClose(withWaits.back().duration, 5, "wait duration");
+  return test;
+}
+
+Test testWorkload() {
+  Test test("II_ Analytic workload and throughput of each step (workload.h)");
+  test.assertClose(WorkloadModel::cholesky(30).flops, 9000, "Cholesky flops");
+  test.assertClose(WorkloadModel::product(2, 3, 4).flops, 48, "product flops");
+  test.assertClose(WorkloadModel::product(2, 3, 4).bytes, 8*(8+12+6), "product bytes");
+  test.assertClose(WorkloadModel::kernelMatrix(10, 10, 2, true).kernelEvaluations, 55, "symmetric kernel matrix evaluations");
+  const NestedKrigingWorkload model(std::vector<Long>{10, 20}, 5, 2, false);
+  test.assertClose(model.partB(false).kernelEvaluations, 200, "partB evaluations, pairs i<j");
+  test.assertClose(model.partB(true).kernelEvaluations, 700, "partB evaluations with cross-cov, pairs i<=j");
+  test.assertClose(model.partA(false).kernelEvaluations, 55+210+150, "partA evaluations");
+  test.assertTrue(model.partA(true).flops>model.partA(false).flops, "partA cross-cov flops");
+
+  CaseStudy cas(3, "matern3_2");
+  Output out = getDetailedOutput(cas, 0);
+  const ChronoReport& report = out.chronoReport;
+  test.assertClose(report.workloads.size(), report.durations.size(), "one workload by step");
+  double expectedEvaluations = 0.0;
+  std::vector<Long> sizes(cas.N, 0);
+  for(Long k=0; k<cas.gp.size(); ++k) ++sizes[cas.gp[k]-1];
+  for(const Long ni: sizes) expectedEvaluations += ni*(ni+1)/2 + ni*cas.x.n_rows;
+  test.assertClose(report.workloads[0].kernelEvaluations, expectedEvaluations, "partA evaluations in Algo");
+  const std::vector<double> gflops = report.gigaflopsBySecond(), gbytes = report.gigabytesBySecond();
+  test.assertClose(gflops.size(), report.durations.size(), "one rate by step");
+  for(Long step=0; step<gflops.size(); ++step)
+    test.assertTrue(std::isfinite(gflops[step]) && (gflops[step]>=0) && std::isfinite(gbytes[step]), "finite rates " + report.stepNames[step]);
+
+  Output outIterative = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 1});
+  const ChronoReport& reportIterative = outIterative.chronoReport;
+  test.assertClose(reportIterative.workloads[0].flops, 0.0, "no dense counts for the iterative partA");
+  test.assertClose(reportIterative.gigaflopsBySecond()[0], 0.0, "no rate for the iterative partA");
+  test.assertClose(reportIterative.workloads[1].flops, report.workloads[1].flops, "dense partB counts kept");
+
+  ChronoReport fused;
+  fused.fuseParallelExecutionReports(std::vector<ChronoReport>{report, report});
+  test.assertClose(fused.workloads[0].flops, 2*report.workloads[0].flops, "zones workloads are summed");
+  return test;
+}
+
+Test testHardwareCounters() {
+  Test test("II_ Optional hardware performance counters (hardwareCounters.h)");
+  CaseStudy cas(2, "gauss");
+  Output outDefault = getDetailedOutput(cas, 0);
+  test.assertTrue(outDefault.hardwareCounterReport.stepNames.empty(), "no hardware counters by default");
+  test.assertTrue(std::isnan(counterValue(outDefault, "hardwareCounters.available")), "no availability counter by default");
+
+  {
+    // zones in a task pool: option disabled and reported
+    Parallelism poolParallelism;
+    poolParallelism.setThreadsNumber<Parallelism::innerContext>(2);
+    poolParallelism.enableTaskPool();
+    Splitter splitter(cas.gp);
+    Screen screen(-1);
+    GlobalOptions options(Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1});
+    LOOScheme looScheme{};
+    NuggetVector noNugget {0.0};
+    std::string tag="";
+    Algo algo(poolParallelism, cas.X, cas.Y, splitter, cas.x, cas.param, cas.sd2, cas.ordinaryKriging, cas.covType, tag,
+              -1, 0, noNugget, screen, options, looScheme);
+    const Output outPool = algo.output();
+    test.assertTrue(outPool.hardwareCounterReport.stepNames.empty(), "no hardware counters in a task pool");
+    test.assertClose(counterValue(outPool, "hardwareCounters.available"), 0.0, "unavailable in a task pool");
+    test.assertClose(counterValue(outPool, "hardwareCounters.disabledInTaskPool"), 1.0, "task pool reported");
+  }
+
+  {
+    // one group for 4 threads: nested fill threads are not counted, totals only
+    CaseStudy casNested = cas;
+    casNested.setGroupsN_equals_1();
+    const Output outNested = getDetailedOutput(casNested, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1});
+    const HardwareCounterReport& reportNested = outNested.hardwareCounterReport;
+    test.assertClose(counterValue(outNested, "hardwareCounters.totalsOnly"), 1.0, "totals only reported with nested threads");
+    bool onlyTotals = true;
+    for(const int thread: reportNested.threads) onlyTotals = onlyTotals && (thread==HardwareCounterReport::allThreads);
+    test.assertTrue(onlyTotals, "no per-thread rows with nested threads");
+    test.assertTrue(reportNested.stepNames.empty() || (reportNested.stepNames.size()==outNested.chronoReport.stepNames.size()),
+                    "one total row by step");
+  }
+
+  Output outCounted = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1});
+  test.assertCloseValues(outCounted.predmean, outDefault.predmean, "counters do not change predictions");
+  test.assertTrue(std::isnan(counterValue(outCounted, "hardwareCounters.totalsOnly")), "per-thread rows without nested threads");
+  const HardwareCounterReport& report = outCounted.hardwareCounterReport;
+  const double available = counterValue(outCounted, "hardwareCounters.available");
+  test.assertTrue((available==0) || (available==1), "availability reported");
+  if (available==0) {
+    // e.g. containers without perf events: graceful degradation
+    test.assertTrue(report.stepNames.empty(), "empty report when unavailable");
+    return test;
+  }
+  test.assertTrue(report.stepNames.size()>=outCounted.chronoReport.stepNames.size(), "at least one row by step");
+  test.assertClose(report.cycles.size(), report.stepNames.size(), "one value by row");
+  double instructionsOfThread0 = 0.0;
+  for(Long row=0; row<report.stepNames.size(); ++row)
+    if ((report.threads[row]==0) && (!std::isnan(report.instructions[row]))) instructionsOfThread0 += report.instructions[row];
+  test.assertTrue(std::isnan(report.instructions[0]) || (instructionsOfThread0>0), "calling thread instructions counted");
+  return test;
+}
+
+Test testMemoryPlan() {
+  Test test("II_ Projected and measured memory, dry run and budget (memoryPlan.h)");
+  const MemoryPlan plan(std::vector<Long>{10, 30, 20}, 60, 4, 2, 2, false, false);
+  test.assertTrue(plan.items.front()=="inputs" && plan.items.back()=="peak", "plan items");
+  test.assertClose(plan.projectedBytes[0], 8*(60*2+60+4*2), "inputs bytes");
+  test.assertClose(plan.projectedBytes[2], 8*(2*30*30+2*30*4 + 2*20*20+2*20*4), "partA bytes, two largest groups by two threads");
+  const MemoryPlan planWithCov(std::vector<Long>{10, 30, 20}, 60, 4, 2, 2, false, true);
+  test.assertClose(planWithCov.projectedBytes[1]-plan.projectedBytes[1], 8*(16*9+16*3+2*16), "cross-covariances results bytes");
+  bool refused = false;
+  try { plan.checkBudget(plan.projectedPeakBytes()/2); } catch(const std::exception&) { refused = true; }
+  test.assertTrue(refused, "budget exceeded");
+  plan.checkBudget(plan.projectedPeakBytes());
+  plan.checkBudget(0);
+
+  CaseStudy cas(2, "gauss");
+  Output out = getDetailedOutput(cas, 0);
+  test.assertTrue(out.memoryPlan.projectedPeakBytes()>0, "plan of a run");
+  const double measured = out.memoryPlan.measuredResidentBytes[out.memoryPlan.items.size()-1];
+  test.assertTrue(std::isnan(measured) || (measured>0), "measured peak");
+  bool peakIsLargestStep = true;
+  for(Long item=2; item+1<out.memoryPlan.items.size(); ++item) {
+    const double step = out.memoryPlan.measuredResidentBytes[item];
+    peakIsLargestStep = peakIsLargestStep && (std::isnan(step) || (step<=measured));
+  }
+  test.assertTrue(peakIsLargestStep, "peak is the largest sample of the steps");
+  Output outDry = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+  test.assertClose(outDry.memoryPlan.projectedPeakBytes(), out.memoryPlan.projectedPeakBytes(), "same plan in dry run");
+  test.assertTrue(outDry.predmean.empty() && outDry.chronoReport.stepNames.empty(), "nothing computed in dry run");
+  bool refusedRun = false;
+  try { getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1}); }
+  catch(const std::exception&) { refusedRun = true; }
+  test.assertTrue(refusedRun==(out.memoryPlan.projectedPeakBytes()>1048576), "run refused above budget");
+  return test;
+}
+
+Test testPlanner() {
+  Test test("II_ Cost model planner of clusters and threads (planner.h)");
+  const MachineCalibration calibration = MachineCalibration::measure("matern5_2", 2, 64, 1);
+  test.assertTrue(calibration.kernelEvaluationsBySecond>0 && calibration.flopsBySecond>0, "calibrated rates");
+  test.assertTrue(std::isfinite(calibration.kernelEvaluationsBySecond) && std::isfinite(calibration.flopsBySecond), "finite rates");
+
+  const MachineCalibration fixedRates(1e8, 1e9);
+  const Planner planner4(10000, 2, 1000, fixedRates, 4, 0, false, false, false);
+  const Planner planner8(10000, 2, 1000, fixedRates, 8, 0, false, false, false);
+  const std::vector<Long> sizes = Planner::equalGroupSizes(10001, 7);
+  test.assertTrue(std::accumulate(sizes.begin(), sizes.end(), static_cast<Long>(0))==10001 && sizes.front()-sizes.back()==1, "equal group sizes");
+  const std::vector<Long> counts = planner4.groupCounts();
+  test.assertTrue(counts.front()==1 && counts.back()<=10000/8 && counts.size()>10, "clusters candidates");
+  const PlanCandidate best4 = planner4.best(), best8 = planner8.best();
+  test.assertTrue(best4.groups>1 && best4.zones*best4.threads<=4, "recommended configuration");
+  test.assertTrue(best8.predictedSeconds<=best4.predictedSeconds, "more threads, not slower");
+  test.assertTrue(planner4.evaluate(Planner::equalGroupSizes(10000, 1), 1, 4).predictedSeconds>best4.predictedSeconds, "faster than Kriging");
+
+  double smallestBytes = best4.projectedPeakBytes;
+  for(const PlanCandidate& candidate: planner4.candidates()) smallestBytes = std::min(smallestBytes, candidate.projectedPeakBytes);
+  const double budget = (smallestBytes+best4.projectedPeakBytes)/2;
+  const PlanCandidate bestBudgeted = Planner(10000, 2, 1000, fixedRates, 4, budget, false, false, false).best();
+  test.assertTrue(bestBudgeted.projectedPeakBytes<=budget, "within budget");
+  test.assertTrue(bestBudgeted.predictedSeconds>=best4.predictedSeconds, "budget never gives a faster plan");
+  bool refused = false;
+  try { Planner(10000, 2, 1000, fixedRates, 4, 1.0, false, false, false).best(); }
+  catch(const std::exception&) { refused = true; }
+  test.assertTrue(refused, "no configuration within a tiny budget");
+  const Planner withAlternatives(10000, 2, 1000, fixedRates, 4, 0, false, true, false);
+  test.assertTrue(withAlternatives.zoneCounts().size()==1, "no zones with alternatives");
+
+  Parallelism parallelism;
+  parallelism.setThreadsNumber<Parallelism::innerContext>(0);
+  test.assertTrue(parallelism.getThreadsNumber<Parallelism::innerContext>()==Planner::availableCores(), "default threads number");
+
+  CaseStudy cas(2, "gauss");
+  Rcpp::List resu = launchOurAlgo(cas, 1, 4), resuPlanned = launchOurAlgo(cas, 0, 4);
+  arma::vec mean = resu["mean"], meanPlanned = resuPlanned["mean"];
+  test.assertCloseValues(mean, meanPlanned, "same predictions with planned threads");
+  return test;
+}
+
+Test testNumaPlacement() {
+  Test test("II_ NUMA placement of groups and pairs (numa.h)");
+  const std::vector<int> cpusBefore = NumaTopology::allowedCpus();
+  const Long N = 10;
+  std::vector<int> groupVisits(N, 0), pairVisits(N*N, 0), groupThreads(N, -1);
+  {
+    const NumaPlacement placement(true, 3);
+    test.assertTrue(placement.enabled()==!cpusBefore.empty(), "enabled when cpus are known");
+    test.assertTrue(placement.numberOfNodes()>=1 && placement.ownerOfGroup(7)==1, "owner threads");
+    placement.forEachGroup(N, [&](const Long i) {
+      ++groupVisits[i];
+      #if defined(_OPENMP)
+        groupThreads[i] = omp_get_thread_num();
+      #endif
+    });
+    placement.forEachPair(N, [&](const Long i, const Long j) { ++pairVisits[i*N+j]; });
+  }
+  bool eachGroupOnce = true, eachPairOnce = true;
+  for(Long i=0; i<N; ++i) eachGroupOnce = eachGroupOnce && (groupVisits[i]==1);
+  for(Long i=0; i<N; ++i) for(Long j=0; j<N; ++j) eachPairOnce = eachPairOnce && (pairVisits[i*N+j]==((i<j) ? 1 : 0));
+  test.assertTrue(eachGroupOnce, "each group once");
+  test.assertTrue(eachPairOnce, "each pair i<j once");
+  #if defined(_OPENMP)
+    if (!cpusBefore.empty()) test.assertTrue((groupThreads[4]==groupThreads[1]) || (groupThreads[4]==groupThreads[7]), "groups on their owner thread");
+  #endif
+  test.assertTrue(NumaTopology::allowedCpus()==cpusBefore, "affinity restored");
+  test.assertTrue(!NumaPlacement::off().enabled(), "placement off");
+  #if defined(_OPENMP)
+    if (cpusBefore.size()>=2) { // threads with their own masks (as with OMP_PLACES) get them back
+      std::vector<std::vector<int> > ownCpus(3), restoredCpus(3);
+      #pragma omp parallel num_threads(3)
+      {
+        const int t = omp_get_thread_num();
+        NumaTopology::bindCurrentThread(std::vector<int>{cpusBefore[(t+1) % cpusBefore.size()]});
+        ownCpus[t] = NumaTopology::allowedCpus();
+      }
+      { const NumaPlacement placement(true, 3); }
+      #pragma omp parallel num_threads(3)
+      {
+        const int t = omp_get_thread_num();
+        restoredCpus[t] = NumaTopology::allowedCpus();
+        NumaTopology::bindCurrentThread(cpusBefore);
+      }
+      test.assertTrue(restoredCpus==ownCpus, "affinity of each thread restored");
+    }
+  #endif
+
+  CaseStudy cas(2, "gauss");
+  Output out = getDetailedOutput(cas, 0);
+  Output outNuma = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+  test.assertCloseValues(out.predmean, outNuma.predmean, "same predictions");
+  test.assertCloseValues(out.predsd2, outNuma.predsd2, "same variances");
+  return test;
+}
+
+Test testShardedExecution() {
+  Test test("II_ sharded execution over ranks (distributed.h)");
+  const Long N = 30;
+  const PairDistribution distribution(N, 6);
+  std::vector<int> pairOwners(N*N, 0);
+  for(int rank=0; rank<6; ++rank)
+    for(const std::pair<Long, Long>& pair: distribution.pairsOfRank(rank)) ++pairOwners[pair.first*N+pair.second];
+  bool eachPairOnce = true, groupsAtHand = true;
+  Long largestNeed = 0;
+  for(Long i=0; i<N; ++i) for(Long j=0; j<N; ++j) eachPairOnce = eachPairOnce && (pairOwners[i*N+j]==((i<j) ? 1 : 0));
+  for(int rank=0; rank<6; ++rank) {
+    Long need = 0;
+    for(Long g=0; g<N; ++g) need += distribution.rankNeedsGroup(rank, g) ? 1 : 0;
+    for(const std::pair<Long, Long>& pair: distribution.pairsOfRank(rank))
+      groupsAtHand = groupsAtHand && distribution.rankNeedsGroup(rank, pair.first) && distribution.rankNeedsGroup(rank, pair.second);
+    largestNeed = std::max(largestNeed, need);
+  }
+  test.assertTrue(distribution.numberOfBlocks()==3, "3 blocks for 6 ranks");
+  test.assertTrue(eachPairOnce, "each pair i<j on one rank");
+  test.assertTrue(groupsAtHand, "groups of the pairs at hand");
+  test.assertTrue(largestNeed<=20, "2-D distribution, at most 2N/3 groups by rank");
+
+  LocalCluster cluster(3);
+  bool thrown = false;
+  try {
+    cluster.run([](Communicator& communicator) {
+      if (communicator.rank()==1) throw std::runtime_error("failing rank");
+      communicator.receive(1, 0);
+    });
+  }
+  catch(const std::exception&) { thrown = true; }
+  test.assertTrue(thrown, "exception of a rank rethrown, waiting ranks released");
+  std::vector<int> itemsDone(20, 0);
+  bool itemErrorRethrown = false;
+  try {
+    forEachInParallel(itemsDone.size(), 4, [&](const Long k) {
+      if (k==7) throw std::runtime_error("failing item");
+      itemsDone[k] = 1;
+    });
+  }
+  catch(const std::exception&) { itemErrorRethrown = true; }
+  test.assertTrue(itemErrorRethrown && (std::accumulate(itemsDone.begin(), itemsDone.end(), 0)==19),
+                  "exception of an item rethrown after the parallel region");
+
+  CaseStudy cas(2, "gauss");
+  const Output out = getDetailedOutput(cas, 0);
+  const arma::vec noNugget {0.0};
+  const CleanScheme<ClusterVector> cleanScheme(cas.gp);
+  std::vector<Long> groupOfRow(cleanScheme.size());
+  for(Long obs=0; obs<groupOfRow.size(); ++obs) groupOfRow[obs] = cleanScheme[obs];
+  for(const int numRanks: {1, 3, 6}) {
+    ShardedNestedKriging sharded(cas.x, cas.covType, cas.param, cas.sd2, cas.ordinaryKriging, cleanScheme.distinctValues(),
+                                 numRanks, 2);
+    std::vector<Long> rowsOfRank(numRanks, 0);
+    LocalCluster ranks(numRanks);
+    ranks.run([&](Communicator& communicator) {
+      const LocalShard shard = LocalShard::ofRank(cas.X, cas.Y, groupOfRow, noNugget, sharded.distribution, communicator.rank());
+      rowsOfRank[communicator.rank()] = shard.X.n_rows;
+      sharded.runRank(communicator, shard);
+    });
+    test.assertTrue(std::accumulate(rowsOfRank.begin(), rowsOfRank.end(), Long(0))==cas.X.n_rows, "each row in one shard, " + std::to_string(numRanks) + " ranks");
+    const std::string ranksTag = std::to_string(numRanks) + " ranks";
+    test.assertCloseValues(out.predmean, sharded.predmean, "same predictions, " + ranksTag);
+    test.assertCloseValues(out.predsd2, sharded.predsd2, "same variances, " + ranksTag);
+    Long pairs = 0, groups = 0;
+    for(const RankStatistics& stats: sharded.statistics) { pairs += stats.pairs; groups += stats.groups; }
+    const Long Ncase = out.mean_MbyGroup.n_cols;
+    test.assertTrue((groups==Ncase) && (pairs==Ncase*(Ncase-1)/2), "each group and pair once, " + ranksTag);
+  }
+  bool foreignRowRefused = false;
+  try {
+    ShardedNestedKriging sharded(cas.x, cas.covType, cas.param, cas.sd2, cas.ordinaryKriging, cleanScheme.distinctValues(), 2, 1);
+    LocalCluster ranks(2);
+    ranks.run([&](Communicator& communicator) {
+      const LocalShard shard = LocalShard::ofRank(cas.X, cas.Y, groupOfRow, noNugget, sharded.distribution, 1-communicator.rank());
+      sharded.runRank(communicator, shard);
+    });
+  }
+  catch(const std::exception&) { foreignRowRefused = true; }
+  test.assertTrue(foreignRowRefused, "rows of groups of another rank refused");
+  return test;
+}
+
+Test testOutOfCoreStore() {
+  Test test("II_ out-of-core store of the weights (outOfCore.h)");
+  const std::vector<Long> sizes {700, 300, 1000, 20, 500, 800, 650};
+  const Long q = 3, N = sizes.size();
+  SpillStore store(true, sizes, q, 3*8.0*1200*q); // tiles of at most 1200 points
+  test.assertTrue(store.enabled(), "scratch file mapped in " + SpillStore::scratchDirectory());
+  test.assertTrue(store.numberOfTiles()==5, "tiles of consecutive groups within the budget");
+  std::vector<arma::mat> alpha = store.matrices();
+  for(Long i=0; i<N; ++i) {
+    alpha[i] = arma::mat(sizes[i], q, arma::fill::ones) * static_cast<double>(i+1);
+    store.releaseGroup(i);
+  }
+  std::vector<int> pairVisits(N*N, 0);
+  bool weightsKept = true;
+  store.forEachTilePair([&](const std::vector<Long>& pairs) {
+    for(const Long w: pairs) {
+      ++pairVisits[w];
+      const Long i = w/N, j = w%N;
+      weightsKept = weightsKept && (alpha[i](sizes[i]-1, q-1)==i+1.0) && (alpha[j](0,0)==j+1.0);
+    }
+  });
+  bool eachPairOnce = true;
+  for(Long i=0; i<N; ++i) for(Long j=0; j<N; ++j) eachPairOnce = eachPairOnce && (pairVisits[i*N+j]==((i<j) ? 1 : 0));
+  test.assertTrue(eachPairOnce, "each pair i<j once");
+  test.assertTrue(weightsKept, "weights read back after release");
+  test.assertTrue(store.tileLoads>=store.numberOfTiles(), "tiles prefetched");
+  test.assertTrue(!SpillStore().enabled(), "store disabled");
+
+  CaseStudy cas(2, "gauss");
+  Output out = getDetailedOutput(cas, 0);
+  Output outOfCore = getDetailedOutput(cas, 0, Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+  test.assertCloseValues(out.predmean, outOfCore.predmean, "same predictions");
+  test.assertCloseValues(out.predsd2, outOfCore.predsd2, "same variances");
+  const ChronoReport& report = outOfCore.chronoReport;
+  const bool counted = std::find(report.counterNames.begin(), report.counterNames.end(), "outOfCore.storeBytes")!=report.counterNames.end();
+  test.assertTrue(counted, "store counters");
+  return test;
+}
+
+double reportedCounter(const ChronoReport& report, const std::string& name) {
+  for(Long k=0; k<report.counterNames.size(); ++k) if (report.counterNames[k]==name) return report.counterValues[k];
+  return -1.0;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+class ScopedEnvironmentVariable {
+  // sets a variable for the scope of a test, then restores its previous value, or its absence
+  const std::string name;
+  bool wasSet = false;
+  std::string previousValue{};
+public:
+  ScopedEnvironmentVariable(const std::string& name, const std::string& value) : name(name) {
+    const char* previous = std::getenv(name.c_str());
+    wasSet = (previous!=nullptr);
+    if (wasSet) previousValue = previous;
+    setenv(name.c_str(), value.c_str(), 1);
+  }
+  ~ScopedEnvironmentVariable() {
+    if (wasSet) setenv(name.c_str(), previousValue.c_str(), 1);
+    else unsetenv(name.c_str());
+  }
+  ScopedEnvironmentVariable(const ScopedEnvironmentVariable&) = delete;
+  ScopedEnvironmentVariable& operator=(const ScopedEnvironmentVariable&) = delete;
+};
+#endif
+
+Test testCheckpoint() {
+  Test test("II_ checkpoint and resume (checkpoint.h)");
+  const std::string path = SpillStore::scratchDirectory() + "/nestedKriging-test.checkpoint";
+  CheckpointRecords records;
+  const arma::mat values = arma::linspace<arma::vec>(0.5, 3.5, 7);
+  records.set("kind", std::vector<double>{1.0});
+  records.setView("values", values);
+  records.write(path, 42);
+  CheckpointRecords loaded;
+  std::uint64_t fingerprint = 0;
+  test.assertTrue(loaded.load(path, fingerprint) && (fingerprint==42), "records loaded with their fingerprint");
+  test.assertCloseValues(loaded.getMatrix("values", 7, 1), values, "values read back");
+  bool otherRunRefused = false;
+  try { loaded.loadRun(path, 43); } catch(const std::exception&) { otherRunRefused = true; }
+  test.assertTrue(otherRunRefused, "checkpoint of another run refused");
+  std::FILE* file = std::fopen(path.c_str(), "r+b");
+  std::fseek(file, 30, SEEK_SET);
+  std::fputc('x', file);
+  std::fclose(file);
+  bool corruptionDetected = false;
+  try { loaded.load(path, fingerprint); } catch(const std::exception&) { corruptionDetected = true; }
+  test.assertTrue(corruptionDetected, "corrupted file refused");
+  std::remove(path.c_str());
+  test.assertTrue(!loaded.load(path, fingerprint), "no checkpoint without file");
+
+  std::mt19937 generator(7), resumedGenerator(1);
+  generator.discard(1000);
+  CheckpointRecords::restoreGenerator(resumedGenerator, CheckpointRecords::generatorState(generator));
+  test.assertTrue(generator()==resumedGenerator(), "generator state restored");
+
+  #if defined(__unix__) || defined(__APPLE__)
+    const ScopedEnvironmentVariable checkpointPath("NESTEDKRIGING_CHECKPOINT", path);
+    CaseStudy cas(2, "gauss");
+    const Rcpp::IntegerVector checkpointOption {0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1000};
+    Output out = getDetailedOutput(cas, 0);
+    Output first = getDetailedOutput(cas, 0, checkpointOption);
+    test.assertCloseValues(out.predmean, first.predmean, "same predictions with checkpoints");
+    test.assertTrue(reportedCounter(first.chronoReport, "checkpoint.writes")>=2, "checkpoints written after partA and partB");
+
+    // interrupted run: half of the groups and the pairs of the columns j>=2 not done
+    loaded.load(path, fingerprint);
+    const Long N = loaded.get("groupDone").size();
+    std::vector<double> groupDone = loaded.get("groupDone");
+    for(Long i=0; i<N; i+=2) groupDone[i] = 0.0;
+    arma::mat KMbyPair = loaded.getMatrix("KMbyPair", cas.x.n_rows, PackedSymMatrix::packedSize(N));
+    for(Long j=2; j<N; ++j) for(Long i=0; i<j; ++i) KMbyPair.col(PackedSymMatrix::index(i,j)).fill(0.0);
+    loaded.set("groupDone", std::move(groupDone));
+    loaded.setView("KMbyPair", KMbyPair);
+    loaded.set("pairColumnsDone", std::vector<double>{2.0});
+    loaded.write(path, fingerprint);
+    Output resumed = getDetailedOutput(cas, 0, checkpointOption);
+    test.assertTrue(reportedCounter(resumed.chronoReport, "checkpoint.resumedGroups")==N/2, "completed groups resumed");
+    test.assertTrue(reportedCounter(resumed.chronoReport, "checkpoint.resumedPairColumns")==2, "completed pair columns resumed");
+    test.assertCloseValues(out.predmean, resumed.predmean, "same predictions after resume");
+    test.assertCloseValues(out.predsd2, resumed.predsd2, "same variances after resume");
+    std::remove(path.c_str());
+
+    // estimParam interrupted after 3 of 6 iterations: SPSA iterations do not depend on niter, the checkpoint of a
+    // run with niter=3 is that of the interrupted run, resumed with a trace (diagnostic options out of fingerprints)
+    const std::vector<signed long> clusters(cas.gp.begin(), cas.gp.end());
+    const Long niter = 6, interrupted = 3, qLOO = 5, seed = 3;
+    const arma::vec paramLower = cas.param*0.01, paramUpper = cas.param*100;
+    const Rcpp::IntegerVector traceOption {0, 1, 1, 0, 0, 0, 0, 0, 0, 100, 0, 0, 0, 0, 0, 1000};
+    const arma::vec noNugget {0.0};
+    auto estimation = [&](const Long iterations, const Rcpp::IntegerVector& globalOptions) {
+      return estimParamCpp<0>(cas.X, cas.Y, clusters, qLOO, cas.covType, iterations, cas.param, paramLower, paramUpper,
+                              cas.sd2, "simple", seed, 0.602, 0.101, 200, 1, 0.1, "", 1, 2, -1, globalOptions, noNugget, "NK");
+    };
+    Rcpp::List uninterrupted = estimation(niter, Rcpp::IntegerVector {0});
+    estimation(interrupted, checkpointOption);
+    loaded.load(path, fingerprint);
+    arma::mat allParams = arma::zeros<arma::mat>(niter, cas.d);
+    allParams.rows(0, interrupted-1) = loaded.getMatrix("allParams", interrupted, cas.d);
+    loaded.setView("allParams", allParams);
+    const GlobalOptions interruptedOptions(checkpointOption);
+    loaded.write(path, estimationFingerprint(cas.X, cas.Y, clusters, qLOO, cas.covType, niter, cas.param, paramLower,
+                 paramUpper, cas.sd2, "simple", seed, std::vector<double>{0.602, 0.101, 200, 1, 0.1}, noNugget, "NK", interruptedOptions));
+    Rcpp::List resumedEstimation{};
+    bool resumedWithTrace = true; // a checkpoint of another run is refused with an error
+    try { resumedEstimation = estimation(niter, traceOption); } catch(const std::exception&) { resumedWithTrace = false; }
+    test.assertTrue(resumedWithTrace, "estimParam: checkpoint resumed with a trace");
+    if (resumedWithTrace) {
+      const arma::mat expectedParams = uninterrupted["allParamIterations"], resumedParams = resumedEstimation["allParamIterations"];
+      const arma::vec expectedErrors = uninterrupted["allErrorIterations"], resumedErrors = resumedEstimation["allErrorIterations"];
+      test.assertCloseValues(expectedParams, resumedParams, "estimParam: same iterations after resume");
+      test.assertCloseValues(expectedErrors, resumedErrors, "estimParam: same errors after resume");
+    }
+    loaded.load(path, fingerprint);
+    test.assertClose(loaded.get("iteration").at(0), niter, "estimParam: resumed run completed");
+    std::remove(path.c_str());
+
+    // diagnostic options do not change fingerprints, the others do
+    const GlobalOptions plain(Rcpp::IntegerVector {0}), counted(Rcpp::IntegerVector {0, 1, 1, 0, 0, 0, 0, 0, 0, 100, 1, 1000});
+    const GlobalOptions packed(Rcpp::IntegerVector {0, 1, 1, 1});
+    auto fingerprintWith = [&](const GlobalOptions& options) {
+      return estimationFingerprint(cas.X, cas.Y, clusters, qLOO, cas.covType, niter, cas.param, paramLower, paramUpper,
+                                   cas.sd2, "simple", seed, std::vector<double>{0.602}, noNugget, "NK", options);
+    };
+    test.assertTrue(fingerprintWith(plain)==fingerprintWith(counted), "estimParam: diagnostic options out of fingerprint");
+    test.assertTrue(fingerprintWith(plain)!=fingerprintWith(packed), "estimParam: other options in fingerprint");
+  #endif
+  return test;
+}
+
 //==================================================== Part III Check Final Results - alone
 // whole system test, without external references. final results
 Test testOneDesignPointOnly() {
@@ -1496,6 +2775,21 @@ Test testNoThreadImpactZoneBasic() {
   return test;
 }
 
+Test testZonesTaskPool() {
+  Test test("III (zones)_ zones, submodels and pairs in one task pool");
+  Parallelism parallelism;
+  parallelism.setThreadsNumber<Parallelism::outerContext>(3);
+  parallelism.setThreadsNumber<Parallelism::innerContext>(2);
+  test.assertTrue(!parallelism.inTaskPool(), "no task pool by default");
+  parallelism.enableTaskPool();
+  test.assertTrue(parallelism.inTaskPool() && parallelism.getTaskPoolThreadsNumber()==6, "one team of outer x inner threads");
+  CaseStudy cas(2, "gauss");
+  Rcpp::List resu = launchOurAlgo(cas, 1, 1), resuPool = launchOurAlgo(cas, 2, 3);
+  arma::vec mean = resu["mean"], meanPool = resuPool["mean"];
+  test.assertCloseValues(mean, meanPool, "same predictions");
+  return test;
+}
+
 Test testNoThreadImpactZone() {
   std::vector<std::string> covFamily{"gauss", "matern5_2", "matern3_2", "exp"};
   Test test("III (zones)_ test no thread Impact - AlgoZone");
@@ -1710,6 +3004,7 @@ Rcpp::List runAllTests(bool showSuccess=false, bool debugMode=false) {
     test.append(testPlatformIndependentCaseStudy());
     //=== Part I, Unit Tests
     test.append(testProgressBar());
+    test.append(testLogQueue());
     test.append(testPoints());
     test.append(testKernelSym());
     test.append(testKernelGaussDimTwo());
@@ -1717,6 +3012,7 @@ Rcpp::List runAllTests(bool showSuccess=false, bool debugMode=false) {
     test.append(testRetrieveCorrFromCrossCorr());
     test.append(testCorrWithEquivalentNuggets());
     test.append(testKernelIdenticalNicolas());
+    test.append(testTiledCorrMatrixFill());
     test.append(testRanks());
     test.append(testWithInterface());
     test.append(testSplitterA());
@@ -1747,6 +3043,27 @@ Rcpp::List runAllTests(bool showSuccess=false, bool debugMode=false) {
     test.append(testIdenticalCrossCorrMatrixkSmallLengthScales());
     test.append(testIdenticalWeightClement());
     test.append(testWeightsSolveSystem());
+    test.append(testBatchedSolver());
+    test.append(testPackedStorage());
+    test.append(testMixedPrecision());
+    test.append(testIterativeSolver());
+    test.append(testMarkovExp());
+    test.append(testStateSpaceMatern());
+    test.append(testKroneckerGrid());
+    test.append(testCompactSupport());
+    test.append(testRandomFeatures());
+    test.append(testInducingPoints());
+    test.append(testVecchia());
+    test.append(testHierarchicalMatrices());
+    test.append(testTrace());
+    test.append(testWorkload());
+    test.append(testHardwareCounters());
+    test.append(testMemoryPlan());
+    test.append(testPlanner());
+    test.append(testNumaPlacement());
+    test.append(testShardedExecution());
+    test.append(testOutOfCoreStore());
+    test.append(testCheckpoint());
 
     //=== Part III Check Final Results - alone
     test.append(testOneDesignPointOnly());
@@ -1761,6 +3078,7 @@ Rcpp::List runAllTests(bool showSuccess=false, bool debugMode=false) {
     //=== Part III (zone) Check Final Results - alone
     test.append(testMergeOutputInAlgoZone());
     test.append(testNoThreadImpactZoneBasic());
+    test.append(testZonesTaskPool());
     test.append(testNoThreadImpactZone());
     test.append(testTooManyThreadsZone());
 
@@ -0,0 +1,200 @@
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+//===============================================================================
+// unit containing a low-overhead execution trace: which submodels, pairs and solves were slow, on which thread
+// each thread writes timestamped events in its own fixed-size ring buffer (no lock, oldest events overwritten),
+// the trace is exported in Chrome trace format (chrome://tracing, Perfetto), with the time each thread waited
+// at the end of each phase. When tracing is off, a TraceScope costs one test, and nothing is allocated.
+//
+// classes:
+// TraceEvent, TraceBuffer, Tracer, TraceScope, ChromeTrace
+//===============================================================================
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+namespace nestedKrig {
+
+//=================================================== TraceEvent
+// category and name must be string literals (no copy), items are -1 when unused
+
+struct TraceEvent {
+  const char* category = "";
+  const char* name = "";
+  long item1 = -1, item2 = -1;
+  double start = 0.0, duration = 0.0; // microseconds
+  int thread = 0, process = 0;
+};
+
+//=================================================== TraceBuffer
+// ring buffer of one thread, only written by this thread
+// alignas(64): the size is a multiple of a cache line, counters of neighbour threads never share one
+
+class alignas(64) TraceBuffer {
+  std::vector<TraceEvent> events{};
+  Long written = 0;
+
+public:
+  explicit TraceBuffer(const Long capacity) : events(capacity) {}
+
+  inline void push(const TraceEvent& event) {
+    events[written % events.size()] = event;
+    ++written;
+  }
+
+  Long dropped() const {
+    return (written>events.size()) ? written-events.size() : 0;
+  }
+
+  void appendChronological(std::vector<TraceEvent>& result) const {
+    const Long kept = written - dropped();
+    for(Long k=written-kept; k<written; ++k) result.push_back(events[k % events.size()]);
+  }
+};
+
+//=================================================== Tracer
+// one buffer by thread, the thread number is the one of the innermost parallel region
+
+class Tracer {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point origin;
+  std::vector<TraceBuffer> buffers{}; // empty when tracing is off
+  Long ignored = 0;                   // events of threads without buffer
+
+  static int threadNumber() {
+    #if defined(_OPENMP)
+      return omp_get_thread_num();
+    #else
+      return 0;
+    #endif
+  }
+
+public:
+  Tracer(const Long capacityByThread, const int numThreads) : origin(Clock::now()) {
+    if (capacityByThread>0) buffers.assign(std::max(numThreads, 1), TraceBuffer(capacityByThread));
+  }
+
+  static Tracer& off() {
+    // shared disabled tracer, default argument of traced functions
+    static Tracer disabled(0, 0);
+    return disabled;
+  }
+
+  inline bool enabled() const {
+    return !buffers.empty();
+  }
+
+  inline double now() const {
+    return std::chrono::duration<double, std::micro>(Clock::now()-origin).count();
+  }
+
+  void record(const char* category, const char* name, const long item1, const long item2, const double start) {
+    const int thread = threadNumber();
+    const double end = now();
+    if (thread>=static_cast<int>(buffers.size())) {
+      #pragma omp atomic
+      ++ignored;
+      return;
+    }
+    TraceEvent event;
+    event.category = category; event.name = name; event.item1 = item1; event.item2 = item2;
+    event.start = start; event.duration = end-start; event.thread = thread;
+    buffers[thread].push(event);
+  }
+
+  std::vector<TraceEvent> events() const {
+    // to be called outside parallel regions
+    std::vector<TraceEvent> result{};
+    for(const TraceBuffer& buffer: buffers) buffer.appendChronological(result);
+    return result;
+  }
+
+  Long droppedEvents() const {
+    Long dropped = ignored;
+    for(const TraceBuffer& buffer: buffers) dropped += buffer.dropped();
+    return dropped;
+  }
+};
+
+//=================================================== TraceScope
+// records one event from construction to destruction
+
+class TraceScope {
+  Tracer& tracer;
+  const char* category;
+  const char* name;
+  const long item1, item2;
+  const double start;
+
+public:
+  TraceScope(Tracer& tracer, const char* category, const char* name, const long item1=-1, const long item2=-1)
+    : tracer(tracer), category(category), name(name), item1(item1), item2(item2), start(tracer.enabled() ? tracer.now() : 0.0) {}
+
+  ~TraceScope() {
+    if (tracer.enabled()) tracer.record(category, name, item1, item2, start);
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+};
+
+//=================================================== ChromeTrace
+// complete events ("ph":"X") in JSON, pid = zone, tid = thread. Phases are events of category "phase"; for each
+// phase and each thread with items of this phase, a "wait" event spans from its last item to the end of the phase
+
+struct ChromeTrace {
+  static std::vector<TraceEvent> withWaits(const std::vector<TraceEvent>& events) {
+    std::vector<TraceEvent> result = events;
+    for(const TraceEvent& phase: events) {
+      if (std::string(phase.category)!="phase") continue;
+      const double phaseEnd = phase.start + phase.duration;
+      std::vector<double> lastEnd{};
+      for(const TraceEvent& item: events) {
+        if ((item.process!=phase.process) || (std::string(item.category)!=phase.name)) continue;
+        if ((item.start<phase.start) || (item.start>phaseEnd)) continue;
+        if (item.thread>=static_cast<int>(lastEnd.size())) lastEnd.resize(item.thread+1, -1.0);
+        lastEnd[item.thread] = std::max(lastEnd[item.thread], item.start+item.duration);
+      }
+      for(int thread=0; thread<static_cast<int>(lastEnd.size()); ++thread) {
+        if ((lastEnd[thread]<0) || (lastEnd[thread]>=phaseEnd)) continue;
+        TraceEvent wait;
+        wait.category = phase.name; wait.name = "wait";
+        wait.start = lastEnd[thread]; wait.duration = phaseEnd-lastEnd[thread];
+        wait.thread = thread; wait.process = phase.process;
+        result.push_back(wait);
+      }
+    }
+    return result;
+  }
+
+  static std::string json(const std::vector<TraceEvent>& events, const Long droppedEvents) {
+    std::ostringstream oss;
+    oss.precision(15);
+    oss << "{\"traceEvents\":[";
+    bool first = true;
+    for(const TraceEvent& event: withWaits(events)) {
+      oss << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\""
+          << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+          << ",\"pid\":" << event.process << ",\"tid\":" << event.thread << ",\"args\":{";
+      if (event.item1>=0) oss << "\"i\":" << event.item1;
+      if (event.item2>=0) oss << ",\"j\":" << event.item2;
+      oss << "}}";
+      first = false;
+    }
+    oss << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << droppedEvents << "}}";
+    return oss.str();
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* TRACE_HPP */
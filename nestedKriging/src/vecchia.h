@@ -0,0 +1,283 @@
+
+#ifndef VECCHIA_HPP
+#define VECCHIA_HPP
+
+//===============================================================================
+// unit containing a Vecchia (nearest neighbour) engine, an alternative to nested Kriging for very large n
+// points are ordered, the density of Y(X) is approximated by prod_i p(y_i | y_c(i)) where c(i) are the m nearest
+// previously ordered points, found with a k-d tree in the rescaled space of Points. Each conditional costs one
+// m x m solve, likelihood and predictions are O(n m^3) and parallel by point. With m >= n-1, results are exact.
+//
+// classes:
+// KdTree, VecchiaEngine
+//===============================================================================
+
+#include "common.h"
+#include "messages.h"
+#include "covariance.h"
+#include "iterativeSolver.h" // BlockJacobiPreconditioner::orderAlongLargestSpread
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+namespace nestedKrig {
+
+//=================================================== KdTree
+// static tree, nodes split at the median of the coordinate of largest spread
+// each node keeps the smallest rank of its points, so that queries restricted to ranks < rankLimit skip whole subtrees
+
+class KdTree {
+  struct Node {
+    Long begin = 0, end = 0, minRank = 0;
+    Long left = 0, right = 0; // 0 for leaves, the root is never a child
+    PointDimension axis = 0;
+    double split = 0.0;
+  };
+  static constexpr Long leafSize = 16;
+
+  const Points& points;
+  const std::vector<Long>& rankOfPoint;
+  std::vector<Long> indices{};
+  std::vector<Node> nodes{};
+
+  Long build(const Long begin, const Long end) {
+    const Long nodeIndex = nodes.size();
+    nodes.push_back(Node{});
+    Long minRank = rankOfPoint[indices[begin]];
+    for(Long r=begin+1; r<end; ++r) minRank = std::min(minRank, rankOfPoint[indices[r]]);
+    nodes[nodeIndex].begin = begin; nodes[nodeIndex].end = end; nodes[nodeIndex].minRank = minRank;
+    if (end-begin<=leafSize) return nodeIndex;
+    PointDimension axis = 0;
+    double bestSpread = -1.0;
+    for(PointDimension k=0; k<points.d; ++k) {
+      double minValue = points[indices[begin]][k], maxValue = minValue;
+      for(Long r=begin+1; r<end; ++r) {
+        minValue = std::min(minValue, points[indices[r]][k]);
+        maxValue = std::max(maxValue, points[indices[r]][k]);
+      }
+      if (maxValue-minValue>bestSpread) { bestSpread = maxValue-minValue; axis = k; }
+    }
+    const Long middle = begin + (end-begin)/2;
+    std::nth_element(indices.begin()+begin, indices.begin()+middle, indices.begin()+end,
+                     [&](Long a, Long b) { return points[a][axis] < points[b][axis]; });
+    nodes[nodeIndex].axis = axis;
+    nodes[nodeIndex].split = points[indices[middle]][axis];
+    const Long left = build(begin, middle);
+    const Long right = build(middle, end);
+    nodes[nodeIndex].left = left; nodes[nodeIndex].right = right;
+    return nodeIndex;
+  }
+
+  using Candidate = std::pair<double, Long>; // squared distance, point
+  using Candidates = std::priority_queue<Candidate>; // largest distance on top
+
+  template <typename PointType>
+  void search(const Long nodeIndex, const PointType& target, const Long k, const Long rankLimit, Candidates& best) const {
+    const Node& node = nodes[nodeIndex];
+    if (node.minRank>=rankLimit) return;
+    if (node.left==0) {
+      for(Long r=node.begin; r<node.end; ++r) {
+        const Long point = indices[r];
+        if (rankOfPoint[point]>=rankLimit) continue;
+        double distance2 = 0.0;
+        for(PointDimension l=0; l<points.d; ++l) { const double t = points[point][l]-target[l]; distance2 += t*t; }
+        if (best.size()<k) best.push(Candidate(distance2, point));
+        else if (distance2<best.top().first) { best.pop(); best.push(Candidate(distance2, point)); }
+      }
+      return;
+    }
+    const double gap = target[node.axis]-node.split;
+    const Long nearChild = (gap<0) ? node.left : node.right, farChild = (gap<0) ? node.right : node.left;
+    search(nearChild, target, k, rankLimit, best);
+    if ((best.size()<k) || (gap*gap<best.top().first)) search(farChild, target, k, rankLimit, best);
+  }
+
+public:
+  KdTree(const Points& points, const std::vector<Long>& rankOfPoint) : points(points), rankOfPoint(rankOfPoint), indices(points.size()) {
+    for(Long i=0; i<indices.size(); ++i) indices[i] = i;
+    if (!indices.empty()) build(0, indices.size());
+  }
+
+  template <typename PointType>
+  std::vector<Long> nearest(const PointType& target, const Long k, const Long rankLimit) const {
+    // the k nearest points of rank < rankLimit, sorted by increasing distance
+    Candidates best{};
+    if ((!nodes.empty()) && (k>0)) search(0, target, k, rankLimit, best);
+    std::vector<Long> result(best.size());
+    for(Long r=result.size(); r>0; --r) { result[r-1] = best.top().second; best.pop(); }
+    return result;
+  }
+};
+
+//=================================================== VecchiaEngine
+// conditional of y_i given y_c(i): mean b_i^T y_c(i), variance v_i (correlation scale), b_i = K_cc^-1 k_ci
+// with e_i(z) = (z_i - b_i^T z_c(i))/sqrt(v_i), the approximate precision gives z^T Q z' = sum_i e_i(z) e_i(z')
+
+class VecchiaEngine {
+  const Covariance& kernel;
+  const Points& pointsX;
+  const arma::vec& Y;
+  const Covariance::NuggetVector& nugget;
+  const Long numNeighbours;
+  const bool ordinaryKriging;
+  const int numThreads;
+  std::vector<Long> order{}, rankOfPoint{};
+  const KdTree tree;
+  arma::vec conditionalVariances{}, residualsY{}, residualsOne{};
+  double beta = 0.0, oneQone = 0.0;
+
+  const std::vector<Long>& createOrder() {
+    // coordinate order, along the coordinate of largest spread
+    order = BlockJacobiPreconditioner::orderAlongLargestSpread(pointsX);
+    rankOfPoint.resize(order.size());
+    for(Long r=0; r<order.size(); ++r) rankOfPoint[order[r]] = r;
+    return rankOfPoint;
+  }
+
+  arma::mat neighboursCorrMatrix(const std::vector<Long>& neighbours) const {
+    const Long m = neighbours.size();
+    arma::mat K(m, m);
+    for(Long b=0; b<m; ++b)
+      for(Long a=0; a<m; ++a) K.at(a,b) = kernel.corrMatrixEntry(pointsX, neighbours[a], neighbours[b], nugget);
+    return K;
+  }
+
+  static arma::vec solveSympd(const arma::mat& K, const arma::vec& k) {
+    arma::mat R;
+    if (!arma::chol(R, K)) throw std::runtime_error("Vecchia: neighbours correlation matrix is not positive definite");
+    return arma::solve(arma::trimatu(R), arma::solve(arma::trimatl(R.t()), k, arma::solve_opts::fast), arma::solve_opts::fast);
+  }
+
+  void fitConditionals() {
+    const Long n = pointsX.size();
+    conditionalVariances.set_size(n); residualsY.set_size(n); residualsOne.set_size(n);
+    bool allPositive = true;
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(numThreads) if (numThreads>1)
+    for(Long i=0; i<n; ++i) {
+      const std::vector<Long> neighbours = tree.nearest(pointsX[i], numNeighbours, rankOfPoint[i]);
+      const Long m = neighbours.size();
+      arma::vec kci(m), yc(m);
+      for(Long a=0; a<m; ++a) {
+        kci[a] = kernel.corrMatrixEntry(pointsX, neighbours[a], i, nugget);
+        yc[a] = Y[neighbours[a]];
+      }
+      arma::vec b(m);
+      try { if (m>0) b = solveSympd(neighboursCorrMatrix(neighbours), kci); }
+      catch(const std::exception&) {
+        #pragma omp atomic write
+        allPositive = false;
+        continue;
+      }
+      const double variance = kernel.diagonalValueAt(i, nugget) - ((m>0) ? arma::dot(kci, b) : 0.0);
+      const double scale = 1.0/std::sqrt(variance);
+      conditionalVariances[i] = variance;
+      residualsY[i] = (Y[i] - ((m>0) ? arma::dot(b, yc) : 0.0))*scale;
+      residualsOne[i] = (1.0 - ((m>0) ? arma::accu(b) : 0.0))*scale;
+    }
+    if (!allPositive) throw std::runtime_error("Vecchia: neighbours correlation matrix is not positive definite");
+    oneQone = arma::dot(residualsOne, residualsOne);
+    beta = ordinaryKriging ? arma::dot(residualsOne, residualsY)/oneQone : 0.0;
+  }
+
+public:
+  VecchiaEngine(const Covariance& kernel, const Points& pointsX, const arma::vec& Y, const Covariance::NuggetVector& nugget,
+                const Long numNeighbours, const bool ordinaryKriging, const int numThreads)
+    : kernel(kernel), pointsX(pointsX), Y(Y), nugget(nugget), numNeighbours(numNeighbours), ordinaryKriging(ordinaryKriging),
+      numThreads(numThreads), tree(pointsX, createOrder()) {
+    fitConditionals();
+  }
+
+  double trendEstimate() const {
+    return beta;
+  }
+
+  double logLikelihood(const double sd2) const {
+    // Gaussian log-likelihood of the Vecchia density, at the estimated constant mean for ordinary Kriging
+    const Long n = pointsX.size();
+    const double pi = 3.141592653589793;
+    double sumLogVariances = 0.0, sumSquares = 0.0;
+    for(Long i=0; i<n; ++i) {
+      const double e = residualsY[i] - beta*residualsOne[i];
+      sumLogVariances += std::log(conditionalVariances[i]);
+      sumSquares += e*e;
+    }
+    return -0.5*(n*std::log(2*pi*sd2) + sumLogVariances + sumSquares/sd2);
+  }
+
+  void predict(const Points& pointsx, const double sd2, arma::vec& mean, arma::vec& sd2Pred) const {
+    // each prediction point is conditioned on its m nearest observations
+    const Long q = pointsx.size(), n = pointsX.size();
+    mean.set_size(q); sd2Pred.set_size(q);
+    bool allPositive = true;
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(numThreads) if (numThreads>1)
+    for(Long p=0; p<q; ++p) {
+      const std::vector<Long> neighbours = tree.nearest(pointsx[p], numNeighbours, n);
+      const Long m = neighbours.size();
+      arma::vec k(m), yc(m);
+      for(Long a=0; a<m; ++a) {
+        k[a] = kernel.crossCorrelation(pointsx, p, pointsX, neighbours[a]);
+        yc[a] = Y[neighbours[a]];
+      }
+      arma::vec w(m);
+      try { w = solveSympd(neighboursCorrMatrix(neighbours), k); }
+      catch(const std::exception&) {
+        #pragma omp atomic write
+        allPositive = false;
+        continue;
+      }
+      mean[p] = beta + arma::dot(w, yc - beta);
+      double variance = 1.0 - arma::dot(w, k);
+      if (ordinaryKriging) {
+        const double t = 1.0 - arma::accu(w);
+        variance += t*t/oneQone;
+      }
+      sd2Pred[p] = sd2*std::max(0.0, variance);
+    }
+    if (!allPositive) throw std::runtime_error("Vecchia: neighbours correlation matrix is not positive definite");
+  }
+};
+
+//=================================================== vecchia_kriging
+// same interface as nested_kriging, returns mean, sd2, logLikelihood and durations
+
+inline Rcpp::List vecchia_kriging(const arma::mat& X, const arma::vec& Y, const arma::mat& x, const std::string covType,
+                                  const arma::vec& param, const double sd2, const bool ordinaryKriging, const std::string tagAlgo,
+                                  const long numThreads, const int verboseLevel, const arma::vec& nugget, const long numNeighbours) {
+  const Screen screen(verboseLevel);
+  Chrono chrono(screen, tagAlgo);
+  if (numNeighbours<1) throw std::runtime_error("numNeighbours must be positive");
+  if ((X.n_rows!=Y.n_elem) || (X.n_cols!=x.n_cols)) throw std::runtime_error("Vecchia: incompatible dimensions of X, Y, x");
+  chrono.start();
+  const CovarianceParameters covParam(X.n_cols, param, sd2, covType);
+  const Covariance kernel(covParam);
+  const Points pointsX(X, covParam), pointsx(x, covParam);
+  const Covariance::NuggetVector nuggetVector = ((nugget.n_elem==1) && (nugget[0]==0.0)) ? Covariance::NuggetVector{} : nugget;
+  const int threads = static_cast<int>((numThreads>0) ? numThreads : 1);
+  const VecchiaEngine engine(kernel, pointsX, Y, nuggetVector, numNeighbours, ordinaryKriging, threads);
+  chrono.saveStep("conditionals");
+  arma::vec mean, sd2Pred;
+  engine.predict(pointsx, sd2, mean, sd2Pred);
+  chrono.saveStep("predictions");
+  chrono.report.saveCounter("vecchia.numNeighbours", numNeighbours);
+  const ChronoReport& report = chrono.report;
+  std::ostringstream versionInfos;
+  versionInfos << VERSION_CODE  << " built " << BUILT_ID;
+  return Rcpp::List::create(
+    Rcpp::Named("mean") = mean,
+    Rcpp::Named("sd2") = sd2Pred,
+    Rcpp::Named("logLikelihood") = engine.logLikelihood(sd2),
+    Rcpp::Named("trend") = engine.trendEstimate(),
+    Rcpp::Named("duration") = report.totalDuration,
+    Rcpp::Named("durationDetails") = Rcpp::DataFrame::create(
+      Rcpp::Named("stepName") = report.stepNames,
+      Rcpp::Named("duration") = report.durations),
+    Rcpp::Named("counterDetails") = Rcpp::DataFrame::create(
+      Rcpp::Named("counterName") = report.counterNames,
+      Rcpp::Named("value") = report.counterValues),
+    Rcpp::Named("sourceCode") = versionInfos.str()
+  );
+}
+
+} //end namespace nestedKrig
+
+#endif /* VECCHIA_HPP */
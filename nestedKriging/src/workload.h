@@ -0,0 +1,162 @@
+
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+//===============================================================================
+// unit containing analytic operation counts of the steps of the algorithm: kernel evaluations, flops and bytes
+// counts are those of the dense reference algorithm (Cholesky factorizations, dense cross-correlations) and of
+// random features; steps run by other solvers are not counted by the Algo (zero rates); bytes are the compulsory
+// traffic, each operand read or written once, and flops of a kernel evaluation exclude the exp/pow call.
+// Dividing by step durations tells whether a step is compute-bound (high GFLOP/s) or memory-bound (high GB/s).
+//
+// classes:
+// Workload, WorkloadModel, NestedKrigingWorkload
+//===============================================================================
+
+#include "common.h"
+#include <vector>
+
+namespace nestedKrig {
+
+//=================================================== Workload
+// operation counts of one step, in double to avoid overflows of large n^3
+
+struct Workload {
+  double kernelEvaluations = 0.0, flops = 0.0, bytes = 0.0;
+
+  Workload& operator+=(const Workload& other) {
+    kernelEvaluations += other.kernelEvaluations; flops += other.flops; bytes += other.bytes;
+    return *this;
+  }
+
+  Workload operator*(const double factor) const {
+    Workload result = *this;
+    result.kernelEvaluations *= factor; result.flops *= factor; result.bytes *= factor;
+    return result;
+  }
+};
+
+inline Workload operator+(Workload left, const Workload& right) {
+  return left += right;
+}
+
+//=================================================== WorkloadModel
+// counts of the elementary operations, sizes in double
+
+struct WorkloadModel {
+  static constexpr double bytesByDouble = 8.0;
+  static constexpr double flopsByCoordinate = 3.0; // difference, scaling, accumulation
+
+  static Workload kernelMatrix(const double rows, const double cols, const double d, const bool symmetric) {
+    Workload w;
+    w.kernelEvaluations = symmetric ? rows*(rows+1)/2 : rows*cols;
+    w.flops = w.kernelEvaluations*flopsByCoordinate*d;
+    w.bytes = bytesByDouble*(rows*cols + (symmetric ? rows : rows+cols)*d);
+    return w;
+  }
+
+  static Workload cholesky(const double n) {
+    Workload w;
+    w.flops = n*n*n/3;
+    w.bytes = 2*bytesByDouble*n*n;
+    return w;
+  }
+
+  static Workload choleskySolve(const double n, const double rhs) {
+    // two triangular solves
+    Workload w;
+    w.flops = 2*n*n*rhs;
+    w.bytes = bytesByDouble*(n*n + 2*n*rhs);
+    return w;
+  }
+
+  static Workload product(const double m, const double n, const double k) {
+    // (m x k) times (k x n)
+    Workload w;
+    w.flops = 2*m*n*k;
+    w.bytes = bytesByDouble*(m*k + k*n + m*n);
+    return w;
+  }
+
+  static Workload dots(const double n, const double count) {
+    Workload w;
+    w.flops = 2*n*count;
+    w.bytes = 2*bytesByDouble*n*count;
+    return w;
+  }
+};
+
+//=================================================== NestedKrigingWorkload
+// workload of each part of the nested Kriging Algo, from group sizes ni, q prediction points, dimension d
+
+class NestedKrigingWorkload {
+  using M = WorkloadModel;
+  const std::vector<double> groupSizes;
+  const double q, d;
+  const bool ordinaryKriging;
+
+  static std::vector<double> sizesOf(const std::vector<Long>& sizes) {
+    return std::vector<double>(sizes.begin(), sizes.end());
+  }
+
+  double N() const {
+    return static_cast<double>(groupSizes.size());
+  }
+
+public:
+  NestedKrigingWorkload(const std::vector<Long>& groupSizes, const Long q, const Long d, const bool ordinaryKriging)
+    : groupSizes(sizesOf(groupSizes)), q(static_cast<double>(q)), d(static_cast<double>(d)), ordinaryKriging(ordinaryKriging) {}
+
+  Workload partA(const bool computeCov) const {
+    // Ki, ki, Cholesky of Ki, weights alpha_i, then mean, cov(Mi,Y), var(Mi) by prediction point
+    Workload w;
+    for(const double ni: groupSizes) {
+      w += M::kernelMatrix(ni, ni, d, true) + M::kernelMatrix(ni, q, d, false);
+      w += M::cholesky(ni) + M::choleskySolve(ni, ordinaryKriging ? q+1 : q) + M::dots(ni, 3*q);
+      if (computeCov) w += M::product(q, q, ni);
+    }
+    return w;
+  }
+
+  Workload pairOfGroups(const double ni, const double nj, const bool computeCov) const {
+    // Kij, Kij alpha_j, then one dot by prediction point (all pairs of prediction points with cross-cov)
+    return M::kernelMatrix(ni, nj, d, false) + M::product(ni, q, nj) + M::dots(ni, computeCov ? q*q : q);
+  }
+
+  Workload partB(const bool computeCov) const {
+    // pairs i<j, and i=j with cross-cov
+    Workload w;
+    const Long numberOfGroups = groupSizes.size();
+    for(Long j=0; j<numberOfGroups; ++j)
+      for(Long i=0; (computeCov ? i<=j : i<j); ++i) w += pairOfGroups(groupSizes[i], groupSizes[j], computeCov);
+    return w;
+  }
+
+  Workload partBRandomFeatures(const double features) const {
+    // D features of each group projected on alpha_i, then one N x N Gram matrix by prediction point
+    Workload w;
+    for(const double ni: groupSizes) w += M::product(features, d, ni) + M::product(features, q, ni);
+    const Workload gram = M::product(N(), N(), features)*0.5;
+    return w + gram*q;
+  }
+
+  Workload partC() const {
+    // one N x N system by prediction point, then mean and variance
+    return (M::cholesky(N()) + M::choleskySolve(N(), 1))*q + M::dots(N(), 2*q);
+  }
+
+  Workload partD() const {
+    // k(x,x) and, for each pair of prediction points, two dots and one quadratic form
+    const Workload byPair = M::dots(N(), 2) + M::product(N(), 1, N()) + M::dots(N(), 1);
+    return M::kernelMatrix(q, q, d, true) + byPair*(q*q);
+  }
+
+  Workload partE() const {
+    // a few reductions of length N by prediction point (POE, GPOE, BCM, RBCM, SPV)
+    return M::dots(N(), 6*q);
+  }
+};
+
+} //end namespace nestedKrig
+
+#endif /* WORKLOAD_HPP */